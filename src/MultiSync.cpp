@@ -60,6 +60,7 @@
 #include "mediaoutput/mediaoutput.h"
 
 #include "MultiSync.h"
+#include "MultiSyncStream.h"
 
 MultiSync MultiSync::INSTANCE;
 MultiSync* multiSync = &MultiSync::INSTANCE;
@@ -251,6 +252,8 @@ int MultiSync::Init(void) {
     };
     NetworkMonitor::INSTANCE.registerCallback(f);
 
+    MultiSyncStream::INSTANCE.Init();
+
     return 1;
 }
 
@@ -450,6 +453,9 @@ bool MultiSync::FillLocalSystemInfo(void) {
     newSystem.hostname = m_hostname;
     newSystem.fppMode = getFPPmode();
     newSystem.sendingMultiSync = m_multiSyncEnabled;
+    newSystem.syncCapabilities = MULTISYNC_CAP_SYNC_V2;
+    if ((newSystem.fppMode == REMOTE_MODE) && getSettingInt("MultiSyncStreaming"))
+        newSystem.syncCapabilities |= MULTISYNC_CAP_STREAM;
     newSystem.version = getFPPVersion();
     newSystem.model = model;
     newSystem.ipa = 0;
@@ -740,6 +746,37 @@ Json::Value MultiSync::GetSyncStats() {
     result["masterIP"] = m_syncMaster;
     result["masterHostname"] = masterHostname;
 
+    if (getFPPmode() == REMOTE_MODE)
+        result["masterClock"] = m_masterClock.toJSON();
+
+    Json::Value stream = MultiSyncStream::INSTANCE.GetStats();
+    if (!stream.empty())
+        result["stream"] = stream;
+
+    return result;
+}
+
+/*
+ * Ranges in the form sent in our ping, streaming remotes are identified
+ * by this string
+ */
+std::string MultiSync::GetLocalRanges(void) {
+    return createRanges(GetOutputRanges(true), 120);
+}
+
+/*
+ * Distinct channel ranges of remotes which asked for channel data to be
+ * streamed to them
+ */
+std::set<std::string> MultiSync::GetStreamingRemoteRanges(void) {
+    std::set<std::string> result;
+
+    std::unique_lock<std::recursive_mutex> lock(m_systemsLock);
+    for (auto& sys : m_remoteSystems) {
+        if ((sys.fppMode & REMOTE_MODE) && (sys.syncCapabilities & MULTISYNC_CAP_STREAM) && !sys.ranges.empty())
+            result.insert(sys.ranges);
+    }
+
     return result;
 }
 
@@ -1231,10 +1268,11 @@ int MultiSync::CreatePingPacket(MultiSyncSystem& sysInfo, char* outBuf, int disc
     strncpy((char*)(ed + 77), sysInfo.version.c_str(), 40);
     strncpy((char*)(ed + 118), sysInfo.model.c_str(), 40);
     strncpy((char*)(ed + 159), sysInfo.ranges.c_str(), 120);
+    ed[280] = sysInfo.syncCapabilities;
     return sizeof(ControlPkt) + cpkt->extraDataLen;
 }
 
-void MultiSync::SendSeqOpenPacket(const std::string& filename) {
+void MultiSync::SendSeqOpenPacket(const std::string& filename, uint64_t sequenceId) {
     if (filename.empty()) {
         return;
     }
@@ -1244,13 +1282,21 @@ void MultiSync::SendSeqOpenPacket(const std::string& filename) {
         return;
     }
 
-    LogDebug(VB_SYNC, "SendSeqOpenPacket('%s')\n", filename.c_str());
+    LogDebug(VB_SYNC, "SendSeqOpenPacket('%s', %llu)\n", filename.c_str(), (unsigned long long)sequenceId);
     for (auto a : m_plugins) {
         a->SendSeqOpenPacket(filename);
     }
     m_lastFrame = -1;
     m_lastFrameSent = -1;
 
+    bool syncV2 = sequenceId && RemotesSupportSyncV2();
+    std::unique_lock<std::mutex> lock(m_syncSeqLock);
+    m_syncSeqFilename = filename;
+    m_syncSeqId = sequenceId;
+    m_syncV2 = syncV2;
+    m_lastSyncV2Check = GetMonotonicTime();
+    lock.unlock();
+
     char outBuf[2048];
     bzero(outBuf, sizeof(outBuf));
 
@@ -1268,6 +1314,43 @@ void MultiSync::SendSeqOpenPacket(const std::string& filename) {
     spkt->secondsElapsed = 0;
     strcpy(spkt->filename, filename.c_str());
 
+    int len = AddSyncSequenceId(outBuf, sizeof(ControlPkt) + sizeof(SyncPkt) + filename.length(), filename);
+
+    SendControlPacket(outBuf, len);
+}
+
+void MultiSync::SendSeqPreparePacket(const std::string& filename) {
+    LogDebug(VB_SYNC, "SendSeqPreparePacket('%s')\n", filename.c_str());
+    SendPreparePacket(SYNC_FILE_SEQ, filename);
+}
+
+void MultiSync::SendPreparePacket(int fileType, const std::string& filename) {
+    if (filename.empty()) {
+        return;
+    }
+
+    if (m_controlSock < 0) {
+        LogErr(VB_SYNC, "ERROR: Tried to send prepare packet but sync socket is not open.\n");
+        return;
+    }
+
+    char outBuf[2048];
+    bzero(outBuf, sizeof(outBuf));
+
+    ControlPkt* cpkt = (ControlPkt*)outBuf;
+    SyncPkt* spkt = (SyncPkt*)(outBuf + sizeof(ControlPkt));
+
+    InitControlPacket(cpkt);
+
+    cpkt->pktType = CTRL_PKT_SYNC;
+    cpkt->extraDataLen = sizeof(SyncPkt) + filename.length();
+
+    spkt->pktType = SYNC_PKT_PREPARE;
+    spkt->fileType = fileType;
+    spkt->frameNumber = 0;
+    spkt->secondsElapsed = 0;
+    strcpy(spkt->filename, filename.c_str());
+
     SendControlPacket(outBuf, sizeof(ControlPkt) + sizeof(SyncPkt) + filename.length());
 }
 
@@ -1305,7 +1388,9 @@ void MultiSync::SendSeqSyncStartPacket(const std::string& filename) {
     spkt->secondsElapsed = 0;
     strcpy(spkt->filename, filename.c_str());
 
-    SendControlPacket(outBuf, sizeof(ControlPkt) + sizeof(SyncPkt) + filename.length());
+    int len = AddSyncSequenceId(outBuf, sizeof(ControlPkt) + sizeof(SyncPkt) + filename.length(), filename);
+
+    SendControlPacket(outBuf, len);
 }
 
 /*
@@ -1342,7 +1427,17 @@ void MultiSync::SendSeqSyncStopPacket(const std::string& filename) {
     spkt->secondsElapsed = 0;
     strcpy(spkt->filename, filename.c_str());
 
-    SendControlPacket(outBuf, sizeof(ControlPkt) + sizeof(SyncPkt) + filename.length());
+    int len = AddSyncSequenceId(outBuf, sizeof(ControlPkt) + sizeof(SyncPkt) + filename.length(), filename);
+
+    SendControlPacket(outBuf, len);
+
+    std::unique_lock<std::mutex> lock(m_syncSeqLock);
+    if (filename == m_syncSeqFilename) {
+        m_syncSeqFilename = "";
+        m_syncSeqId = 0;
+        m_syncV2 = false;
+    }
+    lock.unlock();
 
     m_lastFrame = -1;
     m_lastFrameSent = -1;
@@ -1378,9 +1473,58 @@ void MultiSync::SendSeqSyncPacket(const std::string& filename, int frames, float
 
     LogDebug(VB_SYNC, "SendSeqSyncPacket( '%s', %d, %.2f)\n",
              filename.c_str(), frames, seconds);
+
+    std::unique_lock<std::mutex> lock(m_syncSeqLock);
+    uint64_t sequenceId = (filename == m_syncSeqFilename) ? m_syncSeqId : 0;
+    bool syncV2 = sequenceId && m_syncV2;
+    int64_t now = GetMonotonicTime();
+    bool recheck = sequenceId && ((now - m_lastSyncV2Check) > 1000000);
+    if (recheck)
+        m_lastSyncV2Check = now;
+    // Compact packets carry no filename, once a second send a filename
+    // based one with the ID instead so remotes which missed the OPEN/START
+    // (rebooted, dropped off WiFi) can bind the ID again
+    bool announce = syncV2 && ((now - m_lastSyncV2Announce) > 1000000);
+    if (announce)
+        m_lastSyncV2Announce = now;
+    lock.unlock();
+
+    if (recheck) {
+        // Pick up remotes which appeared or were upgraded since the
+        // sequence was opened
+        bool newSyncV2 = RemotesSupportSyncV2();
+        if (newSyncV2 != syncV2) {
+            LogDebug(VB_SYNC, "Switching to %s sync packets\n", newSyncV2 ? "compact" : "filename based");
+            lock.lock();
+            m_syncV2 = newSyncV2;
+            lock.unlock();
+            syncV2 = newSyncV2;
+        }
+    }
+
     char outBuf[2048];
     bzero(outBuf, sizeof(outBuf));
 
+    if (syncV2 && !announce) {
+        ControlPkt* cpkt = (ControlPkt*)outBuf;
+        SyncPktV2* spkt = (SyncPktV2*)(outBuf + sizeof(ControlPkt));
+
+        InitControlPacket(cpkt);
+
+        cpkt->pktType = CTRL_PKT_SYNC_V2;
+        cpkt->extraDataLen = sizeof(SyncPktV2);
+
+        spkt->version = 2;
+        spkt->pktType = SYNC_PKT_SYNC;
+        spkt->sequenceId = sequenceId;
+        spkt->frameNumber = frames;
+        spkt->secondsElapsed = seconds;
+        spkt->masterTime = GetMonotonicTime();
+
+        SendControlPacket(outBuf, sizeof(ControlPkt) + sizeof(SyncPktV2));
+        return;
+    }
+
     ControlPkt* cpkt = (ControlPkt*)outBuf;
     SyncPkt* spkt = (SyncPkt*)(outBuf + sizeof(ControlPkt));
 
@@ -1395,7 +1539,70 @@ void MultiSync::SendSeqSyncPacket(const std::string& filename, int frames, float
     spkt->secondsElapsed = seconds;
     strcpy(spkt->filename, filename.c_str());
 
-    SendControlPacket(outBuf, sizeof(ControlPkt) + sizeof(SyncPkt) + filename.length());
+    int len = AddSyncTimestamp(outBuf, sizeof(ControlPkt) + sizeof(SyncPkt) + filename.length());
+    if (announce)
+        len = AddSyncSequenceId(outBuf, len, filename);
+
+    SendControlPacket(outBuf, len);
+}
+
+/*
+ * Append the master's monotonic time to a sync packet so remotes can
+ * schedule the frame against the master's timeline
+ */
+int MultiSync::AddSyncTimestamp(char* outBuf, int len) {
+    ControlPkt* cpkt = (ControlPkt*)outBuf;
+    SyncPktTimestamp* ext = (SyncPktTimestamp*)(outBuf + len);
+
+    ext->extType = SYNC_PKT_EXT_TIMESTAMP;
+    ext->extLen = sizeof(SyncPktTimestamp);
+    ext->masterTime = GetMonotonicTime();
+
+    cpkt->extraDataLen += sizeof(SyncPktTimestamp);
+
+    return len + sizeof(SyncPktTimestamp);
+}
+
+/*
+ * Append the ID of the open sequence to an OPEN/START/STOP packet, or the
+ * periodic filename based SYNC packet, so remotes can match up the
+ * compact CTRL_PKT_SYNC_V2 packets which follow
+ */
+int MultiSync::AddSyncSequenceId(char* outBuf, int len, const std::string& filename) {
+    std::unique_lock<std::mutex> lock(m_syncSeqLock);
+    if (!m_syncSeqId || (filename != m_syncSeqFilename))
+        return len;
+
+    ControlPkt* cpkt = (ControlPkt*)outBuf;
+    SyncPktSequenceId* ext = (SyncPktSequenceId*)(outBuf + len);
+
+    ext->extType = SYNC_PKT_EXT_SEQUENCE_ID;
+    ext->extLen = sizeof(SyncPktSequenceId);
+    ext->sequenceId = m_syncSeqId;
+
+    cpkt->extraDataLen += sizeof(SyncPktSequenceId);
+
+    return len + sizeof(SyncPktSequenceId);
+}
+
+/*
+ * Compact sync packets are only used if every remote we know about has
+ * told us in its ping that it understands them
+ */
+bool MultiSync::RemotesSupportSyncV2(void) {
+    // Passive or undiscovered remotes may be older versions, so only use
+    // v2 once there are remotes and all of them understand it
+    std::unique_lock<std::recursive_mutex> lock(m_systemsLock);
+    bool haveRemote = false;
+    for (auto& sys : m_remoteSystems) {
+        if (!(sys.fppMode & REMOTE_MODE))
+            continue;
+        if (!(sys.syncCapabilities & MULTISYNC_CAP_SYNC_V2))
+            return false;
+        haveRemote = true;
+    }
+
+    return haveRemote;
 }
 
 void MultiSync::SendMediaOpenPacket(const std::string& filename) {
@@ -1434,6 +1641,10 @@ void MultiSync::SendMediaOpenPacket(const std::string& filename) {
 
     SendControlPacket(outBuf, sizeof(ControlPkt) + sizeof(SyncPkt) + filename.length());
 }
+void MultiSync::SendMediaPreparePacket(const std::string& filename) {
+    LogDebug(VB_SYNC, "SendMediaPreparePacket('%s')\n", filename.c_str());
+    SendPreparePacket(SYNC_FILE_MEDIA, filename);
+}
 void MultiSync::SendMediaSyncStartPacket(const std::string& filename) {
     if (filename.empty()) {
         return;
@@ -1627,6 +1838,8 @@ void MultiSync::removeMultiSyncPlugin(MultiSyncPlugin* p) {
 void MultiSync::ShutdownSync(void) {
     LogDebug(VB_SYNC, "ShutdownSync()\n");
 
+    MultiSyncStream::INSTANCE.Shutdown();
+
     for (auto a : m_plugins) {
         a->ShutdownSync();
     }
@@ -2081,6 +2294,8 @@ static bool shouldSkipPacket(int i, int num, std::vector<unsigned char*>& rcvBuf
             if (spkt->fileType == snpkt->fileType && spkt->pktType == snpkt->pktType) {
                 return true;
             }
+        } else if (pkt->pktType == npkt->pktType && pkt->pktType == CTRL_PKT_SYNC_V2) {
+            return true;
         }
     }
     return false;
@@ -2096,6 +2311,7 @@ void MultiSync::ProcessControlPacket(bool pingOnly) {
 
     int msgcnt = recvmmsg(m_receiveSock, rcvMsgs, MAX_MS_RCV_MSG, MSG_DONTWAIT, nullptr);
     while (msgcnt > 0) {
+        int64_t rcvTime = GetMonotonicTime();
         std::vector<unsigned char*> v;
         for (int msg = 0; msg < msgcnt; msg++) {
             int len = rcvMsgs[msg].msg_len;
@@ -2210,6 +2426,10 @@ void MultiSync::ProcessControlPacket(bool pingOnly) {
                     if (getFPPmode() == REMOTE_MODE)
                         ProcessSyncPacket(pkt, len, stats);
                     break;
+                case CTRL_PKT_SYNC_V2:
+                    if (getFPPmode() == REMOTE_MODE)
+                        ProcessSyncV2Packet(pkt, len, stats);
+                    break;
                 case CTRL_PKT_BLANK:
                     if (getFPPmode() == REMOTE_MODE) {
                         stats->pktBlank++;
@@ -2225,6 +2445,9 @@ void MultiSync::ProcessControlPacket(bool pingOnly) {
                 case CTRL_PKT_FPPCOMMAND:
                     ProcessFPPCommandPacket(pkt, len, stats);
                     break;
+                case CTRL_PKT_TIMESYNC:
+                    ProcessTimeSyncPacket(pkt, len, sourceIP, rcvTime, stats);
+                    break;
                 }
             }
         }
@@ -2332,14 +2555,24 @@ void MultiSync::SyncPlaylistToMS(uint64_t ms, int pos, const std::string& pl, bo
 /*
  *
  */
-void MultiSync::SyncSyncedSequence(const char* filename, int frameNumber, float secondsElapsed) {
-    LogExcess(VB_SYNC, "SyncSyncedSequence('%s', %d, %.2f)\n",
-              filename, frameNumber, secondsElapsed);
+void MultiSync::SyncSyncedSequence(const char* filename, int frameNumber, float secondsElapsed, int64_t frameTime) {
+    LogExcess(VB_SYNC, "SyncSyncedSequence('%s', %d, %.2f, %lld)\n",
+              filename, frameNumber, secondsElapsed, (long long)frameTime);
 
     if (!sequence->IsSequenceRunning(filename) && !sequence->IsSequenceRunning("fallback.fseq")) {
         sequence->StartSequence(filename, frameNumber);
     }
     if (sequence->IsSequenceRunning(filename)) {
+        SyncRunningSequence(frameNumber, secondsElapsed, frameTime);
+    }
+}
+
+void MultiSync::SyncRunningSequence(int frameNumber, float secondsElapsed, int64_t frameTime) {
+    if (frameTime) {
+        // The master told us when it output this frame, schedule our
+        // output against that rather than the frame/seconds position
+        UpdateMasterTimeline(frameNumber, frameTime);
+    } else {
         if (secondsElapsed > 0.0001f) {
             //recalculate the frame number based on the seconds
             float step = sequence->GetSeqStepTime();
@@ -2406,7 +2639,7 @@ void MultiSync::ProcessSyncPacket(ControlPkt* pkt, int len, MultiSyncStats* stat
         return;
     }
 
-    m_syncMaster = stats->sourceIP;
+    SetSyncMaster(stats->sourceIP);
 
     SyncPkt* spkt = (SyncPkt*)(((char*)pkt) + sizeof(ControlPkt));
 
@@ -2416,28 +2649,62 @@ void MultiSync::ProcessSyncPacket(ControlPkt* pkt, int len, MultiSyncStats* stat
     float secondsElapsed = 0.0;
 
     if (spkt->fileType == SYNC_FILE_SEQ) {
+        // Channel data only comes from the master's stream while frames
+        // for this sequence are actually arriving, otherwise play our copy
+        bool streaming = false;
+        if (MultiSyncStream::INSTANCE.IsReceiving(m_boundSeqId) && (m_boundSeqFilename == spkt->filename))
+            streaming = (spkt->pktType == SYNC_PKT_START) || (spkt->pktType == SYNC_PKT_SYNC);
+
         switch (spkt->pktType) {
         case SYNC_PKT_OPEN:
             OpenSyncedSequence(spkt->filename);
+            BindSyncSequenceId(spkt, pkt->extraDataLen);
             stats->pktSyncSeqOpen++;
             break;
+        case SYNC_PKT_PREPARE:
+            sequence->PrefetchSequenceFile(spkt->filename);
+            break;
         case SYNC_PKT_START:
-            StartSyncedSequence(spkt->filename);
+            if (!streaming)
+                StartSyncedSequence(spkt->filename);
+            BindSyncSequenceId(spkt, pkt->extraDataLen);
             stats->pktSyncSeqStart++;
             break;
         case SYNC_PKT_STOP:
             StopSyncedSequence(spkt->filename);
+            if (m_boundSeqFilename == spkt->filename)
+                m_boundSeqId = 0;
             stats->pktSyncSeqStop++;
             break;
-        case SYNC_PKT_SYNC:
+        case SYNC_PKT_SYNC: {
+            // the master re-announces the ID periodically for remotes
+            // which missed the OPEN/START
+            SyncPktSequenceId* ext = (SyncPktSequenceId*)GetSyncExtension(spkt, pkt->extraDataLen,
+                                                                          SYNC_PKT_EXT_SEQUENCE_ID,
+                                                                          sizeof(SyncPktSequenceId));
+            if (ext && ((ext->sequenceId != m_boundSeqId) || (m_boundSeqFilename != spkt->filename)))
+                BindSyncSequenceId(spkt, pkt->extraDataLen);
+
+            if (streaming) {
+                SkipStreamedSequence(spkt->filename);
+                stats->pktSyncSeqSync++;
+                break;
+            }
+
             secondsElapsed = spkt->secondsElapsed - m_remoteOffset;
             if (secondsElapsed < 0)
                 secondsElapsed = 0.0;
 
+            int64_t frameTime = GetSyncTimestamp(spkt, pkt->extraDataLen);
+            if (frameTime)
+                frameTime += (int64_t)(m_remoteOffset * 1000000);
+
             SyncSyncedSequence(spkt->filename,
-                               spkt->frameNumber, secondsElapsed);
+                               spkt->frameNumber, secondsElapsed, frameTime);
             stats->pktSyncSeqSync++;
-            break;
+
+            CheckTimeSync();
+        } break;
         }
     } else if (spkt->fileType == SYNC_FILE_MEDIA) {
         switch (spkt->pktType) {
@@ -2445,6 +2712,9 @@ void MultiSync::ProcessSyncPacket(ControlPkt* pkt, int len, MultiSyncStats* stat
             OpenSyncedMedia(spkt->filename);
             stats->pktSyncMedOpen++;
             break;
+        case SYNC_PKT_PREPARE:
+            PrefetchMediaFile(spkt->filename);
+            break;
         case SYNC_PKT_START:
             StartSyncedMedia(spkt->filename);
             stats->pktSyncMedStart++;
@@ -2466,6 +2736,224 @@ void MultiSync::ProcessSyncPacket(ControlPkt* pkt, int len, MultiSyncStats* stat
     }
 }
 
+/*
+ * Compact sync packet keyed by the sequence ID from the last OPEN/START
+ * packet.  While the locally open sequence is the one that was matched to
+ * that ID this does not need to look up the sequence by name or take the
+ * sequence lock.
+ */
+void MultiSync::ProcessSyncV2Packet(ControlPkt* pkt, int len, MultiSyncStats* stats) {
+    if (pkt->extraDataLen < sizeof(SyncPktV2)) {
+        LogErr(VB_SYNC, "Error: Invalid length of received v2 sync packet\n");
+        HexDump("Received data:", (void*)&pkt, len, VB_SYNC);
+        stats->pktError++;
+        return;
+    }
+
+    SetSyncMaster(stats->sourceIP);
+
+    SyncPktV2* spkt = (SyncPktV2*)(((char*)pkt) + sizeof(ControlPkt));
+
+    LogExcess(VB_SYNC, "ProcessSyncV2Packet()   id: %llu    type: %d   frameNumber: %d   secondsElapsed: %0.2f\n",
+              (unsigned long long)spkt->sequenceId, spkt->pktType, spkt->frameNumber, spkt->secondsElapsed);
+
+    if (spkt->pktType != SYNC_PKT_SYNC)
+        return;
+
+    stats->pktSyncSeqSync++;
+
+    if (spkt->sequenceId && (spkt->sequenceId == m_boundSeqId) &&
+        MultiSyncStream::INSTANCE.IsReceiving(spkt->sequenceId)) {
+        SkipStreamedSequence(m_boundSeqFilename);
+        return;
+    }
+
+    if (!spkt->sequenceId || (spkt->sequenceId != m_boundSeqId)) {
+        // Missed the OPEN/START, the master re-announces the ID in a
+        // filename based sync packet once a second
+        LogExcess(VB_SYNC, "Ignoring sync for unknown sequence ID %llu\n",
+                  (unsigned long long)spkt->sequenceId);
+        return;
+    }
+
+    float secondsElapsed = spkt->secondsElapsed - m_remoteOffset;
+    if (secondsElapsed < 0)
+        secondsElapsed = 0.0;
+
+    int64_t frameTime = MasterTimeToLocal(spkt->masterTime);
+    if (frameTime)
+        frameTime += (int64_t)(m_remoteOffset * 1000000);
+
+    uint32_t generation = sequence->GetSequenceGeneration();
+    if (generation && (generation == m_boundSeqGeneration) && sequence->IsSequenceRunning()) {
+        SyncRunningSequence(spkt->frameNumber, secondsElapsed, frameTime);
+    } else {
+        // Not started yet, or a different file was opened locally since
+        // the ID was bound, go through the filename based path
+        SyncSyncedSequence(m_boundSeqFilename.c_str(), spkt->frameNumber, secondsElapsed, frameTime);
+        m_boundSeqGeneration = sequence->GetSequenceGeneration(m_boundSeqFilename);
+    }
+
+    CheckTimeSync();
+}
+
+/*
+ * Remember the sequence ID the master sent with an OPEN/START packet and
+ * which local Sequence generation it refers to
+ */
+void MultiSync::BindSyncSequenceId(SyncPkt* spkt, int extraDataLen) {
+    SyncPktSequenceId* ext = (SyncPktSequenceId*)GetSyncExtension(spkt, extraDataLen,
+                                                                  SYNC_PKT_EXT_SEQUENCE_ID,
+                                                                  sizeof(SyncPktSequenceId));
+    if (!ext) {
+        m_boundSeqId = 0;
+        return;
+    }
+
+    m_boundSeqId = ext->sequenceId;
+    m_boundSeqFilename = spkt->filename;
+    m_boundSeqGeneration = sequence->GetSequenceGeneration(m_boundSeqFilename);
+
+    LogDebug(VB_SYNC, "Bound sequence ID %llu to '%s' (generation %u)\n",
+             (unsigned long long)m_boundSeqId, m_boundSeqFilename.c_str(), m_boundSeqGeneration);
+}
+
+/*
+ * Frames for the bound sequence are arriving in the master's stream, stop
+ * a local copy started before the stream caught up and only keep the
+ * clock estimate up to date
+ */
+void MultiSync::SkipStreamedSequence(const std::string& filename) {
+    if (sequence->IsSequenceRunning(filename)) {
+        LogDebug(VB_SYNC, "Channel data for '%s' is being streamed, stopping local playback\n", filename.c_str());
+        sequence->CloseIfOpen(filename);
+    }
+    CheckTimeSync();
+}
+
+void MultiSync::SetSyncMaster(const std::string& address) {
+    if (m_syncMaster == address)
+        return;
+
+    m_masterClock.Reset();
+    m_syncMaster = address;
+    m_boundSeqId = 0;
+}
+
+void MultiSync::CheckTimeSync(void) {
+    int64_t now = GetMonotonicTime();
+    int interval = (m_masterClock.SampleCount() < 4) ? 250000 : 1000000;
+    if ((now - m_lastTimeSyncRequest) > interval)
+        SendTimeSyncRequest();
+}
+
+/*
+ * Find an extension following the filename in a sync packet
+ */
+SyncPktExt* MultiSync::GetSyncExtension(SyncPkt* spkt, int extraDataLen, uint8_t extType, int minLen) {
+    int maxLen = extraDataLen - (sizeof(SyncPkt) - 1);
+    int offset = strnlen(spkt->filename, maxLen) + 1;
+
+    while ((offset + (int)sizeof(SyncPktExt)) <= maxLen) {
+        SyncPktExt* ext = (SyncPktExt*)(spkt->filename + offset);
+        if ((ext->extLen < sizeof(SyncPktExt)) || ((offset + ext->extLen) > maxLen))
+            break;
+
+        if ((ext->extType == extType) && (ext->extLen >= minLen))
+            return ext;
+
+        offset += ext->extLen;
+    }
+
+    return nullptr;
+}
+
+/*
+ * Returns the local time the master output the frame in a sync packet, or
+ * 0 if the packet has no timestamp or the master clock is not known yet
+ */
+int64_t MultiSync::GetSyncTimestamp(SyncPkt* spkt, int extraDataLen) {
+    SyncPktTimestamp* ext = (SyncPktTimestamp*)GetSyncExtension(spkt, extraDataLen,
+                                                                SYNC_PKT_EXT_TIMESTAMP,
+                                                                sizeof(SyncPktTimestamp));
+    if (!ext)
+        return 0;
+
+    return MasterTimeToLocal(ext->masterTime);
+}
+
+int64_t MultiSync::MasterTimeToLocal(uint64_t masterTime) {
+    if (!m_masterClock.IsValid())
+        return 0;
+
+    return m_masterClock.MasterToLocal(masterTime);
+}
+
+void MultiSync::SendTimeSyncRequest(void) {
+    if (m_syncMaster.empty())
+        return;
+
+    char outBuf[sizeof(ControlPkt) + sizeof(TimeSyncPkt)];
+    bzero(outBuf, sizeof(outBuf));
+
+    ControlPkt* cpkt = (ControlPkt*)outBuf;
+    TimeSyncPkt* tpkt = (TimeSyncPkt*)(outBuf + sizeof(ControlPkt));
+
+    InitControlPacket(cpkt);
+
+    cpkt->pktType = CTRL_PKT_TIMESYNC;
+    cpkt->extraDataLen = sizeof(TimeSyncPkt);
+
+    tpkt->pktType = TIMESYNC_PKT_REQUEST;
+    m_lastTimeSyncRequest = GetMonotonicTime();
+    tpkt->originTime = m_lastTimeSyncRequest;
+
+    SendUnicastPacket(m_syncMaster, outBuf, sizeof(outBuf));
+}
+
+void MultiSync::ProcessTimeSyncPacket(ControlPkt* pkt, int len, const std::string& srcIp, int64_t rcvTime, MultiSyncStats* stats) {
+    if (pkt->extraDataLen < sizeof(TimeSyncPkt)) {
+        LogErr(VB_SYNC, "Error: Invalid length of received time sync packet\n");
+        HexDump("Received data:", (void*)&pkt, len, VB_SYNC);
+        stats->pktError++;
+        return;
+    }
+
+    stats->pktTimeSync++;
+
+    TimeSyncPkt* tpkt = (TimeSyncPkt*)(((char*)pkt) + sizeof(ControlPkt));
+
+    if (tpkt->pktType == TIMESYNC_PKT_REQUEST) {
+        // Only the master answers, remotes may see each other's requests
+        if (!m_multiSyncEnabled)
+            return;
+
+        char outBuf[sizeof(ControlPkt) + sizeof(TimeSyncPkt)];
+        bzero(outBuf, sizeof(outBuf));
+
+        ControlPkt* cpkt = (ControlPkt*)outBuf;
+        TimeSyncPkt* rpkt = (TimeSyncPkt*)(outBuf + sizeof(ControlPkt));
+
+        InitControlPacket(cpkt);
+
+        cpkt->pktType = CTRL_PKT_TIMESYNC;
+        cpkt->extraDataLen = sizeof(TimeSyncPkt);
+
+        rpkt->pktType = TIMESYNC_PKT_RESPONSE;
+        rpkt->originTime = tpkt->originTime;
+        rpkt->receiveTime = rcvTime;
+        rpkt->transmitTime = GetMonotonicTime();
+
+        SendUnicastPacket(srcIp, outBuf, sizeof(outBuf));
+    } else if (tpkt->pktType == TIMESYNC_PKT_RESPONSE) {
+        if ((getFPPmode() != REMOTE_MODE) || (srcIp != m_syncMaster))
+            return;
+
+        m_masterClock.AddSample(tpkt->originTime, tpkt->receiveTime,
+                                tpkt->transmitTime, rcvTime);
+    }
+}
+
 /*
  *
  */
@@ -2569,12 +3057,24 @@ void MultiSync::ProcessPingPacket(ControlPkt* pkt, int len, const std::string& s
         }
     }
 
+    // v3 pings from newer systems carry capability flags in a byte which
+    // older systems leave zeroed
+    uint8_t syncCapabilities = 0;
+    if ((pingVersion >= 3) && (pkt->extraDataLen > 280))
+        syncCapabilities = extraData[280];
+
     if (isInstance) {
         std::string localUUID(isLocal ? getSetting("SystemUUID") : "Unknown");
         multiSync->UpdateSystem(type, majorVersion, minorVersion,
                                 systemMode, address, hostname, version,
                                 typeStr, ranges, localUUID.c_str(), true,
                                 systemMode & 0x04 ? true : false);
+
+        std::unique_lock<std::recursive_mutex> slock(m_systemsLock);
+        for (auto& sys : m_remoteSystems) {
+            if ((sys.address == address) && (sys.hostname == hostname))
+                sys.syncCapabilities = syncCapabilities;
+        }
     }
     if (discover) {
         lock.unlock();
@@ -2695,6 +3195,158 @@ void MultiSync::SendFPPCommandPacket(const std::string& host, const std::string&
     }
 }
 
+/////////////////////////////////////////////////////////////////////////////
+
+// Number of round trip samples kept for the offset/skew estimate
+#define MAX_CLOCK_SAMPLES 16
+// Offset jump which indicates the master's clock was reset (reboot, etc.)
+#define CLOCK_RESET_THRESHOLD 50000
+// Largest skew we believe, anything more is noise from a short sample window
+#define MAX_CLOCK_SKEW 0.0005
+
+MultiSyncClock::MultiSyncClock() :
+    m_valid(false),
+    m_refTime(0),
+    m_offset(0.0),
+    m_skew(0.0),
+    m_delay(0) {
+}
+
+void MultiSyncClock::Reset(void) {
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_samples.clear();
+    m_valid = false;
+    m_refTime = 0;
+    m_offset = 0.0;
+    m_skew = 0.0;
+    m_delay = 0;
+}
+
+void MultiSyncClock::AddSample(int64_t originTime, int64_t receiveTime,
+                               int64_t transmitTime, int64_t responseTime) {
+    ClockSample sample;
+    sample.localTime = responseTime;
+    sample.offset = ((receiveTime - originTime) + (transmitTime - responseTime)) / 2;
+    sample.delay = (responseTime - originTime) - (transmitTime - receiveTime);
+    if (sample.delay < 0)
+        sample.delay = 0;
+
+    std::unique_lock<std::mutex> lock(m_lock);
+    if (m_valid && (std::abs(sample.offset - (int64_t)m_offset) > CLOCK_RESET_THRESHOLD) &&
+        (sample.delay < CLOCK_RESET_THRESHOLD)) {
+        LogInfo(VB_SYNC, "Master clock offset jumped by %lldus, resetting clock estimate\n",
+                (long long)(sample.offset - (int64_t)m_offset));
+        m_samples.clear();
+        m_valid = false;
+    }
+
+    m_samples.push_back(sample);
+    if (m_samples.size() > MAX_CLOCK_SAMPLES)
+        m_samples.pop_front();
+
+    UpdateEstimate();
+
+    LogExcess(VB_SYNC, "Clock sample: offset %lldus, delay %lldus, estimate %.0fus, skew %.2fppm\n",
+              (long long)sample.offset, (long long)sample.delay, m_offset, m_skew * 1000000.0);
+}
+
+/*
+ * Samples with more network delay than the best recent sample were queued
+ * somewhere and have an asymmetric delay, so only the low delay samples are
+ * used.  With enough of those spread over time the skew is estimated with
+ * a least squares fit of offset against local time.
+ */
+void MultiSyncClock::UpdateEstimate(void) {
+    if (m_samples.size() < 3) {
+        m_valid = false;
+        return;
+    }
+
+    int64_t minDelay = m_samples.front().delay;
+    for (auto& s : m_samples) {
+        if (s.delay < minDelay)
+            minDelay = s.delay;
+    }
+    int64_t maxDelay = minDelay + (minDelay / 2) + 250;
+
+    std::vector<const ClockSample*> good;
+    const ClockSample* best = nullptr;
+    for (auto& s : m_samples) {
+        if (s.delay <= maxDelay)
+            good.push_back(&s);
+        if (!best || (s.delay < best->delay))
+            best = &s;
+    }
+
+    m_delay = minDelay;
+    m_refTime = best->localTime;
+    m_offset = best->offset;
+    m_skew = 0.0;
+
+    if ((good.size() >= 4) && ((good.back()->localTime - good.front()->localTime) >= 2000000)) {
+        m_refTime = good.back()->localTime;
+
+        double meanX = 0.0;
+        double meanY = 0.0;
+        for (auto s : good) {
+            meanX += s->localTime - m_refTime;
+            meanY += s->offset;
+        }
+        meanX /= good.size();
+        meanY /= good.size();
+
+        double cov = 0.0;
+        double var = 0.0;
+        for (auto s : good) {
+            double dx = (s->localTime - m_refTime) - meanX;
+            cov += dx * (s->offset - meanY);
+            var += dx * dx;
+        }
+
+        double skew = (var > 0.0) ? (cov / var) : 0.0;
+        if (std::abs(skew) <= MAX_CLOCK_SKEW) {
+            m_skew = skew;
+            m_offset = meanY - (skew * meanX);
+        } else {
+            m_offset = meanY;
+        }
+    }
+
+    m_valid = true;
+}
+
+bool MultiSyncClock::IsValid(void) {
+    std::unique_lock<std::mutex> lock(m_lock);
+    return m_valid;
+}
+
+int MultiSyncClock::SampleCount(void) {
+    std::unique_lock<std::mutex> lock(m_lock);
+    return m_samples.size();
+}
+
+int64_t MultiSyncClock::MasterToLocal(int64_t masterTime) {
+    std::unique_lock<std::mutex> lock(m_lock);
+    double local = masterTime - m_offset;
+    local = masterTime - (m_offset + (m_skew * (local - m_refTime)));
+    return (int64_t)local;
+}
+
+Json::Value MultiSyncClock::toJSON() {
+    std::unique_lock<std::mutex> lock(m_lock);
+    Json::Value result;
+
+    result["valid"] = m_valid;
+    result["samples"] = (int)m_samples.size();
+    result["offsetUS"] = (Json::Int64)m_offset;
+    result["skewPPM"] = m_skew * 1000000.0;
+    result["delayUS"] = (Json::Int64)m_delay;
+
+    return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
 MultiSyncStats::MultiSyncStats(std::string ip, std::string host) :
     sourceIP(ip),
     hostname(host),
@@ -2711,6 +3363,7 @@ MultiSyncStats::MultiSyncStats(std::string ip, std::string host) :
     pktPing(0),
     pktPlugin(0),
     pktFPPCommand(0),
+    pktTimeSync(0),
     pktError(0) {
     lastReceiveTime = time(NULL);
 }
@@ -2743,6 +3396,7 @@ Json::Value MultiSyncStats::toJSON() {
     result["pktPing"] = pktPing;
     result["pktPlugin"] = pktPlugin;
     result["pktFPPCommand"] = pktFPPCommand;
+    result["pktTimeSync"] = pktTimeSync;
     result["pktError"] = pktError;
 
     return result;
@@ -13,6 +13,7 @@
 
 #include <netinet/in.h>
 #include <sys/types.h>
+#include <deque>
 #include <mutex>
 #include <pthread.h>
 #include <set>
@@ -29,6 +30,8 @@
 #define CTRL_PKT_PING 4
 #define CTRL_PKT_PLUGIN 5
 #define CTRL_PKT_FPPCOMMAND 6
+#define CTRL_PKT_TIMESYNC 7
+#define CTRL_PKT_SYNC_V2 8
 
 typedef struct __attribute__((packed)) {
     char fppd[4];          // 'FPPD'
@@ -44,6 +47,7 @@ typedef struct {
 #define SYNC_PKT_STOP 1
 #define SYNC_PKT_SYNC 2
 #define SYNC_PKT_OPEN 3
+#define SYNC_PKT_PREPARE 4
 
 #define SYNC_FILE_SEQ 0
 #define SYNC_FILE_MEDIA 1
@@ -57,6 +61,55 @@ typedef struct __attribute__((packed)) {
                           // (data may continue past this header)
 } SyncPkt;
 
+// Optional extensions following the null terminating the SyncPkt filename.
+// Older remotes stop at the null and ignore them.
+#define SYNC_PKT_EXT_SEQUENCE_ID 0x49
+#define SYNC_PKT_EXT_TIMESTAMP 0x54
+
+typedef struct __attribute__((packed)) {
+    uint8_t extType; // Extension type
+    uint8_t extLen;  // Length of this extension including the type/len
+} SyncPktExt;
+
+typedef struct __attribute__((packed)) {
+    uint8_t extType;     // SYNC_PKT_EXT_SEQUENCE_ID
+    uint8_t extLen;      // Length of this extension including the type/len
+    uint64_t sequenceId; // ID used by CTRL_PKT_SYNC_V2 packets for this file
+} SyncPktSequenceId;
+
+typedef struct __attribute__((packed)) {
+    uint8_t extType;     // SYNC_PKT_EXT_TIMESTAMP
+    uint8_t extLen;      // Length of this extension including the type/len
+    uint64_t masterTime; // Master monotonic time (us) the frame was output
+} SyncPktTimestamp;
+
+// Compact fixed size sync packet for the sequence announced in the last
+// OPEN/START (or periodic filename based SYNC) packet with a
+// SYNC_PKT_EXT_SEQUENCE_ID extension
+typedef struct __attribute__((packed)) {
+    uint8_t version;      // 2
+    uint8_t pktType;      // SYNC_PKT_SYNC
+    uint64_t sequenceId;  // Sequence ID from the OPEN/START packet
+    uint32_t frameNumber; // Sequence frames displayed on Master
+    float secondsElapsed; // Seconds elapsed in file on Master
+    uint64_t masterTime;  // Master monotonic time (us) the frame was output
+} SyncPktV2;
+
+// Capability flags sent in the spare byte at the end of v3 ping packets
+#define MULTISYNC_CAP_SYNC_V2 0x01
+#define MULTISYNC_CAP_STREAM 0x02 // Remote wants channel data streamed to it
+
+#define TIMESYNC_PKT_REQUEST 0
+#define TIMESYNC_PKT_RESPONSE 1
+
+// NTP style round trip used by remotes to estimate the master clock offset
+typedef struct __attribute__((packed)) {
+    uint8_t pktType;       // Request or Response
+    uint64_t originTime;   // Remote time the request was sent
+    uint64_t receiveTime;  // Master time the request was received
+    uint64_t transmitTime; // Master time the response was sent
+} TimeSyncPkt;
+
 typedef enum systemType {
     kSysTypeUnknown = 0x00,
     kSysTypeFPP = 0x01,
@@ -125,6 +178,7 @@ public:
     std::string model;
     std::string ranges;
     std::string uuid;
+    uint8_t syncCapabilities = 0;
     unsigned char ipa = 0;
     unsigned char ipb = 0;
     unsigned char ipc = 0;
@@ -166,9 +220,46 @@ public:
     uint32_t pktPing;
     uint32_t pktPlugin;
     uint32_t pktFPPCommand;
+    uint32_t pktTimeSync;
     uint32_t pktError;
 };
 
+/*
+ * Estimate of the offset and skew between the local monotonic clock and
+ * the sync master's monotonic clock, built from TimeSyncPkt round trips
+ */
+class MultiSyncClock {
+public:
+    MultiSyncClock();
+
+    void Reset(void);
+    void AddSample(int64_t originTime, int64_t receiveTime,
+                   int64_t transmitTime, int64_t responseTime);
+
+    bool IsValid(void);
+    int SampleCount(void);
+    int64_t MasterToLocal(int64_t masterTime);
+
+    Json::Value toJSON();
+
+private:
+    void UpdateEstimate(void);
+
+    typedef struct {
+        int64_t localTime; // Local time the sample was taken
+        int64_t offset;    // master - local
+        int64_t delay;     // Round trip network delay
+    } ClockSample;
+
+    std::mutex m_lock;
+    std::deque<ClockSample> m_samples;
+    bool m_valid;
+    int64_t m_refTime;
+    double m_offset;
+    double m_skew;
+    int64_t m_delay;
+};
+
 class MultiSyncPlugin {
 public:
     MultiSyncPlugin() {}
@@ -231,6 +322,8 @@ public:
                       const bool sendingMultiSync);
 
     Json::Value GetSystems(bool localOnly = false, bool timestamps = true);
+    std::string GetLocalRanges(void);
+    std::set<std::string> GetStreamingRemoteRanges(void);
     Json::Value GetSyncStats();
     void ResetSyncStats();
 
@@ -239,13 +332,15 @@ public:
     void Discover(void);
     void PeriodicPing();
 
-    void SendSeqOpenPacket(const std::string& filename);
+    void SendSeqOpenPacket(const std::string& filename, uint64_t sequenceId = 0);
+    void SendSeqPreparePacket(const std::string& filename);
     void SendSeqSyncStartPacket(const std::string& filename);
     void SendSeqSyncStopPacket(const std::string& filename);
     void SendSeqSyncPacket(const std::string& filename, int frames, float seconds);
     void ShutdownSync(void);
 
     void SendMediaOpenPacket(const std::string& filename);
+    void SendMediaPreparePacket(const std::string& filename);
     void SendMediaSyncStartPacket(const std::string& filename);
     void SendMediaSyncStopPacket(const std::string& filename);
     void SendMediaSyncPacket(const std::string& filename, float seconds);
@@ -261,7 +356,7 @@ public:
     void OpenSyncedSequence(const char* filename);
     void StartSyncedSequence(const char* filename);
     void StopSyncedSequence(const char* filename);
-    void SyncSyncedSequence(const char* filename, int frameNumber, float secondsElapsed);
+    void SyncSyncedSequence(const char* filename, int frameNumber, float secondsElapsed, int64_t frameTime = 0);
 
     void OpenSyncedMedia(const char* filename);
     void StartSyncedMedia(const char* filename);
@@ -272,6 +367,8 @@ public:
     void SyncPlaylistToMS(uint64_t ms, int pos, const std::string& pl = "", bool sendSyncPackets = false);
     void SyncStopAll();
 
+    int64_t MasterTimeToLocal(uint64_t masterTime);
+
     int OpenControlSockets();
 
     static std::string GetTypeString(MultiSyncSystemType type, bool local = false);
@@ -299,6 +396,7 @@ private:
     bool RemoveInterface(const std::string& interface);
 
     void InitControlPacket(ControlPkt* pkt);
+    void SendPreparePacket(int fileType, const std::string& filename);
 
     int OpenReceiveSocket(void);
 
@@ -307,10 +405,25 @@ private:
     void DiscoverIPViaHTTP(const std::string& ip, bool allowUnknown = false);
 
     void ProcessSyncPacket(ControlPkt* pkt, int len, MultiSyncStats* stats);
+    void ProcessSyncV2Packet(ControlPkt* pkt, int len, MultiSyncStats* stats);
     void ProcessCommandPacket(ControlPkt* pkt, int len, MultiSyncStats* stats);
     void ProcessPingPacket(ControlPkt* pkt, int len, const std::string& src, MultiSyncStats* stats);
     void ProcessPluginPacket(ControlPkt* pkt, int len, MultiSyncStats* stats);
     void ProcessFPPCommandPacket(ControlPkt* pkt, int len, MultiSyncStats* stats);
+    void ProcessTimeSyncPacket(ControlPkt* pkt, int len, const std::string& src, int64_t rcvTime, MultiSyncStats* stats);
+
+    void SendTimeSyncRequest(void);
+    void SetSyncMaster(const std::string& address);
+    void CheckTimeSync(void);
+    SyncPktExt* GetSyncExtension(SyncPkt* spkt, int extraDataLen, uint8_t extType, int minLen);
+    int64_t GetSyncTimestamp(SyncPkt* spkt, int extraDataLen);
+    void BindSyncSequenceId(SyncPkt* spkt, int extraDataLen);
+    void SyncRunningSequence(int frameNumber, float secondsElapsed, int64_t frameTime);
+    void SkipStreamedSequence(const std::string& filename);
+
+    int AddSyncTimestamp(char* outBuf, int len);
+    int AddSyncSequenceId(char* outBuf, int len, const std::string& filename);
+    bool RemotesSupportSyncV2(void);
 
     std::recursive_mutex m_systemsLock;
     std::vector<MultiSyncSystem> m_localSystems;
@@ -357,6 +470,25 @@ private:
     std::recursive_mutex m_statsLock;
     std::map<std::string, MultiSyncStats*> m_syncStats;
     std::string m_syncMaster;
+    MultiSyncClock m_masterClock;
+    int64_t m_lastTimeSyncRequest = 0;
+
+    // Master side, ID of the open sequence and whether every remote
+    // understands CTRL_PKT_SYNC_V2
+    std::mutex m_syncSeqLock;
+    std::string m_syncSeqFilename;
+    uint64_t m_syncSeqId = 0;
+    bool m_syncV2 = false;
+    int64_t m_lastSyncV2Check = 0;
+    int64_t m_lastSyncV2Announce = 0;
+
+    // Remote side, only used from the control packet receive loop.
+    // m_boundSeqGeneration is the local Sequence generation that the
+    // master's m_boundSeqId was matched to.
+    std::string m_boundSeqFilename;
+    uint64_t m_boundSeqId = 0;
+    uint32_t m_boundSeqGeneration = 0;
+
     bool m_multiSyncEnabled = false;
 };
 
@@ -0,0 +1,756 @@
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include "fpp-pch.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <zstd.h>
+
+#include "MultiSync.h"
+#include "MultiSyncStream.h"
+#include "Sequence.h"
+#include "common.h"
+#include "log.h"
+#include "settings.h"
+#include "channeloutput/channeloutputthread.h"
+#include "fseq/FSEQFile.h"
+
+#define STREAM_MULTICAST_ADDRESS "239.70.80.80"
+
+// Bridge data from the stream expires if the master stops sending
+#define STREAM_BRIDGE_EXPIRE_MS 1000
+
+// Local playback only takes over again once no frame of the stream has
+// been decoded for this long
+#define STREAM_ACTIVE_US 1000000
+
+// Frames more than this late are dropped rather than output
+#define STREAM_MAX_LATE_US 100000
+
+#define STREAM_MAX_BUFFERED_FRAMES 400
+
+#define STREAM_RCV_BATCH 32
+
+MultiSyncStream MultiSyncStream::INSTANCE;
+
+MultiSyncStream::MultiSyncStream() :
+    m_running(false),
+    m_activeStreamId(0),
+    m_lastFrameTime(0),
+    m_framesSent(0),
+    m_keyframesSent(0),
+    m_bytesSent(0),
+    m_framesReceived(0),
+    m_framesDropped(0),
+    m_framesLate(0),
+    m_framesPresented(0),
+    m_bufferedFrames(0) {
+    memset(&m_destAddr, 0, sizeof(m_destAddr));
+    memset(&m_assemblyHeader, 0, sizeof(m_assemblyHeader));
+}
+
+MultiSyncStream::~MultiSyncStream() {
+    Shutdown();
+}
+
+void MultiSyncStream::Init(void) {
+    if (!getSettingInt("MultiSyncStreaming"))
+        return;
+
+    m_leadMS = getSettingInt("MultiSyncStreamLead", 500);
+    if (m_leadMS < 100)
+        m_leadMS = 100;
+
+    m_destAddr.sin_family = AF_INET;
+    m_destAddr.sin_port = htons(FPP_STREAM_PORT);
+    m_destAddr.sin_addr.s_addr = inet_addr(STREAM_MULTICAST_ADDRESS);
+
+    if (getFPPmode() == REMOTE_MODE) {
+        m_sock = OpenSocket(true);
+        if (m_sock < 0)
+            return;
+
+        m_dctx = ZSTD_createDCtx();
+        m_receiving = true;
+        m_running = true;
+        m_receiveThread = new std::thread(&MultiSyncStream::ReceiveThread, this);
+        LogInfo(VB_SYNC, "Receiving MultiSync channel data stream on port %d\n", FPP_STREAM_PORT);
+    } else if (multiSync->isMultiSyncEnabled()) {
+        m_sock = OpenSocket(false);
+        if (m_sock < 0)
+            return;
+
+        m_cctx = ZSTD_createCCtx();
+        LogInfo(VB_SYNC, "MultiSync channel data streaming enabled, %dms lead\n", m_leadMS);
+    }
+}
+
+void MultiSyncStream::Shutdown(void) {
+    StopStream();
+
+    if (m_receiveThread) {
+        m_running = false;
+        m_receiveThread->join();
+        delete m_receiveThread;
+        m_receiveThread = nullptr;
+    }
+    m_receiving = false;
+
+    if (m_sock >= 0) {
+        close(m_sock);
+        m_sock = -1;
+    }
+    if (m_cctx) {
+        ZSTD_freeCCtx(m_cctx);
+        m_cctx = nullptr;
+    }
+    if (m_dctx) {
+        ZSTD_freeDCtx(m_dctx);
+        m_dctx = nullptr;
+    }
+}
+
+int MultiSyncStream::OpenSocket(bool receive) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        LogErr(VB_SYNC, "Error opening stream socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (receive) {
+        int enable = 1;
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+        // room for the full lead time of frames if the thread stalls
+        int bufSize = 4 * 1024 * 1024;
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(FPP_STREAM_PORT);
+        if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            LogErr(VB_SYNC, "Error binding stream socket: %s\n", strerror(errno));
+            close(sock);
+            return -1;
+        }
+
+        struct ip_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        mreq.imr_multiaddr.s_addr = inet_addr(STREAM_MULTICAST_ADDRESS);
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            LogWarn(VB_SYNC, "Could not join stream multicast group: %s\n", strerror(errno));
+        }
+    } else {
+        int bufSize = 4 * 1024 * 1024;
+        setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof(bufSize));
+
+        char loop = 0;
+        setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    }
+
+    return sock;
+}
+
+/*
+ * FNV-1a hash of a ping style range string ("0-455,512-1024"), both sides
+ * hash the string the remote sends in its ping so they agree on the ID
+ */
+uint32_t MultiSyncStream::GetGroupId(const std::string& ranges) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : ranges) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> MultiSyncStream::ParseRanges(const std::string& ranges) {
+    std::vector<std::pair<uint32_t, uint32_t>> result;
+    for (auto& r : split(ranges, ',')) {
+        size_t dash = r.find('-');
+        if (dash == std::string::npos)
+            continue;
+
+        uint32_t start = std::strtoul(r.substr(0, dash).c_str(), nullptr, 10);
+        uint32_t end = std::strtoul(r.substr(dash + 1).c_str(), nullptr, 10);
+        if ((end < start) || (end >= FPPD_MAX_CHANNELS))
+            continue;
+
+        result.emplace_back(start, end - start + 1);
+    }
+    return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Master
+
+void MultiSyncStream::StartStream(const std::string& filename, uint64_t streamId, uint32_t startFrame) {
+    if (!m_cctx || !streamId)
+        return;
+
+    StopStream();
+
+    FSEQFile* seqFile = FSEQFile::openFSEQFile(filename);
+    if (!seqFile) {
+        LogErr(VB_SYNC, "Could not open %s for streaming\n", filename.c_str());
+        return;
+    }
+
+    LogDebug(VB_SYNC, "StartStream(%s, %llu, %u)\n", filename.c_str(),
+             (unsigned long long)streamId, startFrame);
+
+    std::unique_lock<std::mutex> lock(m_sendLock);
+    m_seqFile = seqFile;
+    m_streamId = streamId;
+    m_startFrame = startFrame;
+    m_nextFrame = startFrame;
+    // frame times are only known once playback begins
+    m_streamStartTime = 0;
+    m_frameBuf.resize(seqFile->getChannelCount());
+    m_groups.clear();
+    m_lastGroupCheck = 0;
+    UpdateGroups();
+
+    m_running = true;
+    m_sendThread = new std::thread(&MultiSyncStream::SendThread, this);
+}
+
+void MultiSyncStream::StopStream(void) {
+    if (!m_sendThread)
+        return;
+
+    std::unique_lock<std::mutex> lock(m_sendLock);
+    m_running = false;
+    lock.unlock();
+    m_sendCond.notify_all();
+
+    m_sendThread->join();
+    delete m_sendThread;
+    m_sendThread = nullptr;
+
+    SendStopPacket();
+
+    delete m_seqFile;
+    m_seqFile = nullptr;
+    m_streamId = 0;
+    m_groups.clear();
+}
+
+/*
+ * The sequence may be opened well before it is started (prefetch, start
+ * delays), so the frame times are based on when playback really begins
+ */
+void MultiSyncStream::StartPlayback(void) {
+    std::unique_lock<std::mutex> lock(m_sendLock);
+    if (!m_sendThread)
+        return;
+
+    m_streamStartTime = GetMonotonicTime();
+    lock.unlock();
+    m_sendCond.notify_all();
+}
+
+/*
+ * Build the list of range groups from the remotes which have asked for
+ * the stream.  Remotes with identical ranges share a group.
+ */
+void MultiSyncStream::UpdateGroups(void) {
+    m_lastGroupCheck = GetMonotonicTime();
+
+    std::set<std::string> rangeStrs = multiSync->GetStreamingRemoteRanges();
+
+    for (auto it = m_groups.begin(); it != m_groups.end();) {
+        if (rangeStrs.find(it->rangeStr) == rangeStrs.end()) {
+            LogDebug(VB_SYNC, "Removing stream group %08x (%s)\n", it->groupId, it->rangeStr.c_str());
+            it = m_groups.erase(it);
+        } else {
+            rangeStrs.erase(it->rangeStr);
+            ++it;
+        }
+    }
+
+    uint32_t channelCount = m_frameBuf.size();
+    std::vector<std::pair<uint32_t, uint32_t>> readRanges;
+    for (auto& rangeStr : rangeStrs) {
+        StreamGroup& g = m_groups.emplace_back();
+        g.rangeStr = rangeStr;
+        g.groupId = GetGroupId(rangeStr);
+        for (auto& r : ParseRanges(rangeStr)) {
+            if (r.first >= channelCount)
+                continue;
+            if ((r.first + r.second) > channelCount)
+                r.second = channelCount - r.first;
+            g.ranges.push_back(r);
+            g.rawLen += r.second;
+        }
+        g.current.resize(g.rawLen);
+        g.delta.resize(g.rawLen);
+        g.compressed.resize(ZSTD_compressBound(g.rawLen));
+
+        memset(&g.header, 0, sizeof(g.header));
+        memcpy(g.header.fpps, "FPPS", 4);
+        g.header.version = 1;
+        g.header.pktType = STREAM_PKT_FRAME;
+        g.header.groupId = g.groupId;
+        g.header.streamId = m_streamId;
+
+        LogDebug(VB_SYNC, "Added stream group %08x (%s), %u channels\n",
+                 g.groupId, g.rangeStr.c_str(), g.rawLen);
+    }
+
+    for (auto& g : m_groups)
+        readRanges.insert(readRanges.end(), g.ranges.begin(), g.ranges.end());
+
+    // Only decompress the blocks some remote needs, the stream has its
+    // own file handle so this does not affect local playback
+    if (!readRanges.empty())
+        m_seqFile->prepareRead(readRanges, m_nextFrame);
+}
+
+void MultiSyncStream::SendThread(void) {
+    long long stepTime = m_seqFile->getStepTime() * 1000LL;
+    uint32_t numFrames = m_seqFile->getNumFrames();
+    if (!numFrames || (stepTime <= 0))
+        return;
+
+    uint32_t leadFrames = (m_leadMS * 1000LL) / stepTime;
+    int keyframeInterval = 1000000 / stepTime;
+
+    std::unique_lock<std::mutex> lock(m_sendLock);
+    while (m_running) {
+        long long now = GetMonotonicTime();
+        if ((now - m_lastGroupCheck) > 1000000)
+            UpdateGroups();
+
+        if (!m_streamStartTime) {
+            m_sendCond.wait_for(lock, std::chrono::microseconds(stepTime / 2));
+            continue;
+        }
+
+        long outFrame = 0;
+        long long outTime = 0;
+        bool keyframe = false;
+        uint32_t baseFrame = m_startFrame;
+        long long baseTime = m_streamStartTime;
+        if (GetLastOutputFrame(outFrame, outTime) && ((now - outTime) < (stepTime * 4)) &&
+            (outFrame >= m_startFrame)) {
+            baseFrame = outFrame;
+            baseTime = outTime;
+
+            // Resync if playback jumped (seek or frame skip) outside the
+            // window of frames we have already sent
+            if ((outFrame >= m_nextFrame) || ((m_nextFrame - outFrame) > (leadFrames + 10))) {
+                LogDebug(VB_SYNC, "Stream resync, output at %ld, next frame %u\n", outFrame, m_nextFrame);
+                m_nextFrame = outFrame + 1;
+                keyframe = true;
+            }
+        }
+
+        uint32_t target = std::min(baseFrame + leadFrames, numFrames - 1);
+        while (m_running && !m_groups.empty() && (m_nextFrame <= target)) {
+            long long frameTime = baseTime + (m_nextFrame - (long long)baseFrame) * stepTime;
+            for (auto& g : m_groups) {
+                if (g.framesSinceKeyframe >= keyframeInterval)
+                    keyframe = true;
+            }
+            SendFrame(m_nextFrame, frameTime, keyframe);
+            keyframe = false;
+            m_nextFrame++;
+        }
+
+        m_sendCond.wait_for(lock, std::chrono::microseconds(stepTime / 2));
+    }
+}
+
+bool MultiSyncStream::SendFrame(uint32_t frame, long long masterTime, bool keyframe) {
+    FSEQFile::FrameData* fd = m_seqFile->getFrame(frame);
+    if (!fd)
+        return false;
+
+    fd->readFrame(&m_frameBuf[0], m_frameBuf.size());
+    delete fd;
+
+    long long now = GetMonotonicTime();
+
+    int totalFragments = 0;
+    for (auto& g : m_groups) {
+        g.header.fragmentCount = 0;
+        if (!g.rawLen)
+            continue;
+
+        uint8_t* out = &g.current[0];
+        for (auto& r : g.ranges) {
+            memcpy(out, &m_frameBuf[r.first], r.second);
+            out += r.second;
+        }
+
+        bool key = keyframe || g.previous.empty();
+        if (key) {
+            memcpy(&g.delta[0], &g.current[0], g.rawLen);
+            g.framesSinceKeyframe = 0;
+        } else {
+            // mostly zeros for the typical slow changing frame
+            for (uint32_t x = 0; x < g.rawLen; x++)
+                g.delta[x] = g.current[x] ^ g.previous[x];
+            g.framesSinceKeyframe++;
+        }
+
+        size_t clen = ZSTD_compressCCtx(m_cctx, &g.compressed[0], g.compressed.size(),
+                                        &g.delta[0], g.rawLen, 1);
+        if (ZSTD_isError(clen)) {
+            LogErr(VB_SYNC, "Error compressing stream frame: %s\n", ZSTD_getErrorName(clen));
+            g.previous.clear();
+            continue;
+        }
+
+        int fragments = (clen + STREAM_MAX_PAYLOAD - 1) / STREAM_MAX_PAYLOAD;
+        if (fragments > 0xFFFF) {
+            LogWarn(VB_SYNC, "Stream frame %u too large to send (%d bytes)\n", frame, (int)clen);
+            g.previous.clear();
+            continue;
+        }
+
+        g.header.flags = key ? STREAM_FLAG_KEYFRAME : 0;
+        g.header.fragmentCount = fragments;
+        g.header.frameNumber = frame;
+        g.header.baseFrame = key ? frame : frame - 1;
+        g.header.dataLen = clen;
+        g.header.rawLen = g.rawLen;
+        g.header.masterTime = masterTime;
+        g.header.presentDelay = masterTime - now;
+        totalFragments += fragments;
+
+        g.previous.swap(g.current);
+        if (g.current.size() != g.rawLen)
+            g.current.resize(g.rawLen);
+        if (key)
+            m_keyframesSent++;
+    }
+
+    if (!totalFragments)
+        return true;
+
+    // Each fragment gets its own copy of the header, the payload is sent
+    // straight out of the group's compressed buffer
+    m_headers.resize(totalFragments);
+    m_iovecs.resize(totalFragments * 2);
+    m_msgs.resize(totalFragments);
+
+    int idx = 0;
+    for (auto& g : m_groups) {
+        for (int f = 0; f < g.header.fragmentCount; f++, idx++) {
+            size_t offset = f * STREAM_MAX_PAYLOAD;
+
+            m_headers[idx] = g.header;
+            m_headers[idx].fragment = f;
+
+            m_iovecs[idx * 2].iov_base = &m_headers[idx];
+            m_iovecs[idx * 2].iov_len = sizeof(StreamPkt);
+            m_iovecs[idx * 2 + 1].iov_base = &g.compressed[offset];
+            m_iovecs[idx * 2 + 1].iov_len = std::min((size_t)STREAM_MAX_PAYLOAD, g.header.dataLen - offset);
+
+            memset(&m_msgs[idx], 0, sizeof(struct mmsghdr));
+            m_msgs[idx].msg_hdr.msg_name = &m_destAddr;
+            m_msgs[idx].msg_hdr.msg_namelen = sizeof(m_destAddr);
+            m_msgs[idx].msg_hdr.msg_iov = &m_iovecs[idx * 2];
+            m_msgs[idx].msg_hdr.msg_iovlen = 2;
+
+            m_bytesSent += sizeof(StreamPkt) + m_iovecs[idx * 2 + 1].iov_len;
+        }
+    }
+
+    int sent = 0;
+    while (sent < totalFragments) {
+        int rc = sendmmsg(m_sock, &m_msgs[sent], totalFragments - sent, 0);
+        if (rc <= 0) {
+            LogExcess(VB_SYNC, "Error sending stream frame %u: %s\n", frame, strerror(errno));
+            break;
+        }
+        sent += rc;
+    }
+
+    m_framesSent++;
+    return true;
+}
+
+void MultiSyncStream::SendStopPacket(void) {
+    if ((m_sock < 0) || !m_streamId)
+        return;
+
+    StreamPkt pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    memcpy(pkt.fpps, "FPPS", 4);
+    pkt.version = 1;
+    pkt.pktType = STREAM_PKT_STOP;
+    pkt.streamId = m_streamId;
+
+    sendto(m_sock, &pkt, sizeof(pkt), 0, (struct sockaddr*)&m_destAddr, sizeof(m_destAddr));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Remote
+
+bool MultiSyncStream::IsReceiving(uint64_t streamId) const {
+    return m_receiving && streamId && (m_activeStreamId == streamId) &&
+           ((GetMonotonicTime() - m_lastFrameTime) < STREAM_ACTIVE_US);
+}
+
+void MultiSyncStream::ReceiveThread(void) {
+    struct mmsghdr msgs[STREAM_RCV_BATCH];
+    struct iovec iovecs[STREAM_RCV_BATCH];
+    std::vector<uint8_t> buffers(STREAM_RCV_BATCH * 1500);
+
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < STREAM_RCV_BATCH; i++) {
+        iovecs[i].iov_base = &buffers[i * 1500];
+        iovecs[i].iov_len = 1500;
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = m_sock;
+    pfd.events = POLLIN;
+
+    long long nextPresent = 0;
+    while (m_running) {
+        long long now = GetMonotonicTime();
+        if ((now - m_lastRangeCheck) > 2000000) {
+            m_lastRangeCheck = now;
+            std::string rangeStr = multiSync->GetLocalRanges();
+            uint32_t groupId = GetGroupId(rangeStr);
+            if (groupId != m_groupId) {
+                LogDebug(VB_SYNC, "Stream group %08x (%s)\n", groupId, rangeStr.c_str());
+                m_groupId = groupId;
+                m_ranges = ParseRanges(rangeStr);
+                m_rangesLen = 0;
+                for (auto& r : m_ranges)
+                    m_rangesLen += r.second;
+                m_lastDecodedFrame = -1;
+            }
+        }
+
+        int timeout = 100;
+        if (nextPresent) {
+            timeout = std::max(0LL, (nextPresent - now + 999) / 1000);
+            if (timeout > 100)
+                timeout = 100;
+        }
+
+        if (poll(&pfd, 1, timeout) > 0) {
+            int count = recvmmsg(m_sock, msgs, STREAM_RCV_BATCH, MSG_DONTWAIT, nullptr);
+            long long rcvTime = GetMonotonicTime();
+            for (int i = 0; i < count; i++) {
+                ProcessPacket(&buffers[i * 1500], msgs[i].msg_len, rcvTime);
+            }
+        }
+
+        nextPresent = PresentFrames();
+    }
+}
+
+void MultiSyncStream::ProcessPacket(uint8_t* buf, int len, long long rcvTime) {
+    if (len < (int)sizeof(StreamPkt))
+        return;
+
+    StreamPkt* pkt = (StreamPkt*)buf;
+    if (memcmp(pkt->fpps, "FPPS", 4) || (pkt->version != 1))
+        return;
+
+    if (pkt->pktType == STREAM_PKT_STOP) {
+        if (pkt->streamId == m_rcvStreamId) {
+            LogDebug(VB_SYNC, "Stream %llu stopped\n", (unsigned long long)pkt->streamId);
+            m_frames.clear();
+            m_bufferedFrames = 0;
+            m_rcvStreamId = 0;
+            m_activeStreamId = 0;
+            m_lastDecodedFrame = -1;
+            m_assemblyRemaining = 0;
+        }
+        return;
+    }
+
+    if ((pkt->pktType != STREAM_PKT_FRAME) || (pkt->groupId != m_groupId))
+        return;
+
+    if (pkt->streamId != m_rcvStreamId) {
+        LogDebug(VB_SYNC, "New stream %llu\n", (unsigned long long)pkt->streamId);
+        m_rcvStreamId = pkt->streamId;
+        m_frames.clear();
+        m_bufferedFrames = 0;
+        m_lastDecodedFrame = -1;
+        m_assemblyRemaining = 0;
+    }
+
+    // The sizes come off the wire, never trust them beyond what the
+    // fragment count could carry
+    int dataLen = len - sizeof(StreamPkt);
+    size_t offset = (size_t)pkt->fragment * STREAM_MAX_PAYLOAD;
+    if ((pkt->fragment >= pkt->fragmentCount) || ((offset + dataLen) > pkt->dataLen) ||
+        (pkt->dataLen > (size_t)pkt->fragmentCount * STREAM_MAX_PAYLOAD))
+        return;
+
+    if (!m_assemblyRemaining || (m_assemblyHeader.frameNumber != pkt->frameNumber)) {
+        if (m_assemblyRemaining)
+            m_framesDropped++; // lost a fragment of the previous frame
+
+        m_assemblyHeader = *pkt;
+        m_assembly.resize(pkt->dataLen);
+        m_assemblyFragments.assign(pkt->fragmentCount, false);
+        m_assemblyRemaining = pkt->fragmentCount;
+    }
+
+    // Every fragment of a frame must agree with the first one received
+    if ((pkt->fragmentCount != m_assemblyHeader.fragmentCount) ||
+        (pkt->dataLen != m_assemblyHeader.dataLen) ||
+        ((offset + dataLen) > m_assembly.size()))
+        return;
+
+    if (m_assemblyFragments[pkt->fragment])
+        return;
+
+    memcpy(&m_assembly[offset], buf + sizeof(StreamPkt), dataLen);
+    m_assemblyFragments[pkt->fragment] = true;
+    m_assemblyRemaining--;
+
+    if (!m_assemblyRemaining)
+        DecodeFrame(rcvTime);
+}
+
+void MultiSyncStream::DecodeFrame(long long rcvTime) {
+    StreamPkt& hdr = m_assemblyHeader;
+    bool keyframe = hdr.flags & STREAM_FLAG_KEYFRAME;
+
+    // The master may clip our ranges to its sequence's channel count so
+    // the frame can be shorter than the ranges, but never longer
+    if (!hdr.rawLen || (hdr.rawLen > m_rangesLen)) {
+        m_framesDropped++;
+        return;
+    }
+
+    if (!keyframe && ((m_lastDecodedFrame != hdr.baseFrame) || (m_lastDecoded.size() != hdr.rawLen))) {
+        // missed the frame this delta is against, wait for a keyframe
+        m_framesDropped++;
+        return;
+    }
+
+    m_delta.resize(hdr.rawLen);
+    size_t len = ZSTD_decompressDCtx(m_dctx, &m_delta[0], hdr.rawLen, &m_assembly[0], hdr.dataLen);
+    if (ZSTD_isError(len) || (len != hdr.rawLen)) {
+        LogDebug(VB_SYNC, "Error decompressing stream frame %u\n", hdr.frameNumber);
+        m_framesDropped++;
+        m_lastDecodedFrame = -1;
+        return;
+    }
+
+    if (keyframe) {
+        m_lastDecoded.swap(m_delta);
+    } else {
+        for (uint32_t x = 0; x < hdr.rawLen; x++)
+            m_lastDecoded[x] ^= m_delta[x];
+    }
+    m_lastDecodedFrame = hdr.frameNumber;
+    m_framesReceived++;
+    m_lastFrameTime = rcvTime;
+    m_activeStreamId = hdr.streamId;
+
+    // Prefer the master's timeline, until the clock estimate is ready
+    // assume the packet took no time to arrive
+    long long presentTime = multiSync->MasterTimeToLocal(hdr.masterTime);
+    if (!presentTime)
+        presentTime = rcvTime + hdr.presentDelay;
+
+    if (!m_frames.empty() && (hdr.frameNumber <= m_frames.back().frameNumber)) {
+        // master jumped back, drop what was buffered from before the jump
+        m_frames.clear();
+    }
+    if (m_frames.size() >= STREAM_MAX_BUFFERED_FRAMES) {
+        m_frames.pop_front();
+        m_framesDropped++;
+    }
+
+    StreamFrame& f = m_frames.emplace_back();
+    f.frameNumber = hdr.frameNumber;
+    f.presentTime = presentTime;
+    f.data = m_lastDecoded;
+    m_bufferedFrames = m_frames.size();
+}
+
+/*
+ * Output the most recent frame which is due, returns the time the next
+ * buffered frame is due or 0 if nothing is buffered
+ */
+long long MultiSyncStream::PresentFrames(void) {
+    long long now = GetMonotonicTime();
+
+    // if we fell behind only the newest due frame is output
+    while ((m_frames.size() > 1) && (m_frames[1].presentTime <= now)) {
+        m_frames.pop_front();
+        m_framesLate++;
+    }
+
+    if (!m_frames.empty() && (m_frames.front().presentTime <= now)) {
+        StreamFrame& f = m_frames.front();
+        if ((now - f.presentTime) > STREAM_MAX_LATE_US) {
+            m_framesLate++;
+        } else {
+            std::vector<std::pair<uint32_t, uint32_t>> ranges;
+            uint32_t offset = 0;
+            for (auto& r : m_ranges) {
+                if (offset >= f.data.size())
+                    break;
+                // the last range may have been clipped by the master
+                uint32_t len = std::min(r.second, (uint32_t)f.data.size() - offset);
+                if (sequence->CopyBridgeData(&f.data[offset], r.first, len))
+                    ranges.emplace_back(r.first, len);
+                offset += len;
+            }
+            sequence->SetBridgeRanges(ranges, GetTimeMS() + STREAM_BRIDGE_EXPIRE_MS);
+            m_framesPresented++;
+
+            if (!ChannelOutputThreadIsRunning())
+                StartChannelOutputThread();
+            BridgeSyncReceived();
+        }
+        m_frames.pop_front();
+    }
+
+    m_bufferedFrames = m_frames.size();
+    return m_frames.empty() ? 0 : m_frames.front().presentTime;
+}
+
+Json::Value MultiSyncStream::GetStats(void) {
+    Json::Value result;
+    if (m_receiving) {
+        result["mode"] = "receive";
+        result["groupId"] = m_groupId;
+        result["framesReceived"] = (Json::UInt)m_framesReceived;
+        result["framesPresented"] = (Json::UInt)m_framesPresented;
+        result["framesDropped"] = (Json::UInt)m_framesDropped;
+        result["framesLate"] = (Json::UInt)m_framesLate;
+        result["bufferedFrames"] = (int)m_bufferedFrames;
+    } else if (m_cctx) {
+        result["mode"] = "send";
+        result["leadMS"] = m_leadMS;
+        result["framesSent"] = (Json::UInt)m_framesSent;
+        result["keyframesSent"] = (Json::UInt)m_keyframesSent;
+        result["bytesSent"] = (Json::UInt64)m_bytesSent;
+    }
+    return result;
+}
@@ -0,0 +1,175 @@
+#pragma once
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include <sys/socket.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define FPP_STREAM_PORT 32321
+
+#define STREAM_PKT_FRAME 0
+#define STREAM_PKT_STOP 1
+
+#define STREAM_FLAG_KEYFRAME 0x01
+
+// Payload space left in a 1500 byte MTU after the IP/UDP/stream headers
+#define STREAM_MAX_PAYLOAD 1400
+
+typedef struct __attribute__((packed)) {
+    char fpps[4];           // 'FPPS'
+    uint8_t version;        // 1
+    uint8_t pktType;        // STREAM_PKT_*
+    uint8_t flags;          // STREAM_FLAG_*
+    uint8_t reserved;
+    uint16_t fragment;      // Fragment index of this frame
+    uint16_t fragmentCount; // Number of fragments in this frame
+    uint32_t groupId;       // Hash of the channel ranges in this stream
+    uint64_t streamId;      // Sequence ID, same as MultiSync v2 packets
+    uint32_t frameNumber;
+    uint32_t baseFrame;     // Frame the delta is against, == frameNumber for keyframes
+    uint32_t dataLen;       // Total compressed length of the frame
+    uint32_t rawLen;        // Uncompressed length, sum of the range lengths
+    uint64_t masterTime;    // Master monotonic time (us) to output the frame
+    int32_t presentDelay;   // masterTime minus the time the frame was sent
+} StreamPkt;
+
+typedef struct ZSTD_CCtx_s ZSTD_CCtx;
+typedef struct ZSTD_DCtx_s ZSTD_DCtx;
+class FSEQFile;
+
+/*
+ * Streams sequence channel data from a MultiSync master to remotes which
+ * ask for it in their ping instead of playing their own copy of the FSEQ.
+ *
+ * The master reads the sequence ahead of playback and, for each distinct
+ * set of channel ranges reported by streaming remotes, sends the frame as
+ * a zstd compressed XOR delta against the previous frame (with a periodic
+ * keyframe) over multicast.  Remotes buffer the frames and hand them to
+ * the bridge input path at the time the master outputs them.
+ */
+class MultiSyncStream {
+public:
+    static MultiSyncStream INSTANCE;
+
+    MultiSyncStream();
+    ~MultiSyncStream();
+
+    void Init(void);
+    void Shutdown(void);
+
+    // True while frames of the given stream are arriving from the master
+    bool IsReceiving(uint64_t streamId) const;
+
+    // Master side, called when a sequence is opened/closed
+    void StartStream(const std::string& filename, uint64_t streamId, uint32_t startFrame);
+    void StopStream(void);
+    // Master side, called when playback of the opened sequence begins
+    void StartPlayback(void);
+
+    Json::Value GetStats(void);
+
+    static uint32_t GetGroupId(const std::string& ranges);
+    static std::vector<std::pair<uint32_t, uint32_t>> ParseRanges(const std::string& ranges);
+
+private:
+    class StreamGroup {
+    public:
+        std::string rangeStr;
+        uint32_t groupId = 0;
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        uint32_t rawLen = 0;
+        int framesSinceKeyframe = 0;
+        std::vector<uint8_t> current;
+        std::vector<uint8_t> previous;
+        std::vector<uint8_t> delta;
+        std::vector<uint8_t> compressed;
+        StreamPkt header;
+    };
+
+    class StreamFrame {
+    public:
+        uint32_t frameNumber = 0;
+        long long presentTime = 0;
+        std::vector<uint8_t> data;
+    };
+
+    int OpenSocket(bool receive);
+
+    void SendThread(void);
+    void UpdateGroups(void);
+    bool SendFrame(uint32_t frame, long long masterTime, bool keyframe);
+    void SendStopPacket(void);
+
+    void ReceiveThread(void);
+    void ProcessPacket(uint8_t* buf, int len, long long rcvTime);
+    void DecodeFrame(long long rcvTime);
+    long long PresentFrames(void);
+
+    int m_sock = -1;
+    struct sockaddr_in m_destAddr;
+    std::atomic<bool> m_running;
+    bool m_receiving = false;
+
+    // Master
+    std::thread* m_sendThread = nullptr;
+    std::mutex m_sendLock;
+    std::condition_variable m_sendCond;
+    FSEQFile* m_seqFile = nullptr;
+    uint64_t m_streamId = 0;
+    uint32_t m_nextFrame = 0;
+    uint32_t m_startFrame = 0;
+    long long m_streamStartTime = 0;
+    int m_leadMS = 500;
+    std::vector<uint8_t> m_frameBuf;
+    std::list<StreamGroup> m_groups;
+    long long m_lastGroupCheck = 0;
+    ZSTD_CCtx* m_cctx = nullptr;
+    std::vector<StreamPkt> m_headers;
+    std::vector<struct mmsghdr> m_msgs;
+    std::vector<struct iovec> m_iovecs;
+
+    // Remote
+    std::thread* m_receiveThread = nullptr;
+    std::vector<std::pair<uint32_t, uint32_t>> m_ranges;
+    uint32_t m_rangesLen = 0;
+    uint32_t m_groupId = 0;
+    long long m_lastRangeCheck = 0;
+    uint64_t m_rcvStreamId = 0;
+    ZSTD_DCtx* m_dctx = nullptr;
+    StreamPkt m_assemblyHeader;
+    std::vector<uint8_t> m_assembly;
+    std::vector<bool> m_assemblyFragments;
+    int m_assemblyRemaining = 0;
+    std::vector<uint8_t> m_delta;
+    std::vector<uint8_t> m_lastDecoded;
+    int64_t m_lastDecodedFrame = -1;
+    std::deque<StreamFrame> m_frames;
+    std::atomic<uint64_t> m_activeStreamId;
+    std::atomic<long long> m_lastFrameTime;
+
+    // Stats
+    std::atomic<uint32_t> m_framesSent;
+    std::atomic<uint32_t> m_keyframesSent;
+    std::atomic<uint64_t> m_bytesSent;
+    std::atomic<uint32_t> m_framesReceived;
+    std::atomic<uint32_t> m_framesDropped;
+    std::atomic<uint32_t> m_framesLate;
+    std::atomic<uint32_t> m_framesPresented;
+    std::atomic<int> m_bufferedFrames;
+};
@@ -28,6 +28,7 @@
 #include <vector>
 
 #include "MultiSync.h"
+#include "MultiSyncStream.h"
 #include "Player.h"
 #include "Plugins.h"
 #include "Warnings.h"
@@ -59,6 +60,7 @@ Sequence::Sequence() :
     m_seqMSElapsed(0),
     m_seqMSRemaining(0),
     m_seqFile(nullptr),
+    m_seqGeneration(0),
     m_seqStarting(0),
     m_seqPaused(0),
     m_seqSingleStep(0),
@@ -70,6 +72,10 @@ Sequence::Sequence() :
     m_doneRead(false),
     m_shuttingDown(false),
     m_lastFrameData(nullptr),
+    m_prefetchGeneration(0),
+    m_prefetchThreads(0),
+    m_prefetchPending(false),
+    m_prefetchFile(nullptr),
     m_dataProcessed(false),
     m_seqFilename(""),
     m_bridgeData(nullptr) {
@@ -88,7 +94,11 @@ Sequence::Sequence() :
 }
 
 Sequence::~Sequence() {
+    ClearPrefetch();
     m_shuttingDown = true;
+    std::unique_lock<std::mutex> prefetchLock(m_prefetchLock);
+    m_prefetchSignal.wait(prefetchLock, [this] { return m_prefetchThreads == 0; });
+    prefetchLock.unlock();
     frameLoadSignal.notify_all();
     if (m_readThread) {
         m_readThread->join();
@@ -236,6 +246,7 @@ int Sequence::OpenSequenceFile(const std::string& filename, int startFrame, int
     if (m_seqFile) {
         delete m_seqFile;
         m_seqFile = nullptr;
+        m_seqGeneration++;
     }
 
     m_seqStarting = 2;
@@ -258,60 +269,53 @@ int Sequence::OpenSequenceFile(const std::string& filename, int startFrame, int
         m_readThread = new std::thread(ReadSequenceDataThread, this);
     }
 
-    m_seqFilename = filename;
-
-    char tmpFilename[2048];
-    unsigned char tmpData[2048];
-    strcpy(tmpFilename, FPP_DIR_SEQUENCE("/" + filename).c_str());
-
-    if (getFPPmode() == REMOTE_MODE)
-        CheckForHostSpecificFile(getSetting("HostName").c_str(), tmpFilename);
-
-    if (!FileExists(tmpFilename)) {
+    std::string tmpFilename = GetSequencePath(filename, m_seqFilename);
+    if (tmpFilename == "") {
         std::string warning = "Sequence file ";
-        warning += tmpFilename;
+        warning += FPP_DIR_SEQUENCE("/" + filename);
         warning += " does not exist\n";
 
-        if (getFPPmode() == REMOTE_MODE) {
-            LogDebug(VB_SEQUENCE, "Sequence file %s does not exist\n", tmpFilename);
-
-            // Look for fallback.fseq instead
-            strcpy(tmpFilename, FPP_DIR_SEQUENCE("/fallback.fseq").c_str());
-
-            if (!FileExists(tmpFilename)) {
-                LogDebug(VB_SEQUENCE, "Fallback Sequence file %s does not exist\n", tmpFilename);
-                WarningHolder::AddWarningTimeout(warning, 60);
-                m_seqStarting = 0;
-                return 0;
-
-            } else {
-                m_seqFilename = "fallback.fseq";
-                LogDebug(VB_SEQUENCE, "Playing Fallback Sequence file %s\n", tmpFilename);
-            }
-
-        } else {
-            LogErr(VB_SEQUENCE, "Sequence file %s does not exist\n", tmpFilename);
-            WarningHolder::AddWarningTimeout(warning, 60);
-            m_seqStarting = 0;
-            return 0;
-        }
+        if (getFPPmode() != REMOTE_MODE)
+            LogErr(VB_SEQUENCE, "%s", warning.c_str());
+        WarningHolder::AddWarningTimeout(warning, 60);
+        m_seqStarting = 0;
+        return 0;
     }
 
-    if (multiSync->isMultiSyncEnabled()) {
-        seqLock.unlock();
-        multiSync->SendSeqOpenPacket(filename);
-        seqLock.lock();
+    // A prefetched copy of the file has already had prepareRead() called
+    // and the first frames decoded, it can only be used from the start
+    std::list<FSEQFile::FrameData*> prefetchedFrames;
+    FSEQFile* seqFile = TakePrefetchedFile(tmpFilename, prefetchedFrames);
+    bool prepared = seqFile != nullptr;
+    if (prepared && (startFrame != 0 || startSecond >= 0)) {
+        for (auto fd : prefetchedFrames) {
+            delete fd;
+        }
+        prefetchedFrames.clear();
+        delete seqFile;
+        seqFile = nullptr;
+        prepared = false;
     }
 
     m_seqFile = nullptr;
-    FSEQFile* seqFile = FSEQFile::openFSEQFile(tmpFilename);
+    if (seqFile == nullptr) {
+        seqFile = FSEQFile::openFSEQFile(tmpFilename);
+    }
     if (seqFile == NULL) {
         LogErr(VB_SEQUENCE, "Error opening sequence file: %s. FSEQFile::openFSEQFile returned NULL\n",
-               tmpFilename);
+               tmpFilename.c_str());
         m_seqStarting = 0;
         return 0;
     }
 
+    // Sent after the header is read so remotes can be given the sequence
+    // ID used to key compact sync packets for the rest of the sequence
+    if (multiSync->isMultiSyncEnabled()) {
+        seqLock.unlock();
+        multiSync->SendSeqOpenPacket(filename, seqFile->getUniqueId());
+        seqLock.lock();
+    }
+
     m_seqStepTime = seqFile->getStepTime();
     m_seqRefreshRate = 1000.0f / m_seqStepTime;
 
@@ -323,15 +327,33 @@ int Sequence::OpenSequenceFile(const std::string& filename, int startFrame, int
             m_lastFrameRead = -1;
     }
 
-    seqFile->prepareRead(GetOutputRanges(), startFrame < 0 ? 0 : startFrame);
+    if (!prepared) {
+        seqFile->prepareRead(GetOutputRanges(), startFrame < 0 ? 0 : startFrame);
+    }
+    if (multiSync->isMultiSyncEnabled()) {
+        // the stream opens its own handle on the file, don't hold up
+        // everything waiting on the sequence lock while it does
+        seqLock.unlock();
+        MultiSyncStream::INSTANCE.StartStream(tmpFilename, seqFile->getUniqueId(), m_lastFrameRead + 1);
+        seqLock.lock();
+    }
+
     // Calculate duration
     m_seqMSRemaining = seqFile->getNumFrames() * seqFile->getStepTime();
     m_seqMSDuration = m_seqMSRemaining;
     m_seqMSElapsed = 0;
     SetChannelOutputRefreshRate(m_seqRefreshRate);
 
+    if (!prefetchedFrames.empty()) {
+        LogDebug(VB_SEQUENCE, "Using %d prefetched frames for %s\n", (int)prefetchedFrames.size(), filename.c_str());
+        std::unique_lock<std::mutex> lock(frameCacheLock);
+        m_lastFrameRead = prefetchedFrames.back()->frame;
+        frameCache.splice(frameCache.end(), prefetchedFrames);
+    }
+
     //start reading frames
     m_seqFile = seqFile;
+    m_seqGeneration++;
     m_seqStarting = 1; //beyond header, read loop can start reading frames
     frameLoadSignal.notify_all();
     m_seqPaused = 0;
@@ -349,6 +371,156 @@ int Sequence::OpenSequenceFile(const std::string& filename, int startFrame, int
     LogDebug(VB_SEQUENCE, "seqMSRemaining        : %d\n", m_seqMSRemaining);
     return 1;
 }
+std::string Sequence::GetSequencePath(const std::string& filename, std::string& seqFilename) {
+    char tmpFilename[2048];
+    strcpy(tmpFilename, FPP_DIR_SEQUENCE("/" + filename).c_str());
+    seqFilename = filename;
+
+    if (getFPPmode() == REMOTE_MODE)
+        CheckForHostSpecificFile(getSetting("HostName").c_str(), tmpFilename);
+
+    if (FileExists(tmpFilename))
+        return tmpFilename;
+
+    if (getFPPmode() != REMOTE_MODE)
+        return "";
+
+    LogDebug(VB_SEQUENCE, "Sequence file %s does not exist\n", tmpFilename);
+
+    // Look for fallback.fseq instead
+    strcpy(tmpFilename, FPP_DIR_SEQUENCE("/fallback.fseq").c_str());
+    if (!FileExists(tmpFilename)) {
+        LogDebug(VB_SEQUENCE, "Fallback Sequence file %s does not exist\n", tmpFilename);
+        return "";
+    }
+
+    seqFilename = "fallback.fseq";
+    LogDebug(VB_SEQUENCE, "Using Fallback Sequence file %s\n", tmpFilename);
+    return tmpFilename;
+}
+
+void Sequence::PrefetchSequenceFile(const std::string& filename) {
+    LogDebug(VB_SEQUENCE, "PrefetchSequenceFile(%s)\n", filename.c_str());
+
+    if (filename == "")
+        return;
+
+    std::string seqFilename;
+    std::string path = GetSequencePath(filename, seqFilename);
+    if (path == "")
+        return;
+
+    std::unique_lock<std::mutex> lock(m_prefetchLock);
+    bool prefetched = (m_prefetchPath == path);
+    lock.unlock();
+
+    if (!prefetched) {
+        ClearPrefetch();
+
+        lock.lock();
+        m_prefetchPath = path;
+        m_prefetchPending = true;
+        m_prefetchThreads++;
+        std::thread(&Sequence::PrefetchThread, this, path, filename, (uint32_t)m_prefetchGeneration).detach();
+        lock.unlock();
+    }
+
+    if (multiSync->isMultiSyncEnabled())
+        multiSync->SendSeqPreparePacket(filename);
+}
+
+void Sequence::PrefetchThread(std::string path, std::string filename, uint32_t generation) {
+    long long start = GetTimeMS();
+    FSEQFile* seqFile = FSEQFile::openFSEQFile(path);
+    if (seqFile == nullptr) {
+        LogWarn(VB_SEQUENCE, "Could not prefetch sequence file %s\n", path.c_str());
+    }
+
+    // Reading the first frames pulls the header, block index and first
+    // blocks into memory and gets the decompressor past the first block
+    std::vector<std::pair<uint32_t, uint32_t>> ranges = GetOutputRanges();
+    std::list<FSEQFile::FrameData*> frames;
+    if (seqFile && generation == m_prefetchGeneration) {
+        seqFile->prepareRead(ranges, 0);
+    }
+
+    uint32_t count = seqFile ? std::min((uint32_t)SEQUENCE_CACHE_FRAMECOUNT, seqFile->getNumFrames()) : 0;
+    for (uint32_t frame = 0; frame < count && !m_shuttingDown && generation == m_prefetchGeneration; frame++) {
+        FSEQFile::FrameData* fd = seqFile->getFrame(frame);
+        if (fd == nullptr)
+            break;
+        frames.push_back(fd);
+    }
+
+    LogDebug(VB_SEQUENCE, "Prefetched %d frames of %s in %d ms\n",
+             (int)frames.size(), filename.c_str(), (int)(GetTimeMS() - start));
+
+    std::unique_lock<std::mutex> lock(m_prefetchLock);
+    if (generation == m_prefetchGeneration) {
+        m_prefetchPending = false;
+        if (m_prefetchFile == nullptr) {
+            m_prefetchFile = seqFile;
+            m_prefetchRanges = ranges;
+            m_prefetchFrames.swap(frames);
+            seqFile = nullptr;
+        }
+    }
+    lock.unlock();
+
+    for (auto fd : frames) {
+        delete fd;
+    }
+    if (seqFile) {
+        delete seqFile;
+    }
+
+    lock.lock();
+    m_prefetchThreads--;
+    lock.unlock();
+    m_prefetchSignal.notify_all();
+}
+
+FSEQFile* Sequence::TakePrefetchedFile(const std::string& path, std::list<FSEQFile::FrameData*>& frames) {
+    std::unique_lock<std::mutex> lock(m_prefetchLock);
+    if (m_prefetchPath != path) {
+        lock.unlock();
+        ClearPrefetch();
+        return nullptr;
+    }
+    // almost done opening the file we are about to need, wait for it
+    m_prefetchSignal.wait(lock, [this] { return !m_prefetchPending; });
+
+    FSEQFile* seqFile = nullptr;
+    if (m_prefetchFile && m_prefetchRanges == GetOutputRanges()) {
+        seqFile = m_prefetchFile;
+        m_prefetchFile = nullptr;
+        frames.swap(m_prefetchFrames);
+    }
+    lock.unlock();
+
+    ClearPrefetch();
+    return seqFile;
+}
+
+void Sequence::ClearPrefetch(void) {
+    std::unique_lock<std::mutex> lock(m_prefetchLock);
+    // a running thread sees the new generation and cleans up after itself
+    m_prefetchGeneration++;
+    m_prefetchPending = false;
+    m_prefetchPath = "";
+    for (auto fd : m_prefetchFrames) {
+        delete fd;
+    }
+    m_prefetchFrames.clear();
+    m_prefetchRanges.clear();
+    if (m_prefetchFile) {
+        delete m_prefetchFile;
+        m_prefetchFile = nullptr;
+    }
+    lock.unlock();
+    m_prefetchSignal.notify_all();
+}
+
 void Sequence::ProcessVariableHeaders() {
     for (auto& vh : m_seqFile->getVariableHeaders()) {
         if (vh.code[0] == 'F') {
@@ -395,6 +567,7 @@ void Sequence::StartSequence() {
         if (multiSync->isMultiSyncEnabled()) {
             ResetChannelOutputFrameNumber();
             multiSync->SendSeqSyncStartPacket(m_seqFilename);
+            MultiSyncStream::INSTANCE.StartPlayback();
         }
         m_seqStarting = 0;
         StartChannelOutputThread();
@@ -476,6 +649,14 @@ int Sequence::IsSequenceRunning(const std::string& filename) {
     return result;
 }
 
+uint32_t Sequence::GetSequenceGeneration(const std::string& filename) {
+    std::unique_lock<std::recursive_mutex> seqLock(m_sequenceLock);
+    if (m_seqFile && (m_seqFilename == filename))
+        return m_seqGeneration;
+
+    return 0;
+}
+
 void Sequence::BlankSequenceData(bool clearBridge) {
     LogExcess(VB_SEQUENCE, "BlankSequenceData()\n");
     for (auto& a : GetOutputRanges()) {
@@ -750,8 +931,10 @@ void Sequence::CloseIfOpen(const std::string& filename) {
 void Sequence::CloseSequenceFile(void) {
     LogDebug(VB_SEQUENCE, "CloseSequenceFile() %s\n", m_seqFilename.c_str());
 
-    if (multiSync->isMultiSyncEnabled())
+    if (multiSync->isMultiSyncEnabled()) {
+        MultiSyncStream::INSTANCE.StopStream();
         multiSync->SendSeqSyncStopPacket(m_seqFilename);
+    }
 
     std::unique_lock<std::recursive_mutex> seqLock(m_sequenceLock);
 
@@ -759,6 +942,7 @@ void Sequence::CloseSequenceFile(void) {
     if (m_seqFile) {
         delete m_seqFile;
         m_seqFile = nullptr;
+        m_seqGeneration++;
 
         std::map<std::string, std::string> keywords;
         keywords["SEQUENCE_NAME"] = m_seqFilename;
@@ -788,15 +972,10 @@ void Sequence::CloseSequenceFile(void) {
 }
 
 void Sequence::SetBridgeData(uint8_t* data, int startChannel, int len, uint64_t expireMS) {
-    if (m_prioritize_sequence_over_bridge && this->IsSequenceRunning()) {
+    if (!CopyBridgeData(data, startChannel, len)) {
         return;
     }
 
-    if (!m_bridgeData) {
-        m_bridgeData = (uint8_t*)calloc(1, FPPD_MAX_CHANNEL_NUM);
-    }
-    memcpy(&m_bridgeData[startChannel], data, len);
-
     std::unique_lock<std::mutex> lock(m_bridgeRangesLock);
     auto& a = m_bridgeRanges[startChannel];
     a.startChannel = startChannel;
@@ -806,6 +985,45 @@ void Sequence::SetBridgeData(uint8_t* data, int startChannel, int len, uint64_t
     setDataNotProcessed();
 }
 
+bool Sequence::CopyBridgeData(uint8_t* data, int startChannel, int len) {
+    uint8_t* dest = GetBridgeDataBuffer(startChannel, len);
+    if (!dest) {
+        return false;
+    }
+    memcpy(dest, data, len);
+    return true;
+}
+
+uint8_t* Sequence::GetBridgeDataBuffer(int startChannel, int len) {
+    if (m_prioritize_sequence_over_bridge && this->IsSequenceRunning()) {
+        return nullptr;
+    }
+    if ((startChannel < 0) || (len <= 0) || ((startChannel + len) > FPPD_MAX_CHANNELS)) {
+        return nullptr;
+    }
+
+    // bridge data may be received on multiple threads
+    std::call_once(m_bridgeDataAlloc, [this]() {
+        m_bridgeData = (uint8_t*)calloc(1, FPPD_MAX_CHANNEL_NUM);
+    });
+    return &m_bridgeData[startChannel];
+}
+
+void Sequence::SetBridgeRanges(const std::vector<std::pair<uint32_t, uint32_t>>& ranges, uint64_t expireMS) {
+    if (ranges.empty()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(m_bridgeRangesLock);
+    for (auto& r : ranges) {
+        auto& a = m_bridgeRanges[r.first];
+        a.startChannel = r.first;
+        a.expires[r.second] = expireMS;
+    }
+    lock.unlock();
+
+    setDataNotProcessed();
+}
+
 bool Sequence::hasBridgeData() {
     std::unique_lock<std::mutex> lock(m_bridgeRangesLock);
     return !m_bridgeRanges.empty();
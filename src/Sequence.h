@@ -40,7 +40,14 @@ public:
 
     int IsSequenceRunning(void);
     int IsSequenceRunning(const std::string& filename);
+    // Changes every time a sequence is opened or closed, can be used
+    // without locking to check if the open sequence has changed
+    uint32_t GetSequenceGeneration(void) const { return m_seqGeneration; }
+    uint32_t GetSequenceGeneration(const std::string& filename);
     int OpenSequenceFile(const std::string& filename, int startFrame = 0, int startSecond = -1);
+    // Open the sequence and decode its first frames in the background so a
+    // following OpenSequenceFile of the same file can start immediately
+    void PrefetchSequenceFile(const std::string& filename);
     void StartSequence(const std::string& filename, int startFrame);
     void StartSequence();
     void ProcessSequenceData(int ms);
@@ -70,9 +77,22 @@ public:
 
     void SetBridgeData(uint8_t* data, int startChannel, int len, uint64_t expireMS);
 
+    // Split version of SetBridgeData for receivers that handle a batch of
+    // packets at once.  CopyBridgeData does not lock so it can be called
+    // for every packet, the ranges are then recorded with a single lock.
+    bool CopyBridgeData(uint8_t* data, int startChannel, int len);
+    // Location in the bridge buffer that data for the range can be written
+    // to directly, nullptr if bridge data for the range should be ignored
+    uint8_t* GetBridgeDataBuffer(int startChannel, int len);
+    void SetBridgeRanges(const std::vector<std::pair<uint32_t, uint32_t>>& ranges, uint64_t expireMS);
+
 private:
     void ProcessVariableHeaders();
     void SetLastFrameData(FSEQFile::FrameData* data);
+    std::string GetSequencePath(const std::string& filename, std::string& seqFilename);
+    void PrefetchThread(std::string path, std::string filename, uint32_t generation);
+    FSEQFile* TakePrefetchedFile(const std::string& path, std::list<FSEQFile::FrameData*>& frames);
+    void ClearPrefetch(void);
     bool m_prioritize_sequence_over_bridge;
 
     class BridgeRangeData {
@@ -86,10 +106,12 @@ private:
     };
     std::map<uint64_t, BridgeRangeData> m_bridgeRanges;
     std::mutex m_bridgeRangesLock;
+    std::once_flag m_bridgeDataAlloc;
     uint8_t* m_bridgeData;
 
     FSEQFile* m_seqFile;
 
+    std::atomic<uint32_t> m_seqGeneration;
     volatile int m_seqStarting;
     int m_seqPaused;
     int m_seqStepTime;
@@ -117,6 +139,19 @@ private:
     std::condition_variable frameLoadSignal;
     std::condition_variable frameLoadedSignal;
 
+    // Prefetch threads are detached so cancelling one (possibly from the
+    // MultiSync thread) never waits on disk I/O, a cancelled thread notices
+    // the generation changed and throws its work away
+    std::mutex m_prefetchLock;
+    std::condition_variable m_prefetchSignal;
+    std::atomic<uint32_t> m_prefetchGeneration;
+    int m_prefetchThreads;  // running, including cancelled ones
+    bool m_prefetchPending; // the current generation's thread hasn't finished
+    std::string m_prefetchPath;
+    FSEQFile* m_prefetchFile;
+    std::vector<std::pair<uint32_t, uint32_t>> m_prefetchRanges;
+    std::list<FSEQFile::FrameData*> m_prefetchFrames;
+
     std::map<uint32_t, std::vector<std::string>> commandPresets;
     std::map<uint32_t, std::vector<std::string>> effectsOn;
     std::map<uint32_t, std::vector<std::string>> effectsOff;
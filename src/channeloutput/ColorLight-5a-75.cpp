@@ -115,7 +115,11 @@ ColorLight5a75Output::ColorLight5a75Output(unsigned int startChannel, unsigned i
     m_matrix(NULL),
     m_panelMatrix(NULL),
     m_slowCount(0),
-    m_flippedLayout(0) {
+    m_flippedLayout(0),
+    m_txRing(nullptr),
+    m_txRingReady(false),
+    m_packetsPerRow(0),
+    m_partialRows(false) {
     LogDebug(VB_CHANNELOUT, "ColorLight5a75Output::ColorLight5a75Output(%u, %u)\n",
              startChannel, channelCount);
 }
@@ -133,6 +137,9 @@ ColorLight5a75Output::~ColorLight5a75Output() {
             i++; // first 4 are header+data, only headers for the rest
     }
 
+    if (m_txRing)
+        delete m_txRing;
+
     if (m_fd >= 0)
         close(m_fd);
 
@@ -269,6 +276,10 @@ int ColorLight5a75Output::Init(Json::Value config) {
         m_ifName = "eth1";
 
     m_rowSize = m_longestChain * m_panelWidth * 3;
+    m_packetsPerRow = ((m_rowSize - 1) / CL5A75_MAX_CHANNELS_PER_PACKET) + 1;
+
+    // Outputs with short chains leave part of the row without panel data
+    m_partialRows = m_panels < (m_outputs * m_longestChain);
 
 #ifndef PLATFORM_OSX
     // Open our raw socket
@@ -326,7 +337,7 @@ int ColorLight5a75Output::Init(Json::Value config) {
     ioctl(m_fd, BIOCSHDRCMPLT, &yes);
 #endif
 
-    int packetCount = 2 + (m_rows * (((int)(m_rowSize - 1) / CL5A75_MAX_CHANNELS_PER_PACKET) + 1));
+    int packetCount = 2 + (m_rows * m_packetsPerRow);
     m_msgs.resize(packetCount);
     m_iovecs.resize(packetCount * 2);
 
@@ -427,6 +438,18 @@ int ColorLight5a75Output::Init(Json::Value config) {
         msg.msg_hdr.msg_iovlen = 2;
         m_msgs[m] = msg;
     }
+
+    if (config.isMember("txRing") && config["txRing"].asInt()) {
+        // Double buffer so the next frame can be prepped while the kernel
+        // is still sending the current one
+        m_txRing = new PacketTxRing();
+        if (!m_txRing->Open(m_ifName, CL5A75_BUFFER_SIZE, packetCount * 2)) {
+            LogWarn(VB_CHANNELOUT, "Unable to create TX ring on %s, falling back to sendmmsg()\n", m_ifName.c_str());
+            delete m_txRing;
+            m_txRing = nullptr;
+        }
+    }
+
     if (PixelOverlayManager::INSTANCE.isAutoCreatePixelOverlayModels()) {
         std::string dd = "LED Panels";
         if (config.isMember("description")) {
@@ -491,6 +514,14 @@ void ColorLight5a75Output::PrepData(unsigned char* channelData) {
 
     channelData += m_startChannel; // FIXME, this function gets offset 0
 
+    if (m_txRing) {
+        m_txRingReady = m_txRing->Reserve(m_msgs.size(), 20);
+        if (!m_txRingReady)
+            return;
+
+        PrepTxRingFrames();
+    }
+
     for (int output = 0; output < m_outputs; output++) {
         int panelsOnOutput = m_panelMatrix->m_outputPanels[output].size();
 
@@ -504,14 +535,18 @@ void ColorLight5a75Output::PrepData(unsigned char* channelData) {
             for (int y = 0; y < m_panelHeight; y++) {
                 int px = chain * m_panelWidth;
                 int yw = y * m_panelWidth * 3;
-
-                dst = (unsigned char*)(m_outputFrame + (((((output * m_panelHeight) + y) * m_panelWidth * m_longestChain) + px) * 3));
+                int row = (output * m_panelHeight) + y;
+                int avail = 0;
 
                 for (int x = 0; x < pw3; x += 3) {
+                    if (!avail)
+                        dst = GetRowData(row, px * 3, avail);
+
                     *(dst++) = m_gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw + x]]];
                     *(dst++) = m_gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw + x + 1]]];
                     *(dst++) = m_gammaCurve[channelData[m_panelMatrix->m_panels[panel].pixelMap[yw + x + 2]]];
 
+                    avail -= 3;
                     px++;
                 }
             }
@@ -519,6 +554,62 @@ void ColorLight5a75Output::PrepData(unsigned char* channelData) {
     }
 }
 
+/*
+ * Returns a pointer to the output data for the given row and byte offset.
+ * 'avail' is set to the number of bytes which can be written before the
+ * end of the current packet.
+ */
+unsigned char* ColorLight5a75Output::GetRowData(int row, int offset, int& avail) {
+    if (!m_txRing) {
+        avail = m_rowSize - offset;
+        return (unsigned char*)m_outputFrame + (row * m_rowSize) + offset;
+    }
+
+    int part = offset / CL5A75_MAX_CHANNELS_PER_PACKET;
+    int partOffset = offset % CL5A75_MAX_CHANNELS_PER_PACKET;
+    avail = CL5A75_MAX_CHANNELS_PER_PACKET - partOffset;
+
+    return m_txRing->GetFrame(2 + (row * m_packetsPerRow) + part) + sizeof(struct ether_header) + CL5A75_HEADER_LEN + partOffset;
+}
+
+/*
+ * Fill in the headers for the reserved TX ring frames, pixel data is
+ * written directly into the frames by PrepData()
+ */
+void ColorLight5a75Output::PrepTxRingFrames(void) {
+    for (int p = 0; p < m_msgs.size(); p++) {
+        unsigned char* frame = m_txRing->GetFrame(p);
+        struct iovec* iov = &m_iovecs[p * 2];
+
+        memcpy(frame, iov[0].iov_base, iov[0].iov_len);
+        if (p < 2) {
+            // Init packets are static
+            memcpy(frame + iov[0].iov_len, iov[1].iov_base, iov[1].iov_len);
+        } else if (m_partialRows) {
+            // Ring frames are reused, clear pixels with no panel behind them
+            memset(frame + iov[0].iov_len, 0, iov[1].iov_len);
+        }
+
+        m_txRing->SetFrameLength(p, iov[0].iov_len + iov[1].iov_len);
+    }
+}
+
+int ColorLight5a75Output::SendTxRingFrames(void) {
+    if (!m_txRingReady || (m_txRing->Commit() < 0)) {
+        LogWarn(VB_CHANNELOUT, "Unable to queue frame on ColorLight TX ring (%s)\n", m_ifName.c_str());
+        m_slowCount++;
+        if (m_slowCount > 3) {
+            LogWarn(VB_CHANNELOUT, "Repeated frames taking more than 20ms to send to ColorLight");
+            WarningHolder::AddWarningTimeout("Repeated frames taking more than 20ms to send to ColorLight", 30);
+        }
+    } else {
+        m_slowCount = 0;
+    }
+
+    m_txRingReady = false;
+    return m_channelCount;
+}
+
 int ColorLight5a75Output::sendMessages(struct mmsghdr* msgs, int msgCount) {
 #ifdef PLATFORM_OSX
     char buf[1500];
@@ -545,6 +636,9 @@ int ColorLight5a75Output::sendMessages(struct mmsghdr* msgs, int msgCount) {
 int ColorLight5a75Output::SendData(unsigned char* channelData) {
     LogExcess(VB_CHANNELOUT, "ColorLight5a75Output::SendData(%p)\n", channelData);
 
+    if (m_txRing)
+        return SendTxRingFrames();
+
     long long startTime = GetTimeMS();
     struct mmsghdr* msgs = &m_msgs[0];
     int msgCount = m_msgs.size();
@@ -610,6 +704,9 @@ void ColorLight5a75Output::DumpConfig(void) {
     LogDebug(VB_CHANNELOUT, "    Longest Chain  : %d\n", m_longestChain);
     LogDebug(VB_CHANNELOUT, "    Inverted Data  : %d\n", m_invertedData);
     LogDebug(VB_CHANNELOUT, "    Interface      : %s\n", m_ifName.c_str());
+    LogDebug(VB_CHANNELOUT, "    TX Ring        : %s\n", m_txRing ? "Enabled" : "Disabled");
+    if (m_txRing)
+        LogDebug(VB_CHANNELOUT, "    TX Ring Frames : %d\n", m_txRing->GetFrameCount());
 
     ChannelOutput::DumpConfig();
 }
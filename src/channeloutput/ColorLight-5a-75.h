@@ -21,6 +21,7 @@
 #include "ChannelOutput.h"
 #include "ColorOrder.h"
 #include "Matrix.h"
+#include "PacketTxRing.h"
 #include "PanelMatrix.h"
 
 #define CL5A75_BUFFER_SIZE 1536
@@ -54,6 +55,9 @@ public:
 private:
     void SetHostMACs(void* data);
     int sendMessages(struct mmsghdr* msgs, int cnt);
+    unsigned char* GetRowData(int row, int offset, int& avail);
+    void PrepTxRingFrames(void);
+    int SendTxRingFrames(void);
 
     int m_width;
     int m_height;
@@ -75,6 +79,11 @@ private:
     std::vector<struct mmsghdr> m_msgs;
     std::vector<struct iovec> m_iovecs;
 
+    PacketTxRing* m_txRing;
+    bool m_txRingReady;
+    int m_packetsPerRow;
+    bool m_partialRows;
+
     int m_panelWidth;
     int m_panelHeight;
     int m_panels;
@@ -81,6 +81,7 @@
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/ip.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -112,6 +113,11 @@
 //1440 channels per packet
 #define DDP_CHANNELS_PER_PACKET 1440
 
+// IPv4 + UDP header bytes that need to fit in the MTU along with the DDP header
+#define DDP_IP_UDP_HEADER_LEN 28
+// largest UDP payload an IPv4 datagram can carry, rounded down to whole pixels
+#define DDP_MAX_CHANNELS_PER_PACKET 65496
+
 #define DDP_PACKET_LEN (DDP_HEADER_LEN + DDP_CHANNELS_PER_PACKET)
 
 static const std::string DDPTYPE = "DDP";
@@ -120,6 +126,41 @@ const std::string& DDPOutputData::GetOutputTypeString() const {
     return DDPTYPE;
 }
 
+// Ask the kernel for the MTU of the route to the controller.  This will
+// be the MTU of the output interface unless a smaller path MTU has been
+// discovered for that destination.
+static int DetectPathMTU(const sockaddr_in& address) {
+    int mtu = 0;
+#ifdef IP_MTU
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s < 0) {
+        return 0;
+    }
+    if (connect(s, (struct sockaddr*)&address, sizeof(address)) == 0) {
+        socklen_t len = sizeof(mtu);
+        if (getsockopt(s, IPPROTO_IP, IP_MTU, &mtu, &len) < 0) {
+            LogWarn(VB_CHANNELOUT, "DDP: Could not determine path MTU: %s\n", strerror(errno));
+            mtu = 0;
+        }
+    }
+    close(s);
+#endif
+    return mtu;
+}
+
+int DDPOutputData::ChannelsPerPacketForMTU(int mtu) {
+    if (mtu <= 0) {
+        return DDP_CHANNELS_PER_PACKET;
+    }
+    int cpp = mtu - DDP_IP_UDP_HEADER_LEN - DDP_HEADER_LEN;
+    // keep packets on pixel boundaries
+    cpp -= cpp % 3;
+    if (cpp < 3) {
+        return DDP_CHANNELS_PER_PACKET;
+    }
+    return std::min(cpp, DDP_MAX_CHANNELS_PER_PACKET);
+}
+
 DDPOutputData::DDPOutputData(const Json::Value& config) :
     UDPOutputData(config),
     sequenceNumber(1) {
@@ -133,8 +174,29 @@ DDPOutputData::DDPOutputData(const Json::Value& config) :
         active = false;
     }
 
-    pktCount = channelCount / DDP_CHANNELS_PER_PACKET;
-    if (channelCount % DDP_CHANNELS_PER_PACKET) {
+    // mtu of 0 uses the standard 1440 channel packets, -1 will use
+    // the MTU of the route to the controller (ex: 9000 for jumbo frames).
+    // A configured MTU larger than the route supports would fragment every
+    // packet so it is clamped to the detected value.
+    if (config.isMember("mtu")) {
+        mtu = config["mtu"].asInt();
+    }
+    if (mtu != 0 && valid) {
+        int pathMTU = DetectPathMTU(ddpAddress);
+        if (mtu < 0) {
+            mtu = pathMTU;
+        } else if (pathMTU > 0 && mtu > pathMTU) {
+            LogWarn(VB_CHANNELOUT, "DDP: Configured MTU %d for %s is larger than the path MTU, using %d\n",
+                    mtu, ipAddress.c_str(), pathMTU);
+            mtu = pathMTU;
+        }
+    } else if (mtu < 0) {
+        mtu = 0;
+    }
+    channelsPerPacket = ChannelsPerPacketForMTU(mtu);
+
+    pktCount = channelCount / channelsPerPacket;
+    if (channelCount % channelsPerPacket) {
         pktCount++;
     }
 
@@ -158,12 +220,12 @@ DDPOutputData::DDPOutputData(const Json::Value& config) :
         ddpBuffers[x][0] = DDP_FLAGS1_VER1;
         ddpBuffers[x][2] = 0;
         ddpBuffers[x][3] = DDP_ID_DISPLAY;
-        int pktSize = DDP_CHANNELS_PER_PACKET;
+        int pktSize = channelsPerPacket;
         if (x == (pktCount - 1)) {
             ddpBuffers[x][0] = DDP_FLAGS1_VER1 | DDP_FLAGS1_PUSH;
             //last packet
-            if (channelCount % DDP_CHANNELS_PER_PACKET) {
-                pktSize = channelCount % DDP_CHANNELS_PER_PACKET;
+            if (channelCount % channelsPerPacket) {
+                pktSize = channelCount % channelsPerPacket;
             }
         }
         ddpIovecs[x * 2 + 1].iov_len = pktSize;
@@ -238,11 +300,14 @@ void DDPOutputData::PrepareData(unsigned char* channelData, UDPOutputMessages& m
     }
 }
 void DDPOutputData::DumpConfig() {
-    LogDebug(VB_CHANNELOUT, "DDP: %s   %d:%d:%d:%d  %s\n",
+    LogDebug(VB_CHANNELOUT, "DDP: %s   %d:%d:%d:%d  %s   MTU: %d   Channels/Packet: %d   Packets: %d\n",
              description.c_str(),
              active,
              startChannel,
              channelCount,
              type,
-             ipAddress.c_str());
+             ipAddress.c_str(),
+             mtu,
+             channelsPerPacket,
+             pktCount);
 }
@@ -35,6 +35,12 @@ public:
     sockaddr_in ddpAddress;
     int pktCount;
 
+    // 0 for standard sized packets, otherwise the MTU used to size the packets
+    int mtu = 0;
+    int channelsPerPacket;
+
+    static int ChannelsPerPacketForMTU(int mtu);
+
     struct iovec* ddpIovecs = nullptr;
     unsigned char** ddpBuffers = nullptr;
 };
@@ -0,0 +1,350 @@
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include "fpp-pch.h"
+
+#ifndef PLATFORM_OSX
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include <sys/mman.h>
+#endif
+
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <fstream>
+#include <sstream>
+
+#include "../common.h"
+#include "../log.h"
+
+#include "PacketTxRing.h"
+
+PacketTxRing::PacketTxRing() :
+    m_fd(-1),
+    m_ring(nullptr),
+    m_ringSize(0),
+    m_frameSize(0),
+    m_frameCount(0),
+    m_maxFrameLen(0),
+    m_dataOffset(0),
+    m_head(0),
+    m_reserved(0) {
+    memset(m_mac, 0, sizeof(m_mac));
+    m_ip.s_addr = INADDR_ANY;
+}
+
+PacketTxRing::~PacketTxRing() {
+    Close();
+}
+
+bool PacketTxRing::Open(const std::string& ifName, int maxFrameLen, int frameCount) {
+#ifdef PLATFORM_OSX
+    LogWarn(VB_CHANNELOUT, "PACKET_TX_RING is not supported on this platform\n");
+    return false;
+#else
+    Close();
+
+    m_ifName = ifName;
+    m_fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (m_fd < 0) {
+        LogErr(VB_CHANNELOUT, "Error creating raw socket for TX ring: %s\n", strerror(errno));
+        return false;
+    }
+
+    // TPACKET_V2 frame headers, the version must be set before the ring is created
+    int val = TPACKET_V2;
+    if (setsockopt(m_fd, SOL_PACKET, PACKET_VERSION, &val, sizeof(val)) < 0) {
+        LogErr(VB_CHANNELOUT, "Error setting PACKET_VERSION: %s\n", strerror(errno));
+        Close();
+        return false;
+    }
+
+    // Drop malformed frames rather than stalling the ring on them
+    val = 1;
+    setsockopt(m_fd, SOL_PACKET, PACKET_LOSS, &val, sizeof(val));
+#ifdef PACKET_QDISC_BYPASS
+    // We pace our own output, skip the qdisc layer
+    setsockopt(m_fd, SOL_PACKET, PACKET_QDISC_BYPASS, &val, sizeof(val));
+#endif
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, ifName.c_str(), IFNAMSIZ - 1);
+    if (ioctl(m_fd, SIOCGIFINDEX, &ifr) < 0) {
+        LogErr(VB_CHANNELOUT, "Error getting index of %s interface: %s\n",
+               ifName.c_str(), strerror(errno));
+        Close();
+        return false;
+    }
+    int ifIndex = ifr.ifr_ifindex;
+
+    if (ioctl(m_fd, SIOCGIFHWADDR, &ifr) == 0) {
+        memcpy(m_mac, ifr.ifr_hwaddr.sa_data, 6);
+    }
+    ifr.ifr_addr.sa_family = AF_INET;
+    if (ioctl(m_fd, SIOCGIFADDR, &ifr) == 0) {
+        m_ip = ((struct sockaddr_in*)&ifr.ifr_addr)->sin_addr;
+    }
+
+    // Frames are a power of two so they pack evenly into page sized blocks
+    m_dataOffset = TPACKET2_HDRLEN - sizeof(struct sockaddr_ll);
+    m_frameSize = TPACKET_ALIGNMENT;
+    while (m_frameSize < (m_dataOffset + maxFrameLen))
+        m_frameSize <<= 1;
+
+    int blockSize = getpagesize();
+    while (blockSize < m_frameSize)
+        blockSize <<= 1;
+
+    int framesPerBlock = blockSize / m_frameSize;
+    int blockCount = (frameCount + framesPerBlock - 1) / framesPerBlock;
+
+    struct tpacket_req req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = blockSize;
+    req.tp_block_nr = blockCount;
+    req.tp_frame_size = m_frameSize;
+    req.tp_frame_nr = blockCount * framesPerBlock;
+
+    if (setsockopt(m_fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) < 0) {
+        LogErr(VB_CHANNELOUT, "Error creating PACKET_TX_RING (%d x %d byte frames): %s\n",
+               req.tp_frame_nr, m_frameSize, strerror(errno));
+        Close();
+        return false;
+    }
+
+    m_ringSize = (size_t)blockSize * blockCount;
+    void* ring = mmap(nullptr, m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (ring == MAP_FAILED) {
+        LogErr(VB_CHANNELOUT, "Error mapping PACKET_TX_RING: %s\n", strerror(errno));
+        m_ringSize = 0;
+        Close();
+        return false;
+    }
+
+    struct sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_ifindex = ifIndex;
+    if (bind(m_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        LogErr(VB_CHANNELOUT, "Could not bind TX ring to interface %s: %s\n",
+               ifName.c_str(), strerror(errno));
+        munmap(ring, m_ringSize);
+        m_ringSize = 0;
+        Close();
+        return false;
+    }
+
+    m_ring = (uint8_t*)ring;
+    m_frameCount = req.tp_frame_nr;
+    m_maxFrameLen = m_frameSize - m_dataOffset;
+    m_head = 0;
+    m_reserved = 0;
+
+    LogDebug(VB_CHANNELOUT, "Opened PACKET_TX_RING on %s: %d frames of %d bytes\n",
+             ifName.c_str(), m_frameCount, m_frameSize);
+
+    return true;
+#endif
+}
+
+void PacketTxRing::Close(void) {
+#ifndef PLATFORM_OSX
+    if (m_ring) {
+        munmap(m_ring, m_ringSize);
+        m_ring = nullptr;
+        m_ringSize = 0;
+    }
+#endif
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_frameCount = 0;
+    m_reserved = 0;
+}
+
+void* PacketTxRing::SlotHeader(int slot) {
+    return m_ring + ((size_t)slot * m_frameSize);
+}
+
+void PacketTxRing::Kick(void) {
+    if (send(m_fd, nullptr, 0, MSG_DONTWAIT) < 0) {
+        if ((errno != EAGAIN) && (errno != ENOBUFS)) {
+            LogExcess(VB_CHANNELOUT, "TX ring send() on %s failed: %s\n",
+                      m_ifName.c_str(), strerror(errno));
+        }
+    }
+}
+
+bool PacketTxRing::Reserve(int count, int timeoutMS) {
+#ifdef PLATFORM_OSX
+    return false;
+#else
+    m_reserved = 0;
+    if (!m_ring || (count > m_frameCount))
+        return false;
+
+    long long startTime = GetTimeMS();
+    for (int i = 0; i < count; i++) {
+        struct tpacket2_hdr* hdr = (struct tpacket2_hdr*)SlotHeader((m_head + i) % m_frameCount);
+        uint32_t status;
+        while ((status = __atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE)) & (TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING)) {
+            if ((GetTimeMS() - startTime) >= timeoutMS)
+                return false;
+
+            // Frames still queued from the last batch, the previous send()
+            // probably hit a full device queue so kick it again
+            if (status & TP_STATUS_SEND_REQUEST)
+                Kick();
+
+            struct pollfd pfd;
+            pfd.fd = m_fd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            poll(&pfd, 1, 1);
+        }
+    }
+
+    m_reserved = count;
+    return true;
+#endif
+}
+
+uint8_t* PacketTxRing::GetFrame(int idx) {
+    return (uint8_t*)SlotHeader((m_head + idx) % m_frameCount) + m_dataOffset;
+}
+
+void PacketTxRing::SetFrameLength(int idx, int len) {
+#ifndef PLATFORM_OSX
+    struct tpacket2_hdr* hdr = (struct tpacket2_hdr*)SlotHeader((m_head + idx) % m_frameCount);
+    hdr->tp_len = len;
+#endif
+}
+
+int PacketTxRing::Commit(void) {
+#ifdef PLATFORM_OSX
+    return -1;
+#else
+    if (!m_ring)
+        return -1;
+
+    int count = m_reserved;
+    for (int i = 0; i < count; i++) {
+        struct tpacket2_hdr* hdr = (struct tpacket2_hdr*)SlotHeader((m_head + i) % m_frameCount);
+        __atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+    }
+
+    m_head = (m_head + count) % m_frameCount;
+    m_reserved = 0;
+
+    if (send(m_fd, nullptr, 0, MSG_DONTWAIT) < 0) {
+        if ((errno != EAGAIN) && (errno != ENOBUFS)) {
+            LogWarn(VB_CHANNELOUT, "TX ring send() on %s failed: %s\n",
+                    m_ifName.c_str(), strerror(errno));
+            return -1;
+        }
+    }
+
+    return count;
+#endif
+}
+
+int PacketTxRing::WriteUDPHeaders(uint8_t* frame, const uint8_t* srcMAC,
+                                  const uint8_t* dstMAC, in_addr srcIP,
+                                  in_addr dstIP, uint16_t srcPort,
+                                  uint16_t dstPort, int payloadLen) {
+    // Ethernet
+    memcpy(frame, dstMAC, 6);
+    memcpy(frame + 6, srcMAC, 6);
+    frame[12] = 0x08;
+    frame[13] = 0x00;
+
+    // IPv4, no options, don't fragment
+    uint8_t* ip = frame + PACKET_TX_RING_ETH_HEADER_LEN;
+    int ipLen = 20 + 8 + payloadLen;
+    ip[0] = 0x45;
+    ip[1] = 0;
+    ip[2] = ipLen >> 8;
+    ip[3] = ipLen & 0xFF;
+    ip[4] = 0;
+    ip[5] = 0;
+    ip[6] = 0x40;
+    ip[7] = 0;
+    ip[8] = 64;
+    ip[9] = IPPROTO_UDP;
+    ip[10] = 0;
+    ip[11] = 0;
+    memcpy(ip + 12, &srcIP.s_addr, 4);
+    memcpy(ip + 16, &dstIP.s_addr, 4);
+
+    uint32_t sum = 0;
+    for (int i = 0; i < 20; i += 2)
+        sum += (ip[i] << 8) | ip[i + 1];
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = ~sum & 0xFFFF;
+    ip[10] = sum >> 8;
+    ip[11] = sum & 0xFF;
+
+    // UDP, checksum is optional on IPv4 so leave it at 0
+    uint8_t* udp = ip + 20;
+    int udpLen = 8 + payloadLen;
+    udp[0] = srcPort >> 8;
+    udp[1] = srcPort & 0xFF;
+    udp[2] = dstPort >> 8;
+    udp[3] = dstPort & 0xFF;
+    udp[4] = udpLen >> 8;
+    udp[5] = udpLen & 0xFF;
+    udp[6] = 0;
+    udp[7] = 0;
+
+    return PACKET_TX_RING_UDP_HEADER_LEN;
+}
+
+bool PacketTxRing::LookupNeighborMAC(const std::string& ip, const std::string& ifName, uint8_t* mac) {
+    // IP address, HW type, Flags, HW address, Mask, Device
+    std::ifstream arp("/proc/net/arp");
+    std::string line;
+
+    std::getline(arp, line); // header
+    while (std::getline(arp, line)) {
+        std::istringstream ss(line);
+        std::string addr, hwType, flags, hwAddr, mask, dev;
+        if (!(ss >> addr >> hwType >> flags >> hwAddr >> mask >> dev))
+            continue;
+
+        if ((addr != ip) || (!ifName.empty() && (dev != ifName)))
+            continue;
+
+        // ATF_COM, entry is complete
+        if (!(strtol(flags.c_str(), nullptr, 16) & 0x02))
+            continue;
+
+        unsigned int m[6];
+        if (sscanf(hwAddr.c_str(), "%x:%x:%x:%x:%x:%x", &m[0], &m[1], &m[2], &m[3], &m[4], &m[5]) != 6)
+            continue;
+
+        for (int i = 0; i < 6; i++)
+            mac[i] = m[i];
+
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,84 @@
+#pragma once
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include <string>
+
+#define PACKET_TX_RING_ETH_HEADER_LEN 14
+#define PACKET_TX_RING_UDP_HEADER_LEN (PACKET_TX_RING_ETH_HEADER_LEN + 20 + 8)
+
+/*
+ * Memory mapped (PACKET_TX_RING) transmit ring on a raw AF_PACKET socket.
+ *
+ * Callers Reserve() a batch of ring slots, write complete ethernet frames
+ * directly into them via GetFrame()/SetFrameLength() and then Commit() the
+ * batch which hands the frames to the kernel with a single send() call.
+ *
+ * The ring is not tied to any protocol.  For unicast UDP to a controller
+ * behind a fixed next hop, WriteUDPHeaders() fills in the ethernet, IPv4
+ * and UDP headers in front of the payload and LookupNeighborMAC() can be
+ * used to find the MAC address of the controller or gateway.
+ */
+class PacketTxRing {
+public:
+    PacketTxRing();
+    ~PacketTxRing();
+
+    // maxFrameLen is the largest ethernet frame (including the ethernet
+    // header) which will be sent, frameCount is the number of ring slots
+    bool Open(const std::string& ifName, int maxFrameLen, int frameCount);
+    void Close(void);
+
+    bool IsOpen(void) const { return m_ring != nullptr; }
+    int GetFrameCount(void) const { return m_frameCount; }
+    int GetMaxFrameLen(void) const { return m_maxFrameLen; }
+    const uint8_t* GetMACAddress(void) const { return m_mac; }
+    in_addr GetIPAddress(void) const { return m_ip; }
+
+    // Wait up to timeoutMS for the next 'count' slots to be free
+    bool Reserve(int count, int timeoutMS);
+
+    // Data pointer for the idx'th reserved slot
+    uint8_t* GetFrame(int idx);
+    void SetFrameLength(int idx, int len);
+
+    // Queue all reserved slots and kick the kernel, returns the number
+    // of frames queued or -1 on error
+    int Commit(void);
+
+    static int WriteUDPHeaders(uint8_t* frame, const uint8_t* srcMAC,
+                               const uint8_t* dstMAC, in_addr srcIP,
+                               in_addr dstIP, uint16_t srcPort,
+                               uint16_t dstPort, int payloadLen);
+    static bool LookupNeighborMAC(const std::string& ip, const std::string& ifName, uint8_t* mac);
+
+private:
+    void* SlotHeader(int slot);
+    void Kick(void);
+
+    int m_fd;
+    uint8_t* m_ring;
+    size_t m_ringSize;
+    int m_frameSize;
+    int m_frameCount;
+    int m_maxFrameLen;
+    int m_dataOffset;
+
+    int m_head;
+    int m_reserved;
+
+    std::string m_ifName;
+    uint8_t m_mac[6];
+    in_addr m_ip;
+};
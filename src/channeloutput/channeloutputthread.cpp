@@ -29,6 +29,7 @@
 #include "../common.h"
 #include "../effects.h"
 #include "../log.h"
+#include "../mediaoutput/AudioAnalysis.h"
 #include "../mediaoutput/SDLOut.h"
 #include "../overlays/PixelOverlay.h"
 #include "../settings.h"
@@ -59,8 +60,56 @@ std::mutex outputThreadStatusLock;
 std::condition_variable outputThreadCond;
 std::condition_variable outputThreadSatusCond;
 
+/* sync packet driven bridge output (BridgeSyncOutput setting) */
+// sync packets arriving within this time of the previous sync driven
+// frame are merged into a single output frame
+#define BRIDGE_SYNC_COALESCE_TIME 3000
+// if no sync packet arrives within this time, fall back to the timer
+#define BRIDGE_SYNC_TIMEOUT 1000000
+volatile int bridgeSyncOutput = 0;
+std::atomic<long long> lastBridgeSyncTime(0);
+std::mutex outputWakeLock;
+std::condition_variable outputWakeCond;
+bool bridgeSyncPending = false;
+bool outputNowPending = false;
+
+/* timestamped MultiSync, master frame times mapped to our monotonic clock */
+// fall back to LightDelay timing if the master timeline isn't updated
+#define MASTER_TIMELINE_TIMEOUT 3000000
+std::mutex masterTimelineLock;
+int masterTimelineFrame = -1;
+long long masterTimelineTime = 0;
+long long masterTimelineUpdated = 0;
+
+/* frame phase locked loop used to keep output aligned to media/master */
+// proportional gain, fraction of the frame period per frame of phase error
+#define FRAME_PLL_KP 0.02
+// integral gain, fraction of the frame period per frame of error per second
+#define FRAME_PLL_KI 0.002
+// maximum fraction the frame period may be trimmed by
+#define FRAME_PLL_MAX_TRIM 0.10
+// phase errors larger than this many seconds are jumped rather than trimmed
+#define FRAME_PLL_MAX_SLEW_TIME 0.5
+// phase error (in frames) to be considered locked/unlocked
+#define FRAME_PLL_LOCK_ERROR 0.5
+#define FRAME_PLL_UNLOCK_ERROR 1.5
+#define FRAME_PLL_LOCK_COUNT 3
+std::mutex framePLLLock;
+double framePLLPhaseError = 0.0;
+double framePLLIntegral = 0.0;
+double framePLLTrim = 0.0;
+long long framePLLLastUpdate = 0;
+int framePLLLockCount = 0;
+bool framePLLLocked = false;
+int framePLLJumps = 0;
+std::atomic<long> lastOutputFrame(-1);
+std::atomic<long long> lastOutputFrameTime(0);
+
 /* prototypes for functions below */
 void CalculateNewChannelOutputDelayForFrame(int expectedFramesSent);
+static void UpdateFramePLL(double expectedFrame);
+static void ResetFramePLL(void);
+static bool GetMasterTimelineDeadline(long long& deadline);
 
 /*
  * Check to see if the channel output thread is running
@@ -91,10 +140,82 @@ void EnableChannelOutput(void) {
 
 void ForceChannelOutputNow(void) {
     LogDebug(VB_CHANNELOUT, "ForceChannelOutputNow()\n");
+    if (bridgeSyncOutput) {
+        std::unique_lock<std::mutex> lock(outputWakeLock);
+        outputNowPending = true;
+        lock.unlock();
+        outputWakeCond.notify_all();
+    }
     outputThreadSatusCond.notify_all();
     outputThreadCond.notify_all();
 }
 
+/*
+ * Called when an E1.31 Sync, ArtSync or DDP Push packet is received
+ */
+void BridgeSyncReceived(void) {
+    if (!bridgeSyncOutput) {
+        ForceChannelOutputNow();
+        return;
+    }
+    lastBridgeSyncTime = GetTime();
+    std::unique_lock<std::mutex> lock(outputWakeLock);
+    bridgeSyncPending = true;
+    lock.unlock();
+    outputWakeCond.notify_all();
+    outputThreadSatusCond.notify_all();
+}
+
+/*
+ * Bridge only output with sync packets recently received, frames are
+ * output when the sync packets arrive rather than on the timer
+ */
+static inline bool WaitingForBridgeSync() {
+    return bridgeSyncOutput &&
+           !sequence->IsSequenceRunning() &&
+           sequence->hasBridgeData() &&
+           ((GetTime() - lastBridgeSyncTime) < BRIDGE_SYNC_TIMEOUT);
+}
+
+/*
+ * Wait for the next sync packet.  Returns true if output was triggered by
+ * a sync packet or a forced output, false on timeout.
+ */
+static bool WaitForBridgeSync(long long frameStartTime) {
+    std::unique_lock<std::mutex> lock(outputWakeLock);
+    outputWakeCond.wait_for(lock, std::chrono::microseconds(BRIDGE_SYNC_TIMEOUT), []() {
+        return bridgeSyncPending || outputNowPending || !RunThread;
+    });
+    bool syncPending = bridgeSyncPending;
+    bool triggered = bridgeSyncPending || outputNowPending;
+    bridgeSyncPending = false;
+    outputNowPending = false;
+    lock.unlock();
+
+    if (syncPending) {
+        // sync packets arriving right after the previous frame (ex: multiple
+        // DDP senders or senders setting PUSH on every packet) are merged
+        // into a single frame sent once the coalesce time has passed
+        long long coalesceTime = frameStartTime + BRIDGE_SYNC_COALESCE_TIME - GetTime();
+        if (coalesceTime > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(coalesceTime));
+            lock.lock();
+            bridgeSyncPending = false;
+            lock.unlock();
+        }
+    }
+    return triggered;
+}
+
+/*
+ * Frame number and monotonic time of the last frame sent to the outputs
+ */
+bool GetLastOutputFrame(long& frame, long long& frameTime) {
+    frameTime = lastOutputFrameTime;
+    frame = lastOutputFrame;
+    return frame >= 0;
+}
+
 static inline bool forceOutput() {
     return IsEffectRunning() ||
            PixelOverlayManager::INSTANCE.hasActiveOverlays() ||
@@ -120,6 +241,7 @@ void* RunChannelOutputThread(void* data) {
     int slowFrameCount = 0;
 
     alwaysTransmit = getSettingInt("alwaysTransmit");
+    bridgeSyncOutput = getSettingInt("BridgeSyncOutput");
 
     LogDebug(VB_CHANNELOUT, "RunChannelOutputThread() starting\n");
 
@@ -173,6 +295,8 @@ void* RunChannelOutputThread(void* data) {
                     loops++;
                 }
             }
+            lastOutputFrameTime = GetMonotonicTime();
+            lastOutputFrame = channelOutputFrame;
             sequence->SendSequenceData();
         }
 
@@ -187,6 +311,9 @@ void* RunChannelOutputThread(void* data) {
         }
         readTime = GetTime();
 
+        // analyze the audio once so overlays/effects for this frame can share it
+        AudioAnalysis::INSTANCE.Process();
+
         int msTime = 1000.0 * channelOutputFrame / RefreshRate;
         if (!sequence->IsSequenceRunning()) {
             msTime = mediaElapsedSeconds * 1000;
@@ -260,8 +387,23 @@ void* RunChannelOutputThread(void* data) {
         }
         statusLock.unlock();
         doForceOutput = false;
+        if (RunThread && WaitingForBridgeSync()) {
+            if (WaitForBridgeSync(startTime)) {
+                doForceOutput = true;
+            }
+            continue;
+        }
         // Calculate how long we need to nanosleep()
-        long dt = (LightDelay - (GetTime() - startTime)) * 1000;
+        long dt;
+        long long deadline = 0;
+        if (GetMasterTimelineDeadline(deadline)) {
+            dt = (deadline - GetMonotonicTime()) * 1000;
+            // if we are well ahead, the next sync packet will hold a frame
+            if (dt > (LightDelay * 2000L))
+                dt = LightDelay * 2000L;
+        } else {
+            dt = (LightDelay - (GetTime() - startTime)) * 1000;
+        }
         if (RunThread && dt > 0) {
             if (outputThreadCond.wait_for(lock, std::chrono::nanoseconds(dt)) == std::cv_status::no_timeout) {
                 LogDebug(VB_CHANNELOUT, "Forced output\n");
@@ -297,6 +439,23 @@ float GetChannelOutputRefreshRate() {
     return RefreshRate;
 }
 
+/*
+ * Returns the monotonic time the next frame should be output at if we
+ * are a remote following a master which sends timestamped sync packets
+ */
+static bool GetMasterTimelineDeadline(long long& deadline) {
+    if ((getFPPmode() != REMOTE_MODE) || !sequence->IsSequenceRunning())
+        return false;
+
+    std::unique_lock<std::mutex> lock(masterTimelineLock);
+    if ((masterTimelineFrame < 0) ||
+        ((GetMonotonicTime() - masterTimelineUpdated) > MASTER_TIMELINE_TIMEOUT))
+        return false;
+
+    deadline = masterTimelineTime + ((long long)channelOutputFrame - masterTimelineFrame) * SequenceLightDelay;
+    return true;
+}
+
 /*
  * Kick off the channel output thread
  */
@@ -396,6 +555,10 @@ void StopForcingChannelOutput(void) {
  */
 void ResetMasterPosition(void) {
     MasterFramesPlayed = -1;
+    ResetFramePLL();
+
+    std::unique_lock<std::mutex> lock(masterTimelineLock);
+    masterTimelineFrame = -1;
 }
 
 /*
@@ -406,6 +569,27 @@ void UpdateMasterPosition(int frameNumber) {
     CalculateNewChannelOutputDelayForFrame(frameNumber);
 }
 
+/*
+ * Update the master's timeline, frameTime is our monotonic time that the
+ * master output frameNumber.  The output thread schedules frames against
+ * this so only gross differences need frames skipped or held.
+ */
+void UpdateMasterTimeline(int frameNumber, long long frameTime) {
+    MasterFramesPlayed = frameNumber;
+
+    long long now = GetMonotonicTime();
+    std::unique_lock<std::mutex> lock(masterTimelineLock);
+    masterTimelineFrame = frameNumber;
+    masterTimelineTime = frameTime;
+    masterTimelineUpdated = now;
+    lock.unlock();
+
+    int expectedFrame = frameNumber + (int)((now - frameTime) / SequenceLightDelay);
+    int diff = (int)channelOutputFrame - expectedFrame;
+    if ((diff > 2) || (diff < -2))
+        CalculateNewChannelOutputDelayForFrame(expectedFrame);
+}
+
 /*
  * Calculate the new sync offset based on the current position reported
  * by the media player.
@@ -426,81 +610,125 @@ void CalculateNewChannelOutputDelay(float mediaPosition) {
 
     float offsetMediaPosition = mediaPosition - mediaOffset;
 
-    int expectedFramesSent = (int)(offsetMediaPosition * RefreshRate);
+    double expectedFrame = offsetMediaPosition * RefreshRate;
 
     LogDebug(VB_CHANNELOUT,
-             "Media Position: %.2f, Offset: %.3f, Frames Sent: %d, Expected: %d, Diff: %d\n",
-             mediaPosition, mediaOffset, channelOutputFrame, expectedFramesSent,
-             channelOutputFrame - expectedFramesSent);
+             "Media Position: %.2f, Offset: %.3f, Frames Sent: %d, Expected: %.2f\n",
+             mediaPosition, mediaOffset, channelOutputFrame, expectedFrame);
 
-    CalculateNewChannelOutputDelayForFrame(expectedFramesSent);
+    UpdateFramePLL(expectedFrame);
 }
 
 /*
  * Calculate the new sync offset based on a desired frame number
  */
 void CalculateNewChannelOutputDelayForFrame(int expectedFramesSent) {
-    int diff = channelOutputFrame - expectedFramesSent;
-    if (!multiSync->isMultiSyncEnabled()) {
-        if (diff < -4) {
-            // pretty far behind master, lets just skip forward
-            if (diff > -(RefreshRate / 2)) {
-                LogDebug(VB_CHANNELOUT, "Skipping a few frames - We are at %d, master is at: %d\n", channelOutputFrame, expectedFramesSent);
-                // off, but not super off, we'll skip a few frames, but not too much to try and keep using
-                // the frames in the cache and avoid hitting the storage, we'll then have the OS preload
-                // the next bunch and we can skip a few more next time
-                FrameSkip = 4;
-                diff += 4;
+    UpdateFramePLL(expectedFramesSent);
+}
+
+/*
+ * Phase locked loop which trims the frame period to keep the output frame
+ * position aligned with the expected position from the media player or
+ * the master.  The phase error is fractional, our position is interpolated
+ * from the time the last frame was sent.  A PI controller converts it into
+ * a trim of the frame period, bounded to FRAME_PLL_MAX_TRIM, so small
+ * errors are slewed out over a second or two instead of stepping LightDelay.
+ */
+static void UpdateFramePLL(double expectedFrame) {
+    int DefaultLightDelay = sequence->IsSequenceRunning() ? SequenceLightDelay : BridgeLightDelay;
+    long long now = GetMonotonicTime();
+
+    double position = channelOutputFrame;
+    long frame = lastOutputFrame;
+    if (frame >= 0) {
+        position = frame + ((double)(now - lastOutputFrameTime) / LightDelay);
+    }
+
+    double error = position - expectedFrame;
+
+    std::unique_lock<std::mutex> lock(framePLLLock);
+    if (std::abs(error) > (RefreshRate * FRAME_PLL_MAX_SLEW_TIME)) {
+        // too far off to slew in a reasonable time
+        if (error < 0) {
+            if (!multiSync->isMultiSyncEnabled()) {
+                LogDebug(VB_CHANNELOUT, "Skipping frames - We are at %.2f, expected: %.2f\n", position, expectedFrame);
+                FrameSkip = (int)std::lround(expectedFrame) - (int)channelOutputFrame;
+                framePLLJumps++;
+                framePLLTrim = 0.0;
             } else {
-                LogDebug(VB_CHANNELOUT, "Skipping many frames - We are at %d, master is at: %d\n", channelOutputFrame, expectedFramesSent);
-                // more than 1/2 second behind, just jump
-                FrameSkip = expectedFramesSent - channelOutputFrame;
-                LightDelay = sequence->IsSequenceRunning() ? SequenceLightDelay : BridgeLightDelay;
-                return;
+                // A MultiSync master skipping would make every remote jump
+                // too, catch up to the media as fast as we can instead
+                framePLLTrim = -FRAME_PLL_MAX_TRIM;
             }
-        } else if (diff > 2) {
-            // hold the last frame
-            FrameSkip = -1;
-            diff--;
-        }
-    }
-    int DefaultLightDelay = sequence->IsSequenceRunning() ? SequenceLightDelay : BridgeLightDelay;
-    if (diff > 1 || diff < -1) {
-        int timerOffset = diff * (DefaultLightDelay / 100);
-        int newLightDelay = LightDelay;
-        if (channelOutputFrame > expectedFramesSent) {
-            // correct if we slingshot past 0, otherwise offset further
-            if (LightDelay < DefaultLightDelay)
-                newLightDelay = DefaultLightDelay;
-            else
-                newLightDelay += timerOffset;
+            framePLLIntegral = 0.0;
         } else {
-            // correct if we slingshot past 0, otherwise offset further
-            if (LightDelay > DefaultLightDelay)
-                newLightDelay = DefaultLightDelay;
-            else
-                newLightDelay += timerOffset;
+            // way ahead, hold frames and slow down as much as we can.  A
+            // MultiSync master holding would stall every remote with it
+            if (!multiSync->isMultiSyncEnabled()) {
+                FrameSkip = -1;
+            }
+            framePLLTrim = FRAME_PLL_MAX_TRIM;
         }
+        framePLLPhaseError = error;
+        framePLLLastUpdate = 0;
+        framePLLLockCount = 0;
+        framePLLLocked = false;
+        LightDelay = DefaultLightDelay * (1.0 + framePLLTrim);
+        return;
+    }
 
-        // Don't let us go more than 15ms out from the default.  If we
-        // can't keep up using that delta then we probably won't be able to.
-        if ((DefaultLightDelay - 15000) > newLightDelay)
-            newLightDelay = DefaultLightDelay - 15000;
-
-        LogDebug(VB_CHANNELOUT, "LightDelay: %d, newLightDelay: %d,   DiffFrames: %d     %d/%d\n",
-                 LightDelay, newLightDelay, diff, channelOutputFrame, expectedFramesSent);
-        LightDelay = newLightDelay;
-    } else if (diff == -1) {
-        // for the one frame off cases, keep the existing light delay unless the
-        // previous "off" frame was on the other side of default
-        if (LightDelay > DefaultLightDelay) {
-            LightDelay = DefaultLightDelay;
-        }
-    } else if (diff == 1) {
-        if (LightDelay < DefaultLightDelay) {
-            LightDelay = DefaultLightDelay;
-        }
-    } else if (LightDelay != DefaultLightDelay) {
-        LightDelay = DefaultLightDelay;
+    double dt = 0.0;
+    if (framePLLLastUpdate) {
+        dt = (now - framePLLLastUpdate) / 1000000.0;
+        if (dt > 2.0)
+            dt = 2.0;
+    }
+    framePLLLastUpdate = now;
+
+    // only integrate while the output isn't saturated so a large initial
+    // error doesn't wind up the integrator and overshoot
+    if (std::abs((FRAME_PLL_KP * error) + framePLLIntegral) < FRAME_PLL_MAX_TRIM) {
+        framePLLIntegral += FRAME_PLL_KI * error * dt;
+        framePLLIntegral = std::clamp(framePLLIntegral, -FRAME_PLL_MAX_TRIM, FRAME_PLL_MAX_TRIM);
     }
+
+    framePLLTrim = std::clamp((FRAME_PLL_KP * error) + framePLLIntegral, -FRAME_PLL_MAX_TRIM, FRAME_PLL_MAX_TRIM);
+    framePLLPhaseError = error;
+
+    if (std::abs(error) <= FRAME_PLL_LOCK_ERROR) {
+        if (framePLLLockCount < FRAME_PLL_LOCK_COUNT)
+            framePLLLockCount++;
+        if (framePLLLockCount >= FRAME_PLL_LOCK_COUNT)
+            framePLLLocked = true;
+    } else if (std::abs(error) > FRAME_PLL_UNLOCK_ERROR) {
+        framePLLLockCount = 0;
+        framePLLLocked = false;
+    }
+
+    int newLightDelay = DefaultLightDelay * (1.0 + framePLLTrim);
+
+    LogDebug(VB_CHANNELOUT, "LightDelay: %d, newLightDelay: %d, PhaseError: %.3f frames, Trim: %.2f%%, Locked: %d\n",
+             LightDelay, newLightDelay, error, framePLLTrim * 100.0, framePLLLocked);
+
+    LightDelay = newLightDelay;
+}
+
+static void ResetFramePLL(void) {
+    std::unique_lock<std::mutex> lock(framePLLLock);
+    framePLLPhaseError = 0.0;
+    framePLLIntegral = 0.0;
+    framePLLTrim = 0.0;
+    framePLLLastUpdate = 0;
+    framePLLLockCount = 0;
+    framePLLLocked = false;
+}
+
+void GetChannelOutputSyncStatus(Json::Value& result) {
+    std::unique_lock<std::mutex> lock(framePLLLock);
+    result["phaseError"] = framePLLPhaseError;
+    result["trimPercent"] = framePLLTrim * 100.0;
+    result["integralPercent"] = framePLLIntegral * 100.0;
+    result["frameTimeUS"] = LightDelay;
+    result["locked"] = framePLLLocked;
+    result["jumps"] = framePLLJumps;
 }
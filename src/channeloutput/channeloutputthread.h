@@ -16,6 +16,7 @@ void EnableChannelOutput(void);
 void InitChannelOutputSyncVars(void);
 void DestroyChannelOutputSyncVars(void);
 void ForceChannelOutputNow(void);
+void BridgeSyncReceived(void);
 
 int ChannelOutputThreadIsRunning(void);
 int ChannelOutputThreadIsEnabled();
@@ -27,5 +28,8 @@ void StartForcingChannelOutput(void);
 void StopForcingChannelOutput(void);
 void ResetMasterPosition(void);
 void UpdateMasterPosition(int frameNumber);
+void UpdateMasterTimeline(int frameNumber, long long frameTime);
 void CalculateNewChannelOutputDelay(float mediaPosition);
 void CalculateNewChannelOutputDelayForFrame(int expectedFramesSent);
+void GetChannelOutputSyncStatus(Json::Value& result);
+bool GetLastOutputFrame(long& frame, long long& frameTime);
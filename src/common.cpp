@@ -72,6 +72,15 @@ long long GetTimeMS(void) {
     return now_tv.tv_sec * 1000LL + now_tv.tv_usec / 1000;
 }
 
+/*
+ * Microseconds from a clock which is not affected by wall clock changes
+ */
+long long GetMonotonicTime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
 std::string GetTimeStr(std::string fmt) {
     auto t = std::time(nullptr);
     auto tm = *std::localtime(&t);
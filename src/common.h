@@ -55,6 +55,7 @@
 long long GetTime();
 long long GetTimeMicros();
 long long GetTimeMS();
+long long GetMonotonicTime();
 std::string GetTimeStr(std::string fmt);
 std::string GetDateStr(std::string fmt);
 
@@ -20,6 +20,10 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
+#ifndef PLATFORM_OSX
+#include <linux/filter.h>
+#endif
+#include <poll.h>
 #include <algorithm>
 #include <cstdlib>
 #include <errno.h>
@@ -57,35 +61,74 @@ int bridgeSock = -1;
 int ddpSock = -1;
 int artnetSock = -1;
 
-long long last_packet_time = GetTimeMS();
+std::atomic<long long> last_packet_time(GetTimeMS());
 long long expireOffSet = 1000; //expire after 1 second
 
 #define MAX_MSG 48
-#define BUFSIZE 1500
-struct mmsghdr msgs[MAX_MSG];
-struct iovec iovecs[MAX_MSG];
-uint8_t buffers[MAX_MSG][BUFSIZE + 1];
-struct sockaddr_in inAddress[MAX_MSG];
+// large enough for DDP packets sent with jumbo (9000 MTU) frames
+#define BUFSIZE 9000
+
+class BridgeReceiveBuffers {
+public:
+    BridgeReceiveBuffers() {
+        memset(msgs, 0, sizeof(msgs));
+        for (int i = 0; i < MAX_MSG; i++) {
+            iovecs[i].iov_base = buffers[i];
+            iovecs[i].iov_len = BUFSIZE;
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+            msgs[i].msg_hdr.msg_name = &inAddress[i];
+        }
+    }
 
+    struct mmsghdr msgs[MAX_MSG];
+    struct iovec iovecs[MAX_MSG];
+    uint8_t buffers[MAX_MSG][BUFSIZE + 1];
+    struct sockaddr_in inAddress[MAX_MSG];
+};
+// buffers used for sockets processed on the main loop
+static BridgeReceiveBuffers mainLoopBuffers;
+
+// Optional receive threads (BridgeReceiveThreads setting).  Each thread has
+// its own SO_REUSEPORT socket and buffers and writes directly into the
+// sequence bridge buffer.
+static volatile bool runBridgeReceiveThreads = false;
+static std::list<std::thread*> bridgeReceiveThreads;
+// additional sockets for the threads, socket -> isDDP
+static std::list<std::pair<int, bool>> bridgeReceiveThreadSockets;
+
+// ranges received in the current batch of packets, recorded with a single
+// lock once the batch has been processed
+static thread_local std::vector<std::pair<uint32_t, uint32_t>> pendingBridgeRanges;
+
+// Universe number -> InputUniverses index, filled in before the receive
+// threads are started and only read after that
 unsigned int UniverseCache[65536];
 
 std::vector<UniverseEntry> InputUniverses;
 int InputUniverseCount;
 
-static uint64_t ddpBytesReceived = 0;
-static uint32_t ddpPacketsReceived = 0;
-static uint32_t ddpErrors = 0;
+static std::atomic<uint64_t> ddpBytesReceived(0);
+static std::atomic<uint32_t> ddpPacketsReceived(0);
+static std::atomic<uint32_t> ddpErrors(0);
 
-static uint32_t ddpLastSequence = 0;
-static uint32_t ddpLastChannel = 0;
-static uint32_t ddpMinChannel = 0xFFFFFFF;
-static uint32_t ddpMaxChannel = 0;
+// Sequence numbers are tracked per receiving thread, SO_REUSEPORT hashes
+// each sender to a single socket so a sender's packets stay in order
+static thread_local uint32_t ddpLastSequence = 0;
+static thread_local uint32_t ddpLastChannel = 0;
+static std::atomic<uint32_t> ddpMinChannel(0xFFFFFFF);
+static std::atomic<uint32_t> ddpMaxChannel(0);
 
-static uint32_t e131Errors = 0;
-static uint32_t e131SyncPackets = 0;
-static UniverseEntry unknownUniverse;
+static std::atomic<uint32_t> e131Errors(0);
+static std::atomic<uint32_t> e131SyncPackets(0);
+static std::atomic<uint32_t> artnetSyncPackets(0);
+// data for universes which are not configured, may be counted on any
+// of the receive threads
+static std::atomic<uint32_t> unknownUniverseBytes(0);
+static std::atomic<uint32_t> unknownUniversePackets(0);
 
-static bool bridgeDataReceived = false;
+static volatile bool bridgeDataReceived = false;
 
 static std::map<int, std::function<bool(uint8_t* data, long long packetTime)>> ArtNetOpcodeHandlers;
 
@@ -223,10 +266,17 @@ bool LoadInputUniversesFromFile(void) {
 }
 
 inline void SetBridgeData(uint8_t* data, int startChannel, int len, long long packetTime) {
-    last_packet_time = packetTime;
-    packetTime += expireOffSet;
-    bridgeDataReceived = true;
-    sequence->SetBridgeData(data, startChannel, len, packetTime);
+    if (sequence->CopyBridgeData(data, startChannel, len)) {
+        pendingBridgeRanges.emplace_back(startChannel, len);
+    }
+}
+static void FlushBridgeRanges(long long packetTime) {
+    if (!pendingBridgeRanges.empty()) {
+        last_packet_time = packetTime;
+        bridgeDataReceived = true;
+        sequence->SetBridgeRanges(pendingBridgeRanges, packetTime + expireOffSet);
+        pendingBridgeRanges.clear();
+    }
 }
 
 double GetSecondsFromInputPacket() {
@@ -239,40 +289,44 @@ double GetSecondsFromInputPacket() {
 /*
  * Read data waiting for us
  */
-bool Bridge_ReceiveE131Data(void) {
+static bool Bridge_ReceiveE131Data(int sock, BridgeReceiveBuffers& rb) {
     //	LogExcess(VB_E131BRIDGE, "Bridge_ReceiveData()\n");
-
-    int msgcnt = recvmmsg(bridgeSock, msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
+    // E1.31 payloads are too small for zero copy receive to pay for the
+    // extra system call, they are always received in batches
+    int msgcnt = recvmmsg(sock, rb.msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
     bool sync = false;
     long long packetTime = GetTimeMS();
     while (msgcnt > 0) {
         for (int x = 0; x < msgcnt; x++) {
-            sync |= Bridge_StoreData((uint8_t*)buffers[x], packetTime);
+            sync |= Bridge_StoreData((uint8_t*)rb.buffers[x], packetTime);
         }
-        msgcnt = recvmmsg(bridgeSock, msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
+        FlushBridgeRanges(packetTime);
+        msgcnt = recvmmsg(sock, rb.msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
     }
     return sync;
 }
-bool Bridge_ReceiveDDPData(void) {
+static bool Bridge_ReceiveDDPData(int sock, BridgeReceiveBuffers& rb) {
     //    LogExcess(VB_E131BRIDGE, "Bridge_ReceiveData()\n");
-    int msgcnt = recvmmsg(ddpSock, msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
+    int msgcnt = recvmmsg(sock, rb.msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
     bool sync = false;
     long long packetTime = GetTimeMS();
     while (msgcnt > 0) {
         for (int x = 0; x < msgcnt; x++) {
-            sync |= Bridge_StoreDDPData((uint8_t*)buffers[x], packetTime);
+            sync |= Bridge_StoreDDPData((uint8_t*)rb.buffers[x], packetTime);
         }
-        msgcnt = recvmmsg(ddpSock, msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
+        FlushBridgeRanges(packetTime);
+        msgcnt = recvmmsg(sock, rb.msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
     }
     return sync;
 }
 bool Bridge_ReceiveArtNetData(void) {
-    int msgcnt = recvmmsg(artnetSock, msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
+    BridgeReceiveBuffers& rb = mainLoopBuffers;
+    int msgcnt = recvmmsg(artnetSock, rb.msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
     bool sync = false;
     long long packetTime = GetTimeMS();
     while (msgcnt > 0) {
         for (int x = 0; x < msgcnt; x++) {
-            uint8_t* bridgeBuffer = (uint8_t*)buffers[x];
+            uint8_t* bridgeBuffer = (uint8_t*)rb.buffers[x];
             if (bridgeBuffer[0] != 'A' || bridgeBuffer[1] != 'r' || bridgeBuffer[2] != 't' || bridgeBuffer[3] != '-' || bridgeBuffer[4] != 'N' || bridgeBuffer[5] != 'e' || bridgeBuffer[6] != 't' || bridgeBuffer[7] != 0 || bridgeBuffer[11] != 0xE) { //version must be 14
                 continue;
             }
@@ -282,24 +336,133 @@ bool Bridge_ReceiveArtNetData(void) {
                 sync |= cb->second(bridgeBuffer, packetTime);
             }
         }
-        msgcnt = recvmmsg(artnetSock, msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
+        FlushBridgeRanges(packetTime);
+        msgcnt = recvmmsg(artnetSock, rb.msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
     }
     return sync;
 }
 
-bool Bridge_Initialize_Internal() {
-    LogExcess(VB_E131BRIDGE, "Bridge_Initialize()\n");
+static int GetBridgeReceiveThreadCount() {
+#if defined(SO_REUSEPORT) && !defined(PLATFORM_OSX)
+    int count = getSettingInt("BridgeReceiveThreads", 0);
+    if (count < 0) {
+        count = std::thread::hardware_concurrency();
+    }
+    return std::min(count, 16);
+#else
+    return 0;
+#endif
+}
+
+static int CreateBridgeSocket(int port, const std::string& protocol, bool reusePort) {
+    int sock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (sock < 0) {
+        LogDebug(VB_E131BRIDGE, "e131bridge %s socket failed: %s", protocol.c_str(), strerror(errno));
+        exit(1);
+    }
+#if defined(SO_REUSEPORT) && !defined(PLATFORM_OSX)
+    if (reusePort) {
+        int enable = 1;
+        setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+#ifdef IP_MULTICAST_ALL
+        // only receive multicast for groups joined on this socket, otherwise
+        // every socket in the group would get a copy of every packet
+        int disable = 0;
+        setsockopt(sock, IPPROTO_IP, IP_MULTICAST_ALL, &disable, sizeof(disable));
+#endif
+    }
+#endif
+    memset((char*)&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    addrlen = sizeof(addr);
+    // Bind the socket to address/port
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        LogDebug(VB_E131BRIDGE, "e131bridge %s bind failed: %s", protocol.c_str(), strerror(errno));
+        exit(1);
+    }
+    return sock;
+}
 
-    // prepare the msg receive buffers
-    memset(msgs, 0, sizeof(msgs));
-    for (int i = 0; i < MAX_MSG; i++) {
-        iovecs[i].iov_base = buffers[i];
-        iovecs[i].iov_len = BUFSIZE;
-        msgs[i].msg_hdr.msg_iov = &iovecs[i];
-        msgs[i].msg_hdr.msg_iovlen = 1;
-        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
-        msgs[i].msg_hdr.msg_name = &inAddress[i];
+// Send unicast E1.31 packets to the socket at index (universe % count) of
+// the SO_REUSEPORT group so each universe is always handled by the same
+// thread.  Multicast is split the same way by the groups each socket joins.
+static void AttachE131ReuseportFilter(int sock, int count) {
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && !defined(PLATFORM_OSX)
+    struct sock_filter code[] = {
+        { BPF_LD | BPF_H | BPF_ABS, 0, 0, E131_UNIVERSE_INDEX },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, (uint32_t)count },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    struct sock_fprog prog;
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0) {
+        LogWarn(VB_E131BRIDGE, "Could not attach E1.31 reuseport filter: %s\n", strerror(errno));
     }
+#endif
+}
+
+static void JoinE131MulticastGroups(int sock, int index, int count) {
+    int UniverseOctet[2];
+    struct ip_mreq mreq;
+    char strMulticastGroup[16];
+
+    //get all the addresses
+    struct ifaddrs *interfaces, *tmp;
+    getifaddrs(&interfaces);
+
+    char address[16];
+    address[0] = 0;
+    // Join the multicast groups
+    for (int i = 0; i < InputUniverseCount; i++) {
+        if (InputUniverses[i].type == E131_TYPE_MULTICAST && (InputUniverses[i].universe % count) == index) {
+            UniverseOctet[0] = InputUniverses[i].universe / 256;
+            UniverseOctet[1] = InputUniverses[i].universe % 256;
+            snprintf(strMulticastGroup, sizeof(strMulticastGroup), "239.255.%d.%d", UniverseOctet[0], UniverseOctet[1]);
+            mreq.imr_multiaddr.s_addr = inet_addr(strMulticastGroup);
+
+            LogInfo(VB_E131BRIDGE, "Adding group %s\n", strMulticastGroup);
+
+            // add group to groups to listen for on eth0 and wlan0 if it exists
+            int multicastJoined = 0;
+            tmp = interfaces;
+            //loop through all the interfaces and subscribe to the group
+            while (tmp) {
+                //struct sockaddr_in *sin = (struct sockaddr_in *)tmp->ifa_addr;
+                //strcpy(address, inet_ntoa(sin->sin_addr));
+                if (tmp->ifa_addr && tmp->ifa_addr->sa_family == AF_INET) {
+                    GetInterfaceAddress(tmp->ifa_name, address, NULL, NULL);
+                    if (strcmp(address, "127.0.0.1")) {
+                        LogDebug(VB_E131BRIDGE, "   Adding interface %s - %s\n", tmp->ifa_name, address);
+                        mreq.imr_interface.s_addr = inet_addr(address);
+                        if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+                            LogWarn(VB_E131BRIDGE, "   Could not setup Multicast Group for interface %s\n", tmp->ifa_name);
+                        }
+                        multicastJoined = 1;
+                    }
+                } else if (tmp->ifa_addr && tmp->ifa_addr->sa_family == AF_INET6) {
+                    //FIXME for ipv6 multicast
+                    //LogDebug(VB_E131BRIDGE, "   Inet6 interface %s\n", tmp->ifa_name);
+                }
+                tmp = tmp->ifa_next;
+            }
+
+            if (!multicastJoined) {
+                LogDebug(VB_E131BRIDGE, "  Binding to default interface\n");
+                mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+                if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+                    LogWarn(VB_E131BRIDGE, "   Could not setup Multicast Group\n");
+                }
+            }
+        }
+    }
+    freeifaddrs(interfaces);
+}
+
+bool Bridge_Initialize_Internal(int receiveThreads) {
+    LogExcess(VB_E131BRIDGE, "Bridge_Initialize()\n");
 
     /* Initialize our Universe Index lookup cache */
     for (int i = 0; i < 65536; i++) {
@@ -309,6 +472,14 @@ bool Bridge_Initialize_Internal() {
     bool enabled = LoadInputUniversesFromFile();
     bool disableFakeBridges = getSettingInt("DisableFakeNetworkBridges");
 
+    // the first entry wins if a universe is configured more than once
+    for (int index = 0; index < InputUniverseCount; index++) {
+        uint32_t universe = InputUniverses[index].universe;
+        if ((universe < 65536) && (UniverseCache[universe] == BRIDGE_INVALID_UNIVERSE_INDEX)) {
+            UniverseCache[universe] = index;
+        }
+    }
+
     LogInfo(VB_E131BRIDGE, "Universe Count = %d\n", InputUniverseCount);
     InputUniversesPrint();
 
@@ -320,21 +491,14 @@ bool Bridge_Initialize_Internal() {
     int i2 = socket(AF_INET, SOCK_DGRAM, 0);
     int i3 = socket(AF_INET, SOCK_DGRAM, 0);
 
+    if (!enabled) {
+        // sockets are only used to detect data that isn't being bridged
+        receiveThreads = 0;
+    }
     if (enabled || !disableFakeBridges) {
-        ddpSock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
-        if (ddpSock < 0) {
-            LogDebug(VB_E131BRIDGE, "e131bridge DDP socket failed: %s", strerror(errno));
-            exit(1);
-        }
-        memset((char*)&addr, 0, sizeof(addr));
-        addr.sin_family = AF_INET;
-        addr.sin_addr.s_addr = htonl(INADDR_ANY);
-        addr.sin_port = htons(DDP_PORT);
-        addrlen = sizeof(addr);
-        // Bind the socket to address/port
-        if (bind(ddpSock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-            LogDebug(VB_E131BRIDGE, "e131bridge DDP bind failed: %s", strerror(errno));
-            exit(1);
+        ddpSock = CreateBridgeSocket(DDP_PORT, "DDP", receiveThreads > 0);
+        for (int x = 1; x < receiveThreads; x++) {
+            bridgeReceiveThreadSockets.emplace_back(CreateBridgeSocket(DDP_PORT, "DDP", true), true);
         }
     }
 
@@ -351,82 +515,22 @@ bool Bridge_Initialize_Internal() {
     }
 
     if (hase131 || !disableFakeBridges) {
-        int UniverseOctet[2];
-        struct ip_mreq mreq;
-        char strMulticastGroup[16];
-        /* set up socket */
-        bridgeSock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
-        if (bridgeSock < 0) {
-            LogDebug(VB_E131BRIDGE, "e131bridge socket failed: %s", strerror(errno));
-            exit(1);
-        }
-
         // FIXME, move this to /etc/sysctl.conf or our startup script
 #ifndef PLATFORM_OSX
         system("sudo sysctl net/ipv4/igmp_max_memberships=512");
 #endif
 
-        memset((char*)&addr, 0, sizeof(addr));
-        addr.sin_family = AF_INET;
-        addr.sin_addr.s_addr = htonl(INADDR_ANY);
-        addr.sin_port = htons(E131_DEST_PORT);
-        addrlen = sizeof(addr);
-        // Bind the socket to address/port
-        if (bind(bridgeSock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-            LogDebug(VB_E131BRIDGE, "e131bridge bind failed: %s", strerror(errno));
-            exit(1);
+        int e131Threads = hase131 ? receiveThreads : 0;
+        bridgeSock = CreateBridgeSocket(E131_DEST_PORT, "E1.31", e131Threads > 0);
+        JoinE131MulticastGroups(bridgeSock, 0, std::max(e131Threads, 1));
+        for (int x = 1; x < e131Threads; x++) {
+            int sock = CreateBridgeSocket(E131_DEST_PORT, "E1.31", true);
+            JoinE131MulticastGroups(sock, x, e131Threads);
+            bridgeReceiveThreadSockets.emplace_back(sock, false);
         }
-
-        //get all the addresses
-        struct ifaddrs *interfaces, *tmp;
-        getifaddrs(&interfaces);
-
-        char address[16];
-        address[0] = 0;
-        // Join the multicast groups
-        for (int i = 0; i < InputUniverseCount; i++) {
-            if (InputUniverses[i].type == E131_TYPE_MULTICAST) {
-                UniverseOctet[0] = InputUniverses[i].universe / 256;
-                UniverseOctet[1] = InputUniverses[i].universe % 256;
-                snprintf(strMulticastGroup, sizeof(strMulticastGroup), "239.255.%d.%d", UniverseOctet[0], UniverseOctet[1]);
-                mreq.imr_multiaddr.s_addr = inet_addr(strMulticastGroup);
-
-                LogInfo(VB_E131BRIDGE, "Adding group %s\n", strMulticastGroup);
-
-                // add group to groups to listen for on eth0 and wlan0 if it exists
-                int multicastJoined = 0;
-                tmp = interfaces;
-                //loop through all the interfaces and subscribe to the group
-                while (tmp) {
-                    //struct sockaddr_in *sin = (struct sockaddr_in *)tmp->ifa_addr;
-                    //strcpy(address, inet_ntoa(sin->sin_addr));
-                    if (tmp->ifa_addr && tmp->ifa_addr->sa_family == AF_INET) {
-                        GetInterfaceAddress(tmp->ifa_name, address, NULL, NULL);
-                        if (strcmp(address, "127.0.0.1")) {
-                            LogDebug(VB_E131BRIDGE, "   Adding interface %s - %s\n", tmp->ifa_name, address);
-                            mreq.imr_interface.s_addr = inet_addr(address);
-                            if (setsockopt(bridgeSock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
-                                LogWarn(VB_E131BRIDGE, "   Could not setup Multicast Group for interface %s\n", tmp->ifa_name);
-                            }
-                            multicastJoined = 1;
-                        }
-                    } else if (tmp->ifa_addr && tmp->ifa_addr->sa_family == AF_INET6) {
-                        //FIXME for ipv6 multicast
-                        //LogDebug(VB_E131BRIDGE, "   Inet6 interface %s\n", tmp->ifa_name);
-                    }
-                    tmp = tmp->ifa_next;
-                }
-
-                if (!multicastJoined) {
-                    LogDebug(VB_E131BRIDGE, "  Binding to default interface\n");
-                    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
-                    if (setsockopt(bridgeSock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
-                        LogWarn(VB_E131BRIDGE, "   Could not setup Multicast Group\n");
-                    }
-                }
-            }
+        if (e131Threads > 1) {
+            AttachE131ReuseportFilter(bridgeSock, e131Threads);
         }
-        freeifaddrs(interfaces);
     }
 
     if (hasArtNet || getSettingInt("ARTNETTimeCodeSync", 0)) {
@@ -445,38 +549,52 @@ bool Bridge_Initialize_Internal() {
     return enabled;
 }
 
-bool Bridge_StoreData(uint8_t* bridgeBuffer, long long packetTime) {
-    if ((bridgeBuffer[E131_VECTOR_INDEX] == VECTOR_ROOT_E131_DATA) &&
-        (bridgeBuffer[E131_START_CODE] == 0x00)) {
-        uint32_t universe = ((int)bridgeBuffer[E131_UNIVERSE_INDEX] << 8) + bridgeBuffer[E131_UNIVERSE_INDEX + 1];
-        uint32_t universeIndex = Bridge_GetIndexFromUniverseNumber(universe);
-        if (universeIndex != BRIDGE_INVALID_UNIVERSE_INDEX) {
-            uint32_t sn = bridgeBuffer[E131_SEQUENCE_INDEX];
-            if (InputUniverses[universeIndex].packetsReceived != 0) {
-                if (InputUniverses[universeIndex].lastSequenceNumber == 255) {
-                    // some wrap from 255 -> 1 and some from 255 -> 0, spec doesn't say which
-                    if (sn != 0 && sn != 1) {
-                        ++InputUniverses[universeIndex].errorPackets;
-                    }
-                } else if ((InputUniverses[universeIndex].lastSequenceNumber + 1) != sn) {
+/*
+ * Check the header of an E1.31 data packet and update the stats for the
+ * universe.  Returns the index of the universe if the data should be stored.
+ */
+static uint32_t Bridge_CheckE131DataHeader(uint8_t* bridgeBuffer) {
+    uint32_t universe = ((int)bridgeBuffer[E131_UNIVERSE_INDEX] << 8) + bridgeBuffer[E131_UNIVERSE_INDEX + 1];
+    uint32_t universeIndex = Bridge_GetIndexFromUniverseNumber(universe);
+    if (universeIndex != BRIDGE_INVALID_UNIVERSE_INDEX) {
+        uint32_t sn = bridgeBuffer[E131_SEQUENCE_INDEX];
+        if (InputUniverses[universeIndex].packetsReceived != 0) {
+            if (InputUniverses[universeIndex].lastSequenceNumber == 255) {
+                // some wrap from 255 -> 1 and some from 255 -> 0, spec doesn't say which
+                if (sn != 0 && sn != 1) {
                     ++InputUniverses[universeIndex].errorPackets;
                 }
+            } else if ((InputUniverses[universeIndex].lastSequenceNumber + 1) != sn) {
+                ++InputUniverses[universeIndex].errorPackets;
             }
-            InputUniverses[universeIndex].lastSequenceNumber = sn;
+        }
+        InputUniverses[universeIndex].lastSequenceNumber = sn;
+        InputUniverses[universeIndex].bytesReceived += InputUniverses[universeIndex].size;
+        InputUniverses[universeIndex].packetsReceived++;
+    } else {
+        unknownUniversePackets++;
+        uint32_t len = bridgeBuffer[16] & 0xF;
+        len <<= 8;
+        len += bridgeBuffer[17];
+        unknownUniverseBytes += len;
+        LogDebug(VB_E131BRIDGE, "Received e1.31 data packet for unconfigured universe %d\n", universe);
+    }
+    return universeIndex;
+}
 
+static inline bool Bridge_IsE131DataPacket(uint8_t* bridgeBuffer) {
+    return (bridgeBuffer[E131_VECTOR_INDEX] == VECTOR_ROOT_E131_DATA) &&
+           (bridgeBuffer[E131_START_CODE] == 0x00);
+}
+
+bool Bridge_StoreData(uint8_t* bridgeBuffer, long long packetTime) {
+    if (Bridge_IsE131DataPacket(bridgeBuffer)) {
+        uint32_t universeIndex = Bridge_CheckE131DataHeader(bridgeBuffer);
+        if (universeIndex != BRIDGE_INVALID_UNIVERSE_INDEX) {
             SetBridgeData(&bridgeBuffer[E131_HEADER_LENGTH],
                           InputUniverses[universeIndex].startAddress - 1,
                           InputUniverses[universeIndex].size,
                           packetTime);
-            InputUniverses[universeIndex].bytesReceived += InputUniverses[universeIndex].size;
-            InputUniverses[universeIndex].packetsReceived++;
-        } else {
-            unknownUniverse.packetsReceived++;
-            uint32_t len = bridgeBuffer[16] & 0xF;
-            len <<= 8;
-            len += bridgeBuffer[17];
-            unknownUniverse.bytesReceived += len;
-            LogDebug(VB_E131BRIDGE, "Received e1.31 data packet for unconfigured universe %d\n", universe);
         }
     } else if (bridgeBuffer[E131_VECTOR_INDEX] == VECTOR_ROOT_E131_EXTENDED) {
         if (bridgeBuffer[E131_EXTENDED_PACKET_TYPE_INDEX] == VECTOR_E131_EXTENDED_SYNCHRONIZATION) {
@@ -494,6 +612,7 @@ bool Bridge_StoreData(uint8_t* bridgeBuffer, long long packetTime) {
 
 bool Bridge_HandleArtNetSync(uint8_t* bridgeBuffer, long long packetTime) {
     //sync packet
+    artnetSyncPackets++;
     return true;
 }
 bool Bridge_StoreArtNetData(uint8_t* bridgeBuffer, long long packetTime) {
@@ -532,11 +651,11 @@ bool Bridge_StoreArtNetData(uint8_t* bridgeBuffer, long long packetTime) {
                           packetTime);
 
         } else {
-            unknownUniverse.packetsReceived++;
+            unknownUniversePackets++;
             uint32_t len = bridgeBuffer[16] & 0xF;
             len <<= 8;
             len += bridgeBuffer[17];
-            unknownUniverse.bytesReceived += len;
+            unknownUniverseBytes += len;
             LogDebug(VB_E131BRIDGE, "Received ArtNet data packet for unconfigured universe %d\n", univ);
         }
     }
@@ -624,53 +743,67 @@ bool Bridge_HandleArtNetPoll(uint8_t* bridgeBuffer, long long packetTime) {
     }
     return false;
 }
-bool Bridge_StoreDDPData(uint8_t* bridgeBuffer, long long packetTime) {
-    bool push = false;
-    if (bridgeBuffer[3] == 1) {
-        ddpPacketsReceived++;
-        bool tc = bridgeBuffer[0] & DDP_TIMECODE_FLAG;
-        push = bridgeBuffer[0] & DDP_PUSH_FLAG;
-
-        uint32_t chan = bridgeBuffer[4];
-        chan <<= 8;
-        chan += bridgeBuffer[5];
-        chan <<= 8;
-        chan += bridgeBuffer[6];
-        chan <<= 8;
-        chan += bridgeBuffer[7];
-
-        uint32_t len = bridgeBuffer[8] << 8;
-        len += bridgeBuffer[9];
-
-        uint32_t sn = bridgeBuffer[1] & 0xF;
-        if (sn) {
-            bool isErr = false;
-            if (ddpLastSequence) {
-                if (sn == 1) {
-                    if (ddpLastSequence != 15) {
-                        isErr = true;
-                    }
-                } else if ((sn - 1) != ddpLastSequence) {
+/*
+ * Parse the header of a DDP pixel data packet and update the DDP stats.
+ * Returns the length of the header.
+ */
+static int Bridge_CheckDDPDataHeader(uint8_t* bridgeBuffer, uint32_t& chan, uint32_t& len) {
+    ddpPacketsReceived++;
+    bool tc = bridgeBuffer[0] & DDP_TIMECODE_FLAG;
+
+    chan = bridgeBuffer[4];
+    chan <<= 8;
+    chan += bridgeBuffer[5];
+    chan <<= 8;
+    chan += bridgeBuffer[6];
+    chan <<= 8;
+    chan += bridgeBuffer[7];
+
+    len = bridgeBuffer[8] << 8;
+    len += bridgeBuffer[9];
+
+    uint32_t sn = bridgeBuffer[1] & 0xF;
+    if (sn) {
+        bool isErr = false;
+        if (ddpLastSequence) {
+            if (sn == 1) {
+                if (ddpLastSequence != 15) {
                     isErr = true;
                 }
+            } else if ((sn - 1) != ddpLastSequence) {
+                isErr = true;
             }
-            if (isErr) {
-                ddpErrors++;
-                //printf("%d   %d    %d  %d\n", sn, ddpLastSequence, chan, ddpLastChannel);
-            }
-            ddpLastSequence = sn;
-            ddpLastChannel = chan + len;
         }
+        if (isErr) {
+            ddpErrors++;
+            //printf("%d   %d    %d  %d\n", sn, ddpLastSequence, chan, ddpLastChannel);
+        }
+        ddpLastSequence = sn;
+        ddpLastChannel = chan + len;
+    }
+
+    uint32_t v = ddpMinChannel.load(std::memory_order_relaxed);
+    while ((chan + 1) < v && !ddpMinChannel.compare_exchange_weak(v, chan + 1, std::memory_order_relaxed)) {
+    }
+    v = ddpMaxChannel.load(std::memory_order_relaxed);
+    while ((chan + len) > v && !ddpMaxChannel.compare_exchange_weak(v, chan + len, std::memory_order_relaxed)) {
+    }
+    ddpBytesReceived += len;
+
+    return tc ? 14 : 10;
+}
 
-        ddpMinChannel = std::min(ddpMinChannel, chan + 1);
-        ddpMaxChannel = std::max(ddpMaxChannel, chan + len);
+bool Bridge_StoreDDPData(uint8_t* bridgeBuffer, long long packetTime) {
+    bool push = false;
+    if (bridgeBuffer[3] == 1) {
+        push = bridgeBuffer[0] & DDP_PUSH_FLAG;
 
-        int offset = tc ? 14 : 10;
+        uint32_t chan, len;
+        int offset = Bridge_CheckDDPDataHeader(bridgeBuffer, chan, len);
         SetBridgeData(&bridgeBuffer[offset],
                       chan,
                       len,
                       packetTime);
-        ddpBytesReceived += len;
     } else if (bridgeBuffer[0] & 0x02 && bridgeBuffer[3] == 250) {
         printf("Query config packet: %d \n", (int)bridgeBuffer[3]);
     } else if (bridgeBuffer[0] & 0x02 && bridgeBuffer[3] == 251) {
@@ -682,22 +815,24 @@ bool Bridge_StoreDDPData(uint8_t* bridgeBuffer, long long packetTime) {
 }
 
 inline int Bridge_GetIndexFromUniverseNumber(int universe) {
-    int val = BRIDGE_INVALID_UNIVERSE_INDEX;
+    if ((universe < 0) || (universe >= 65536))
+        return BRIDGE_INVALID_UNIVERSE_INDEX;
 
-    if (UniverseCache[universe] != BRIDGE_INVALID_UNIVERSE_INDEX)
-        return UniverseCache[universe];
-
-    for (int index = 0; index < InputUniverseCount; index++) {
-        if (universe == InputUniverses[index].universe) {
-            val = index;
-            UniverseCache[universe] = index;
-            break;
-        }
-    }
-    return val;
+    return UniverseCache[universe];
 }
 
 void Bridge_Shutdown(void) {
+    runBridgeReceiveThreads = false;
+    for (auto t : bridgeReceiveThreads) {
+        t->join();
+        delete t;
+    }
+    bridgeReceiveThreads.clear();
+    for (auto& a : bridgeReceiveThreadSockets) {
+        close(a.first);
+    }
+    bridgeReceiveThreadSockets.clear();
+
     if (bridgeSock >= 0)
         close(bridgeSock);
     if (ddpSock >= 0)
@@ -722,6 +857,7 @@ void ResetBytesReceived() {
     ddpPacketsReceived = 0;
     ddpErrors = 0;
     e131Errors = 0;
+    artnetSyncPackets = 0;
 }
 
 Json::Value GetE131UniverseBytesReceived() {
@@ -734,9 +870,11 @@ Json::Value GetE131UniverseBytesReceived() {
         Json::Value ddpUniverse;
         ddpUniverse["id"] = "DDP";
 
-        if (ddpMaxChannel > ddpMinChannel) {
+        uint32_t minChannel = ddpMinChannel;
+        uint32_t maxChannel = ddpMaxChannel;
+        if (maxChannel > minChannel) {
             std::stringstream ss;
-            ss << ddpMinChannel << "-" << ddpMaxChannel;
+            ss << minChannel << "-" << maxChannel;
             std::string chanRange = ss.str();
             ddpUniverse["startChannel"] = chanRange;
         } else {
@@ -787,7 +925,8 @@ Json::Value GetE131UniverseBytesReceived() {
 
         universes.append(universe);
     }
-    if (unknownUniverse.packetsReceived) {
+    uint32_t unknownPackets = unknownUniversePackets;
+    if (unknownPackets) {
         Json::Value universe;
 
         universe["id"] = "Ignored";
@@ -798,12 +937,12 @@ Json::Value GetE131UniverseBytesReceived() {
         std::string errors = er.str();
 
         std::stringstream ss;
-        ss << unknownUniverse.bytesReceived;
+        ss << unknownUniverseBytes;
         std::string bytesReceived = ss.str();
         universe["bytesReceived"] = bytesReceived;
 
         std::stringstream pr;
-        pr << unknownUniverse.packetsReceived;
+        pr << unknownPackets;
         std::string packetsReceived = pr.str();
         universe["packetsReceived"] = packetsReceived;
 
@@ -827,6 +966,17 @@ Json::Value GetE131UniverseBytesReceived() {
 
         universes.append(universe);
     }
+    if (artnetSyncPackets) {
+        Json::Value universe;
+
+        universe["id"] = "ArtNet Sync";
+        universe["startChannel"] = "-";
+        universe["bytesReceived"] = "-";
+        universe["packetsReceived"] = std::to_string(artnetSyncPackets);
+        universe["errors"] = "-";
+
+        universes.append(universe);
+    }
 
     result["universes"] = universes;
 
@@ -857,34 +1007,66 @@ void InputUniversesPrint() {
 
 bool AddWarningForProtocol(int sock, const std::string& protocol) {
     std::map<in_addr_t, std::string> errrors;
-    int msgcnt = recvmmsg(sock, msgs, MAX_MSG, 0, nullptr);
+    BridgeReceiveBuffers& rb = mainLoopBuffers;
+    int msgcnt = recvmmsg(sock, rb.msgs, MAX_MSG, 0, nullptr);
     while (msgcnt > 0) {
         for (int x = 0; x < msgcnt; x++) {
-            struct in_addr i = inAddress[x].sin_addr;
+            struct in_addr i = rb.inAddress[x].sin_addr;
             in_addr_t at = i.s_addr;
-            if (protocol == "DDP" && buffers[x][3] != 1) {
+            if (protocol == "DDP" && rb.buffers[x][3] != 1) {
                 //non pixel DDP data, possibly a broadcast discovery packet or sync packet or similar
                 continue;
             }
             if (errrors[at] == "") {
-                std::string ne = "Received " + protocol + " data from " + inet_ntoa(inAddress[x].sin_addr);
+                std::string ne = "Received " + protocol + " data from " + inet_ntoa(rb.inAddress[x].sin_addr);
                 LogDebug(VB_E131BRIDGE, "%s\n", ne.c_str());
                 WarningHolder::AddWarningTimeout(ne, 30);
                 errrors[at] = ne;
             }
         }
-        msgcnt = recvmmsg(sock, msgs, MAX_MSG, 0, nullptr);
+        msgcnt = recvmmsg(sock, rb.msgs, MAX_MSG, 0, nullptr);
     }
     return false;
 }
 
+static void BridgeReceiveThreadMain(int sock, bool ddp) {
+    std::unique_ptr<BridgeReceiveBuffers> rb = std::make_unique<BridgeReceiveBuffers>();
+    struct pollfd pfd;
+    pfd.fd = sock;
+    pfd.events = POLLIN;
+    while (runBridgeReceiveThreads) {
+        pfd.revents = 0;
+        // timeout so we notice a shutdown
+        if (poll(&pfd, 1, 250) > 0) {
+            bool sync = ddp ? Bridge_ReceiveDDPData(sock, *rb) : Bridge_ReceiveE131Data(sock, *rb);
+            if (sync) {
+                BridgeSyncReceived();
+            }
+        }
+    }
+}
+
+static void StartBridgeReceiveThread(int sock, bool ddp) {
+    bridgeReceiveThreads.push_back(new std::thread(BridgeReceiveThreadMain, sock, ddp));
+}
+
 void Bridge_Initialize(std::map<int, std::function<bool(int)>>& callbacks) {
-    bool enabled = Bridge_Initialize_Internal();
+    int receiveThreads = GetBridgeReceiveThreadCount();
+    bool enabled = Bridge_Initialize_Internal(receiveThreads);
     bool disableFakeBridges = getSettingInt("DisableFakeNetworkBridges");
+    if (enabled && receiveThreads > 0) {
+        LogInfo(VB_E131BRIDGE, "Using %d bridge receive threads per protocol\n", receiveThreads);
+        runBridgeReceiveThreads = true;
+        for (auto& a : bridgeReceiveThreadSockets) {
+            StartBridgeReceiveThread(a.first, a.second);
+        }
+    }
     if (bridgeSock > 0) {
-        if (enabled) {
+        if (enabled && runBridgeReceiveThreads) {
+            StartBridgeReceiveThread(bridgeSock, false);
+        } else if (enabled) {
             std::function<bool(int)> f = [](int i) {
-                return Bridge_ReceiveE131Data();
+                return Bridge_ReceiveE131Data(i, mainLoopBuffers);
             };
             callbacks[bridgeSock] = f;
         } else if (!disableFakeBridges) {
@@ -895,9 +1077,11 @@ void Bridge_Initialize(std::map<int, std::function<bool(int)>>& callbacks) {
         }
     }
     if (ddpSock > 0) {
-        if (enabled) {
+        if (enabled && runBridgeReceiveThreads) {
+            StartBridgeReceiveThread(ddpSock, true);
+        } else if (enabled) {
             std::function<bool(int)> f = [](int i) {
-                return Bridge_ReceiveDDPData();
+                return Bridge_ReceiveDDPData(i, mainLoopBuffers);
             };
             callbacks[ddpSock] = f;
         } else if (!disableFakeBridges) {
@@ -12,17 +12,22 @@
 
 #include "fpp-pch.h"
 
+#include <sys/stat.h>
 #include <array>
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <cstring>
 #include <fnmatch.h>
 #include <functional>
 #include <list>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -39,21 +44,93 @@
 
 #define MAX_EFFECTS 100
 
+// eseq effects up to this size are decoded once and kept in memory
+#define EFFECT_RESIDENT_MAX_BYTES (8 * 1024 * 1024)
+// number of stopped resident effects kept around for the next trigger
+#define EFFECT_RESIDENT_KEEP 4
+// frames read ahead for effects that are streamed from disk
+#define EFFECT_READ_AHEAD_FRAMES 8
+
+/*
+ * Every frame of an eseq, decoded and packed in the order of its
+ * sparse ranges.  Shared by all running copies of the effect.
+ */
+class ResidentEffect {
+public:
+    std::string key;
+    uint32_t frameSize = 0;
+    uint32_t numFrames = 0;
+    std::vector<uint8_t> data;
+};
+
+/*
+ * Read-ahead queue for an effect too large to keep in memory.  The
+ * file is only touched by the effect read thread, the output thread
+ * takes ready frames off the front.
+ */
+class EffectReader {
+public:
+    EffectReader(FSEQFile* f, bool l) :
+        fp(f),
+        loop(l) {}
+    ~EffectReader() {
+        for (auto d : frames) {
+            delete d;
+        }
+        delete fp;
+    }
+
+    FSEQFile* fp;
+    bool loop;
+    uint32_t nextFrame = 0;
+
+    std::mutex lock;
+    std::list<FSEQFile::FrameData*> frames;
+    bool readDone = false;
+    std::atomic<bool> stopped = false;
+};
+
+static std::mutex residentLock;
+static std::map<std::string, std::weak_ptr<ResidentEffect>> residentEffects;
+static std::list<std::shared_ptr<ResidentEffect>> recentResidentEffects;
+
+static std::mutex readersLock;
+static std::condition_variable readersCV;
+static std::list<std::shared_ptr<EffectReader>> readers;
+static std::thread* readThread = nullptr;
+static bool readThreadStop = false;
+
+static void WakeEffectReadThread() {
+    std::unique_lock<std::mutex> lock(readersLock);
+    readersCV.notify_all();
+}
+
 class FPPeffect {
 public:
     FPPeffect() :
-        fp(nullptr),
         currentFrame(0) {}
     ~FPPeffect() {
-        if (fp)
-            delete fp;
+        if (reader) {
+            reader->stopped = true;
+            WakeEffectReadThread();
+        }
+        if (lastFrame) {
+            delete lastFrame;
+        }
     }
 
     std::string name;
-    FSEQFile* fp;
     int loop;
     int background;
     uint32_t currentFrame;
+
+    // where the channels go and what to clear when stopped
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+
+    // exactly one of these is set
+    std::shared_ptr<ResidentEffect> resident;
+    std::shared_ptr<EffectReader> reader;
+    FSEQFile::FrameData* lastFrame = nullptr;
 };
 
 static int effectCount = 0;
@@ -62,6 +139,131 @@ static std::array<FPPeffect*, MAX_EFFECTS> effects;
 static std::list<std::pair<uint32_t, uint32_t>> clearRanges;
 static std::mutex effectsLock;
 
+/*
+ * Returns the decoded frames of a sparse eseq, loading them if no other
+ * running or recently run copy of the effect has.  Returns nullptr if
+ * the effect is too large to keep in memory.
+ */
+static std::shared_ptr<ResidentEffect> GetResidentEffect(V2FSEQFile* fseq) {
+    uint32_t frameSize = 0;
+    for (auto& rng : fseq->m_sparseRanges) {
+        frameSize += rng.second;
+    }
+    if (frameSize != fseq->getChannelCount() ||
+        ((uint64_t)frameSize * fseq->getNumFrames()) > EFFECT_RESIDENT_MAX_BYTES) {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (stat(fseq->getFilename().c_str(), &st)) {
+        return nullptr;
+    }
+    std::string key = fseq->getFilename() + ":" + std::to_string(st.st_mtime) + ":" + std::to_string(st.st_size);
+
+    std::unique_lock<std::mutex> lock(residentLock);
+    std::shared_ptr<ResidentEffect> res = residentEffects[key].lock();
+    if (!res) {
+        res = std::make_shared<ResidentEffect>();
+        res->key = key;
+        res->frameSize = frameSize;
+        res->data.resize((size_t)frameSize * fseq->getNumFrames());
+
+        // read with the ranges packed from 0 so each frame comes out in file order
+        std::vector<std::pair<uint32_t, uint32_t>> sparse = fseq->m_sparseRanges;
+        std::vector<std::pair<uint32_t, uint32_t>> packed;
+        uint32_t offset = 0;
+        for (auto& rng : sparse) {
+            packed.push_back(std::pair<uint32_t, uint32_t>(offset, rng.second));
+            offset += rng.second;
+        }
+        fseq->m_sparseRanges = packed;
+        fseq->prepareRead(packed, 0);
+        for (uint32_t x = 0; x < fseq->getNumFrames(); x++) {
+            FSEQFile::FrameData* d = fseq->getFrame(x);
+            if (!d) {
+                break;
+            }
+            d->readFrame(&res->data[(size_t)x * frameSize], frameSize);
+            delete d;
+            res->numFrames = x + 1;
+        }
+        fseq->m_sparseRanges = sparse;
+        LogDebug(VB_EFFECT, "Loaded %d frames of %s into memory\n", res->numFrames, fseq->getFilename().c_str());
+
+        for (auto it = residentEffects.begin(); it != residentEffects.end();) {
+            if (it->second.expired()) {
+                it = residentEffects.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        residentEffects[key] = res;
+    }
+
+    // keep the most recent ones loaded so re-triggering doesn't read them again
+    recentResidentEffects.remove(res);
+    recentResidentEffects.push_front(res);
+    if (recentResidentEffects.size() > EFFECT_RESIDENT_KEEP) {
+        recentResidentEffects.pop_back();
+    }
+    return res;
+}
+
+static void ReadEffectFrame(std::shared_ptr<EffectReader>& r) {
+    FSEQFile::FrameData* d = nullptr;
+    if (r->nextFrame < r->fp->getNumFrames()) {
+        d = r->fp->getFrame(r->nextFrame);
+    }
+    if (!d && r->loop && r->nextFrame) {
+        r->nextFrame = 0;
+        d = r->fp->getFrame(r->nextFrame);
+    }
+    std::unique_lock<std::mutex> lock(r->lock);
+    if (d) {
+        r->frames.push_back(d);
+        r->nextFrame++;
+    } else {
+        r->readDone = true;
+    }
+}
+
+static void EffectReadThread() {
+    std::unique_lock<std::mutex> lock(readersLock);
+    while (!readThreadStop) {
+        std::vector<std::shared_ptr<EffectReader>> work;
+        readers.remove_if([](const std::shared_ptr<EffectReader>& r) { return r->stopped.load(); });
+        for (auto& r : readers) {
+            std::unique_lock<std::mutex> rl(r->lock);
+            if (!r->readDone && r->frames.size() < EFFECT_READ_AHEAD_FRAMES) {
+                work.push_back(r);
+            }
+        }
+        if (work.empty()) {
+            readersCV.wait(lock);
+            continue;
+        }
+        // one frame from each per pass so a slow file doesn't starve the others
+        lock.unlock();
+        for (auto& r : work) {
+            if (!r->stopped) {
+                ReadEffectFrame(r);
+            }
+        }
+        work.clear();
+        lock.lock();
+    }
+}
+
+static void AddEffectReader(std::shared_ptr<EffectReader> r) {
+    std::unique_lock<std::mutex> lock(readersLock);
+    readers.push_back(r);
+    if (!readThread) {
+        readThreadStop = false;
+        readThread = new std::thread(EffectReadThread);
+    }
+    readersCV.notify_all();
+}
+
 /*
  * Initialize effects constructs
  */
@@ -113,6 +315,23 @@ int InitEffects(void) {
  * Close effects constructs
  */
 void CloseEffects(void) {
+    std::unique_lock<std::mutex> lock(readersLock);
+    std::thread* t = readThread;
+    readThread = nullptr;
+    readThreadStop = true;
+    readersCV.notify_all();
+    lock.unlock();
+    if (t) {
+        t->join();
+        delete t;
+    }
+    lock.lock();
+    readers.clear();
+    lock.unlock();
+
+    std::unique_lock<std::mutex> rlock(residentLock);
+    recentResidentEffects.clear();
+    residentEffects.clear();
 }
 
 /*
@@ -145,28 +364,45 @@ int IsEffectRunning(void) {
 }
 
 int StartEffect(FSEQFile* fseq, const std::string& effectName, int loop, bool bg) {
+    int frameTime = fseq->getStepTime();
+
+    // load or stream the frames before taking the lock the output thread uses
+    FPPeffect* e = new FPPeffect;
+    e->name = effectName;
+    e->loop = loop;
+    e->background = bg;
+    V2FSEQFile* v2fseq = dynamic_cast<V2FSEQFile*>(fseq);
+    if (v2fseq && v2fseq->m_sparseRanges.size() != 0) {
+        e->ranges = v2fseq->m_sparseRanges;
+        e->resident = GetResidentEffect(v2fseq);
+    } else {
+        //not sparse and not eseq, entire range
+        e->ranges.push_back(std::pair<uint32_t, uint32_t>(0, fseq->getChannelCount()));
+    }
+    if (e->resident) {
+        delete fseq;
+    } else {
+        e->reader = std::make_shared<EffectReader>(fseq, loop);
+    }
+
     std::unique_lock<std::mutex> lock(effectsLock);
     if (effectCount >= MAX_EFFECTS) {
         LogErr(VB_EFFECT, "Unable to start effect %s, maximum number of effects already running\n", effectName.c_str());
+        delete e;
         return -1;
     }
-    int effectID = -1;
-    int frameTime = 50;
-
-    frameTime = fseq->getStepTime();
-    effectID = GetNextEffectID();
+    int effectID = GetNextEffectID();
 
     if (effectID < 0) {
         LogErr(VB_EFFECT, "Unable to start effect %s, unable to determine next effect ID\n", effectName.c_str());
-        delete fseq;
+        delete e;
         return effectID;
     }
 
-    effects[effectID] = new FPPeffect;
-    effects[effectID]->name = effectName;
-    effects[effectID]->fp = fseq;
-    effects[effectID]->loop = loop;
-    effects[effectID]->background = bg;
+    effects[effectID] = e;
+    if (e->reader) {
+        AddEffectReader(e->reader);
+    }
 
     effectCount++;
     int tmpec = effectCount;
@@ -236,19 +472,8 @@ void StopEffectHelper(int effectID) {
     FPPeffect* e = NULL;
     e = effects[effectID];
 
-    if (e->fp) {
-        V2FSEQFile* v2fseq = dynamic_cast<V2FSEQFile*>(e->fp);
-        if (v2fseq && v2fseq->m_sparseRanges.size() != 0) {
-            for (auto& a : v2fseq->m_sparseRanges) {
-                clearRanges.push_back(std::pair<uint32_t, uint32_t>(a.first, a.second));
-            }
-            for (auto& a : v2fseq->m_rangesToRead) {
-                clearRanges.push_back(std::pair<uint32_t, uint32_t>(a.first, a.second));
-            }
-        } else {
-            //not sparse and not eseq, entire range
-            clearRanges.push_back(std::pair<uint32_t, uint32_t>(0, e->fp->getChannelCount()));
-        }
+    for (auto& a : e->ranges) {
+        clearRanges.push_back(a);
     }
     delete e;
     effects[effectID] = NULL;
@@ -340,17 +565,49 @@ int OverlayEffect(int effectID, char* channelData) {
     }
 
     e = effects[effectID];
-    FSEQFile::FrameData* d = e->fp->getFrame(e->currentFrame);
-    if (d == nullptr && e->loop) {
-        e->currentFrame = 0;
-        d = e->fp->getFrame(e->currentFrame);
-    }
-    e->currentFrame++;
-    if (d) {
-        d->readFrame((uint8_t*)channelData, FPPD_MAX_CHANNELS);
-        delete d;
-        return 1;
+    bool done = false;
+    if (e->resident) {
+        ResidentEffect* res = e->resident.get();
+        if (e->currentFrame >= res->numFrames && e->loop) {
+            e->currentFrame = 0;
+        }
+        if (e->currentFrame < res->numFrames) {
+            const uint8_t* src = &res->data[(size_t)e->currentFrame * res->frameSize];
+            for (auto& rng : e->ranges) {
+                if (rng.first < FPPD_MAX_CHANNELS) {
+                    memcpy(&channelData[rng.first], src, std::min(rng.second, FPPD_MAX_CHANNELS - rng.first));
+                }
+                src += rng.second;
+            }
+            e->currentFrame++;
+            return 1;
+        }
+        done = true;
     } else {
+        EffectReader* r = e->reader.get();
+        std::unique_lock<std::mutex> lock(r->lock);
+        if (!r->frames.empty()) {
+            FSEQFile::FrameData* d = r->frames.front();
+            r->frames.pop_front();
+            lock.unlock();
+            WakeEffectReadThread();
+            if (e->lastFrame) {
+                delete e->lastFrame;
+            }
+            e->lastFrame = d;
+            e->currentFrame++;
+        } else if (r->readDone) {
+            done = true;
+        } else {
+            // not read yet, repeat the last frame rather than stall the output
+            LogExcess(VB_EFFECT, "Effect %s frame %d not ready\n", e->name.c_str(), e->currentFrame);
+        }
+        if (!done && e->lastFrame) {
+            e->lastFrame->readFrame((uint8_t*)channelData, FPPD_MAX_CHANNELS);
+            return 1;
+        }
+    }
+    if (done) {
         StopEffectHelper(effectID);
         for (auto& rng : clearRanges) {
             memset(&channelData[rng.first], 0, rng.second);
@@ -971,7 +971,7 @@ void MainLoop(void) {
             }
         }
         if (pushBridgeData) {
-            ForceChannelOutputNow();
+            BridgeSyncReceived();
         }
         bool doPing = false;
         if (!epollresult) {
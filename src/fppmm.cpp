@@ -28,6 +28,7 @@
 #include "commands/Commands.h"
 
 #include "fppversion.h"
+#include "overlays/PixelOverlayBuffer.h"
 
 char* blockName = NULL;
 char* inputFilename = NULL;
@@ -192,13 +193,23 @@ void CopyFileToMappedBlock(const std::string& blockName, char* inputFilename) {
         std::string overlayBuferName = "/FPP-Model-Overlay-Buffer-" + blockName;
         mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH;
         int f = shm_open(overlayBuferName.c_str(), O_RDWR | O_CREAT, mode);
-        int size = width * height * 3 + 12;
-        uint8_t* overlayBufferData = (uint8_t*)mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, f, 0);
+        struct stat st;
+        size_t size = width * height * 3 + 12;
+        if (fstat(f, &st) == 0 && (size_t)st.st_size > size) {
+            size = st.st_size;
+        }
+        OverlayBufferData* overlayBufferData = (OverlayBufferData*)mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, f, 0);
         close(f);
-        memcpy(&overlayBufferData[12], data, channelCount);
-        //data is copied, mark the overlay buffer as dirty so it gets copied into the data buffer
-        uint32_t* flags = (uint32_t*)&overlayBufferData[8];
-        *flags |= 1;
+        OverlayBufferSlots* slots = OverlayBufferGetSlots(overlayBufferData, size);
+        if (slots && slots->slotSize >= (uint32_t)channelCount) {
+            // hand fppd a complete frame so it never sees a partial copy
+            memcpy(OverlayBufferWriteSlot(slots), data, channelCount);
+            OverlayBufferPublish(slots);
+        } else {
+            memcpy(overlayBufferData->data, data, channelCount);
+            //data is copied, mark the overlay buffer as dirty so it gets copied into the data buffer
+            overlayBufferData->flags |= OVERLAY_BUFFER_DIRTY;
+        }
         munmap(overlayBufferData, size);
         printf("Data imported\n");
     }
@@ -252,6 +263,18 @@ void DumpMappedBlockInfo(const std::string& blockName) {
     case 3:
         printf("Active (Transparent RGB)\n");
         break;
+    case 4:
+        printf("Active (Alpha)\n");
+        break;
+    case 5:
+        printf("Active (Add)\n");
+        break;
+    case 6:
+        printf("Active (Max)\n");
+        break;
+    case 7:
+        printf("Active (Multiply)\n");
+        break;
     }
 
     printf("Effect running : ");
@@ -72,6 +72,7 @@ void GetCurrentFPPDStatus(Json::Value& result) {
     result["status"] = Player::INSTANCE.GetStatus();
     result["bridging"] = HasBridgeData();
     result["multisync"] = multiSync->isMultiSyncEnabled();
+    GetChannelOutputSyncStatus(result["outputSync"]);
 
     if (ChannelTester::INSTANCE.Testing()) {
         result["status_name"] = "testing";
@@ -9,6 +9,7 @@ OBJECTS_fpp_so += \
 	channeloutput/FPD.o \
 	channeloutput/Matrix.o \
 	channeloutput/PanelMatrix.o \
+	channeloutput/PacketTxRing.o \
 	channeloutput/PixelString.o \
 	channeloutput/serialutil.o \
 	channeloutput/VirtualDisplayBase.o \
@@ -50,9 +51,12 @@ OBJECTS_fpp_so += \
 	log.o \
 	FPPLocale.o \
 	MultiSync.o \
+	MultiSyncStream.o \
 	mediadetails.o \
+	mediaoutput/AudioAnalysis.o \
 	mediaoutput/MediaOutputBase.o \
 	mediaoutput/mediaoutput.o \
+	mediaoutput/PCMCache.o \
 	mediaoutput/SDLOut.o \
 	mediaoutput/VLCOut.o \
 	mqtt.o \
@@ -62,10 +66,13 @@ OBJECTS_fpp_so += \
 	Player.o \
 	OutputMonitor.o \
 	overlays/PixelOverlay.o \
+	overlays/PixelOverlayBlend.o \
     overlays/PixelOverlayEffects.o \
 	overlays/PixelOverlayModel.o \
 	overlays/PixelOverlayModelFB.o \
 	overlays/PixelOverlayModelSub.o \
+	overlays/PixelOverlayScaler.o \
+	overlays/TextRenderer.o \
     overlays/WLEDEffects.o \
     overlays/wled/colors.o \
     overlays/wled/FX.o \
@@ -148,6 +155,11 @@ CXXFLAGS_overlays/PixelOverlay.o  += -I/usr/include/libdrm
 CXXFLAGS_overlays/PixelOverlayModelFB.o  += -I/usr/include/libdrm
 endif
 
+ifneq ($(wildcard /usr/include/freetype2/ft2build.h),)
+CXXFLAGS_overlays/TextRenderer.o += -I/usr/include/freetype2 -DHAS_FREETYPE
+LIBS_fpp_so += -lfreetype
+endif
+
 
 util/tinyexpr.o: util/tinyexpr.c fppversion_defines.h Makefile makefiles/*.mk makefiles/platform/*.mk $(PCH_FILE)
 	$(CCACHE) $(CCOMPILER) $(CFLAGS) $(CFLAGS_$@) -c $(SRCDIR)$< -o $@
@@ -0,0 +1,222 @@
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include "fpp-pch.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "../common.h"
+#include "../log.h"
+#include "../overlays/wled/kiss_fftr.h"
+
+#include "AudioAnalysis.h"
+#include "SDLOut.h"
+
+// Stop analyzing if no one has read a snapshot in this long (us)
+#define AUDIO_ANALYSIS_IDLE_TIME 5000000
+
+// Minimum time between detected beats (us), ~300 BPM
+#define AUDIO_ANALYSIS_MIN_BEAT_GAP 200000
+
+AudioAnalysis AudioAnalysis::INSTANCE;
+
+AudioAnalysis::AudioAnalysis() :
+    m_serial(0),
+    m_lastRead(0) {
+    m_cfg = kiss_fftr_alloc(AUDIO_ANALYSIS_SAMPLES, 0, nullptr, nullptr);
+    m_fftOut = calloc(AUDIO_ANALYSIS_BINS + 1, sizeof(kiss_fft_cpx));
+
+    // Hann window, scaled by 2 to make up for the window's 0.5 coherent gain
+    // so the magnitudes match what an unwindowed FFT of a tone gives
+    for (int x = 0; x < AUDIO_ANALYSIS_SAMPLES; x++) {
+        m_window[x] = 1.0f - cosf((2.0f * M_PI * x) / (AUDIO_ANALYSIS_SAMPLES - 1));
+    }
+    memset(m_samples, 0, sizeof(m_samples));
+    memset(m_prevBins, 0, sizeof(m_prevBins));
+    memset(m_fluxHistory, 0, sizeof(m_fluxHistory));
+    memset(m_working.bins, 0, sizeof(m_working.bins));
+    memset(m_working.bands, 0, sizeof(m_working.bands));
+    memset(m_working.bandLevels, 0, sizeof(m_working.bandLevels));
+    m_published = m_working;
+}
+
+AudioAnalysis::~AudioAnalysis() {
+    if (m_cfg) {
+        kiss_fftr_free(m_cfg);
+    }
+    if (m_fftOut) {
+        free(m_fftOut);
+    }
+}
+
+void AudioAnalysis::Process(void) {
+    uint64_t now = GetMonotonicTime();
+    if ((now - m_lastRead.load(std::memory_order_relaxed)) > AUDIO_ANALYSIS_IDLE_TIME) {
+        return;
+    }
+
+    int sampleRate = 0;
+    if (!SDLOutput::GetAudioSamples(m_samples, AUDIO_ANALYSIS_SAMPLES, sampleRate) || !sampleRate) {
+        if (m_working.valid) {
+            m_working.valid = false;
+            m_working.beat = false;
+            m_fluxCount = 0;
+            memset(m_prevBins, 0, sizeof(m_prevBins));
+            Publish();
+        }
+        return;
+    }
+
+    m_working.timestamp = now;
+    Analyze(sampleRate);
+    DetectBeat();
+    m_working.valid = true;
+    Publish();
+}
+
+void AudioAnalysis::Analyze(int sampleRate) {
+    m_working.sampleRate = sampleRate;
+
+    float sumSq = 0.0f;
+    float peak = 0.0f;
+    for (int x = 0; x < AUDIO_ANALYSIS_SAMPLES; x++) {
+        float s = m_samples[x];
+        sumSq += s * s;
+        peak = std::max(peak, std::fabs(s));
+        m_samples[x] = s * m_window[x];
+    }
+    m_working.rms = sqrtf(sumSq / AUDIO_ANALYSIS_SAMPLES);
+    m_working.peak = peak;
+
+    kiss_fft_cpx* out = (kiss_fft_cpx*)m_fftOut;
+    kiss_fftr(m_cfg, m_samples, out);
+
+    float* bins = m_working.bins;
+    for (int bin = 0; bin < AUDIO_ANALYSIS_BINS; bin++) {
+        bins[bin] = sqrtf(out[bin].r * out[bin].r + out[bin].i * out[bin].i);
+    }
+
+    // Bands are the same log spaced buckets the WLED audio reactive
+    // effects expect, band b ends at MIDI note (b + 2) * 8
+    float rate = sampleRate;
+    float binHzRange = rate / (float)AUDIO_ANALYSIS_SAMPLES;
+    int band = 0;
+    int end = 440.0f * exp2f(((band + 2) * 8 - 69.0f) / 12.0f) / binHzRange;
+    float maxValue = 0.0f;
+    int maxBin = 0;
+    int maxBand = 0;
+    memset(m_working.bands, 0, sizeof(m_working.bands));
+    for (int bin = 0; bin < AUDIO_ANALYSIS_BINS; bin++) {
+        if (bin > end) {
+            band++;
+            if (band == AUDIO_ANALYSIS_BANDS) {
+                break;
+            }
+            end = 440.0f * exp2f(((band + 2) * 8 - 69.0f) / 12.0f) / binHzRange;
+        }
+        float nv = bins[bin];
+        if (nv > maxValue) {
+            maxValue = nv;
+            maxBin = bin;
+            maxBand = band;
+        }
+        m_working.bands[band] = std::max(m_working.bands[band], nv);
+    }
+
+    uint8_t maxLevel = 0;
+    for (int x = 0; x < AUDIO_ANALYSIS_BANDS; x++) {
+        int v = 0;
+        if (m_working.bands[x] > 0.0f) {
+            v = std::clamp((int)roundf(log10f(m_working.bands[x]) * 120.0f), 0, 255);
+        }
+        m_working.bandLevels[x] = v;
+        maxLevel = std::max(maxLevel, (uint8_t)v);
+    }
+    m_working.maxBandLevel = maxLevel;
+    m_working.majorPeakBin = maxBin;
+    m_working.majorPeakBand = maxBand;
+    m_working.majorPeakMagnitude = maxValue;
+    m_working.majorPeakFreq = (maxBin * binHzRange) + (binHzRange / 2);
+}
+
+void AudioAnalysis::DetectBeat(void) {
+    // Positive spectral flux, onsets show up as energy appearing in bins
+    // which were quiet on the previous frame
+    float flux = 0.0f;
+    float* bins = m_working.bins;
+    for (int bin = 0; bin < AUDIO_ANALYSIS_BINS; bin++) {
+        float d = bins[bin] - m_prevBins[bin];
+        flux += d > 0.0f ? d : 0.0f;
+    }
+    memcpy(m_prevBins, bins, sizeof(m_prevBins));
+
+    float mean = 0.0f;
+    float var = 0.0f;
+    if (m_fluxCount) {
+        for (int x = 0; x < m_fluxCount; x++) {
+            mean += m_fluxHistory[x];
+        }
+        mean /= m_fluxCount;
+        for (int x = 0; x < m_fluxCount; x++) {
+            float d = m_fluxHistory[x] - mean;
+            var += d * d;
+        }
+        var /= m_fluxCount;
+    }
+
+    // Adaptive threshold, need a bit of history before trusting it
+    float threshold = mean + 1.5f * sqrtf(var);
+    bool beat = (m_fluxCount >= (AUDIO_ANALYSIS_FLUX_HISTORY / 4)) &&
+                (flux > threshold) && (flux > m_working.flux) &&
+                ((m_working.timestamp - m_lastBeat) > AUDIO_ANALYSIS_MIN_BEAT_GAP);
+    if (beat) {
+        m_lastBeat = m_working.timestamp;
+        m_working.beatCount++;
+    }
+    m_working.beat = beat;
+    m_working.flux = flux;
+
+    m_fluxHistory[m_fluxIdx] = flux;
+    m_fluxIdx = (m_fluxIdx + 1) % AUDIO_ANALYSIS_FLUX_HISTORY;
+    if (m_fluxCount < AUDIO_ANALYSIS_FLUX_HISTORY) {
+        m_fluxCount++;
+    }
+}
+
+void AudioAnalysis::Publish(void) {
+    // Single writer seqlock, odd serial means an update is in progress
+    uint32_t serial = m_serial.load(std::memory_order_relaxed);
+    m_working.serial = (serial >> 1) + 1;
+    m_serial.store(serial + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_published = m_working;
+    m_serial.store(serial + 2, std::memory_order_release);
+}
+
+bool AudioAnalysis::GetSnapshot(AudioAnalysisSnapshot& snapshot) {
+    m_lastRead.store(GetMonotonicTime(), std::memory_order_relaxed);
+
+    for (int retry = 0; retry < 100; retry++) {
+        uint32_t serial = m_serial.load(std::memory_order_acquire);
+        if (serial & 1) {
+            continue;
+        }
+        snapshot = m_published;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (serial == m_serial.load(std::memory_order_relaxed)) {
+            return snapshot.valid;
+        }
+    }
+    snapshot.valid = false;
+    return false;
+}
@@ -0,0 +1,93 @@
+#pragma once
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include <atomic>
+#include <stdint.h>
+
+#define AUDIO_ANALYSIS_SAMPLES 1024
+#define AUDIO_ANALYSIS_BINS (AUDIO_ANALYSIS_SAMPLES / 2)
+#define AUDIO_ANALYSIS_BANDS 16
+#define AUDIO_ANALYSIS_FLUX_HISTORY 64
+
+class AudioAnalysisSnapshot {
+public:
+    bool valid = false;      // false if no audio is currently playing
+    uint32_t serial = 0;     // incremented for every analyzed frame
+    uint64_t timestamp = 0;  // GetMonotonicTime() of the analysis
+    int sampleRate = 0;
+
+    float rms = 0.0f;        // 0.0 - 1.0
+    float peak = 0.0f;       // 0.0 - 1.0, largest absolute sample
+
+    float bins[AUDIO_ANALYSIS_BINS];          // FFT magnitudes
+    float bands[AUDIO_ANALYSIS_BANDS];        // max magnitude in each band
+    uint8_t bandLevels[AUDIO_ANALYSIS_BANDS]; // bands scaled to 0-255 (log)
+
+    float majorPeakFreq = 0.0f;
+    float majorPeakMagnitude = 0.0f;
+    int majorPeakBin = 0;
+    int majorPeakBand = 0;
+    uint8_t maxBandLevel = 0;
+
+    float flux = 0.0f;       // positive spectral flux vs the previous frame
+    bool beat = false;       // onset detected on this frame
+    uint32_t beatCount = 0;
+};
+
+typedef struct kiss_fftr_state* kiss_fftr_cfg;
+
+/*
+ * Analyzes the currently playing audio once per output frame and publishes
+ * the result for overlays, effects and plugins.
+ *
+ * Process() is called from the channel output thread.  Readers call
+ * GetSnapshot() from any thread, it never blocks the writer.  Analysis is
+ * skipped while nobody has asked for a snapshot for a few seconds.
+ */
+class AudioAnalysis {
+public:
+    static AudioAnalysis INSTANCE;
+
+    AudioAnalysis();
+    ~AudioAnalysis();
+
+    void Process(void);
+
+    // Copies the latest analysis into snapshot, returns snapshot.valid
+    bool GetSnapshot(AudioAnalysisSnapshot& snapshot);
+
+    // Cheap check to see if a new analysis is available since 'serial'
+    uint32_t GetSerial(void) const { return m_serial.load(std::memory_order_acquire) >> 1; }
+
+private:
+    void Analyze(int sampleRate);
+    void DetectBeat(void);
+    void Publish(void);
+
+    kiss_fftr_cfg m_cfg = nullptr;
+    float m_window[AUDIO_ANALYSIS_SAMPLES];
+    float m_samples[AUDIO_ANALYSIS_SAMPLES];
+    float m_prevBins[AUDIO_ANALYSIS_BINS];
+    void* m_fftOut = nullptr;
+
+    float m_fluxHistory[AUDIO_ANALYSIS_FLUX_HISTORY];
+    int m_fluxIdx = 0;
+    int m_fluxCount = 0;
+    uint64_t m_lastBeat = 0;
+
+    // written only by Process(), published via the m_serial seqlock
+    AudioAnalysisSnapshot m_working;
+    AudioAnalysisSnapshot m_published;
+    std::atomic<uint32_t> m_serial;
+    std::atomic<uint64_t> m_lastRead;
+};
@@ -0,0 +1,299 @@
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include "fpp-pch.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "../common.h"
+#include "../log.h"
+#include "../settings.h"
+
+#include "PCMCache.h"
+
+// Version 2 entries are only written for media without a video stream
+#define PCM_CACHE_VERSION 2
+// Data starts on its own page so the mapping of it is page aligned
+#define PCM_CACHE_HEADER_SIZE 4096
+// Leftover temp files from a crash are removed after this many seconds
+#define PCM_CACHE_TMP_MAX_AGE 3600
+
+typedef struct __attribute__((packed)) {
+    char magic[4]; // 'FPCM'
+    uint32_t version;
+    uint32_t dataOffset;
+    int32_t rate;
+    int32_t bytesPerSample;
+    int32_t channels;
+    int32_t isFloat;
+    int64_t srcMtime;
+    int64_t srcSize;
+    int64_t duration;
+    uint64_t dataLen;
+    uint32_t pathLen;
+    // media file path follows
+} PCMCacheHeader;
+
+PCMCache PCMCache::INSTANCE;
+
+PCMCacheFile::PCMCacheFile(void* map, size_t mapLen, uint32_t dataOffset, uint64_t dataLen, int64_t dur) :
+    data((const uint8_t*)map + dataOffset),
+    len(dataLen),
+    duration(dur),
+    m_map(map),
+    m_mapLen(mapLen) {
+}
+PCMCacheFile::~PCMCacheFile() {
+    munmap(m_map, m_mapLen);
+}
+
+PCMCacheWriter::PCMCacheWriter(const std::string& mediaFile, const std::string& cacheFile,
+                               const std::string& tmpFile, FILE* f, const PCMFormat& fmt,
+                               int64_t duration, uint64_t maxLen) :
+    m_mediaFile(mediaFile),
+    m_cacheFile(cacheFile),
+    m_tmpFile(tmpFile),
+    m_file(f),
+    m_format(fmt),
+    m_duration(duration),
+    m_len(0),
+    m_maxLen(maxLen),
+    m_failed(false) {
+}
+PCMCacheWriter::~PCMCacheWriter() {
+    if (m_file) {
+        // never finished decoding, throw it away
+        fclose(m_file);
+        unlink(m_tmpFile.c_str());
+    }
+}
+
+void PCMCacheWriter::Write(const uint8_t* d, uint32_t len) {
+    if (m_failed) {
+        return;
+    }
+    if ((m_len + len) > m_maxLen || fwrite(d, 1, len, m_file) != len) {
+        // longer than the file claimed to be or out of space
+        m_failed = true;
+        return;
+    }
+    m_len += len;
+}
+
+void PCMCacheWriter::Commit(void) {
+    if (!m_file) {
+        return;
+    }
+    struct stat ms;
+    if (m_failed || !m_len || stat(m_mediaFile.c_str(), &ms)) {
+        return;
+    }
+
+    std::vector<uint8_t> buf(PCM_CACHE_HEADER_SIZE);
+    PCMCacheHeader* h = (PCMCacheHeader*)&buf[0];
+    memcpy(h->magic, "FPCM", 4);
+    h->version = PCM_CACHE_VERSION;
+    h->dataOffset = PCM_CACHE_HEADER_SIZE;
+    h->rate = m_format.rate;
+    h->bytesPerSample = m_format.bytesPerSample;
+    h->channels = m_format.channels;
+    h->isFloat = m_format.isFloat;
+    h->srcMtime = ms.st_mtime;
+    h->srcSize = ms.st_size;
+    h->duration = m_duration;
+    h->dataLen = m_len;
+    h->pathLen = std::min(m_mediaFile.size(), (size_t)(PCM_CACHE_HEADER_SIZE - sizeof(PCMCacheHeader)));
+    memcpy(&buf[sizeof(PCMCacheHeader)], m_mediaFile.c_str(), h->pathLen);
+
+    bool ok = !fseek(m_file, 0, SEEK_SET) && (fwrite(&buf[0], 1, buf.size(), m_file) == buf.size());
+    ok &= !fclose(m_file);
+    m_file = nullptr;
+    if (ok && !rename(m_tmpFile.c_str(), m_cacheFile.c_str())) {
+        LogDebug(VB_MEDIAOUT, "Cached %llu bytes of decoded audio for %s\n",
+                 (unsigned long long)m_len, m_mediaFile.c_str());
+        PCMCache::INSTANCE.EntryAdded();
+    } else {
+        unlink(m_tmpFile.c_str());
+    }
+}
+
+PCMCache::PCMCache() {
+}
+PCMCache::~PCMCache() {
+}
+
+int PCMCache::GetMaxLength(void) {
+    if (getSettingInt("AudioCacheSize", 0) <= 0) {
+        return 0;
+    }
+    return getSettingInt("AudioCacheMaxLength", 60);
+}
+
+std::string PCMCache::GetCacheFileName(const std::string& mediaFile, const PCMFormat& fmt) {
+    std::unique_lock<std::mutex> lock(m_lock);
+    if (m_cacheDir.empty()) {
+        m_cacheDir = FPP_DIR_MEDIA("/cache");
+    }
+    std::string key = mediaFile + ":" + std::to_string(fmt.rate) + ":" +
+                      std::to_string(fmt.bytesPerSample) + ":" + std::to_string(fmt.channels) +
+                      (fmt.isFloat ? ":f" : ":i");
+    char name[32];
+    snprintf(name, sizeof(name), "/pcm-%016llx.pcm", (unsigned long long)std::hash<std::string>{}(key));
+    return m_cacheDir + name;
+}
+
+PCMCacheFile* PCMCache::Open(const std::string& mediaFile, const PCMFormat& fmt) {
+    if (GetMaxLength() <= 0) {
+        return nullptr;
+    }
+    std::string cacheFile = GetCacheFileName(mediaFile, fmt);
+    int fd = open(cacheFile.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat cs;
+    struct stat ms;
+    if (fstat(fd, &cs) || stat(mediaFile.c_str(), &ms) || cs.st_size <= PCM_CACHE_HEADER_SIZE) {
+        close(fd);
+        return nullptr;
+    }
+    void* map = mmap(nullptr, cs.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return nullptr;
+    }
+
+    const PCMCacheHeader* h = (const PCMCacheHeader*)map;
+    bool valid = !memcmp(h->magic, "FPCM", 4) &&
+                 h->version == PCM_CACHE_VERSION &&
+                 h->dataOffset == PCM_CACHE_HEADER_SIZE &&
+                 h->rate == fmt.rate &&
+                 h->bytesPerSample == fmt.bytesPerSample &&
+                 h->channels == fmt.channels &&
+                 h->isFloat == fmt.isFloat &&
+                 h->srcMtime == ms.st_mtime &&
+                 h->srcSize == ms.st_size &&
+                 (h->dataOffset + h->dataLen) <= (uint64_t)cs.st_size &&
+                 h->pathLen == mediaFile.size() &&
+                 !memcmp((const char*)map + sizeof(PCMCacheHeader), mediaFile.c_str(), h->pathLen);
+    if (!valid) {
+        LogDebug(VB_MEDIAOUT, "Removing stale audio cache entry for %s\n", mediaFile.c_str());
+        munmap(map, cs.st_size);
+        unlink(cacheFile.c_str());
+        return nullptr;
+    }
+
+    // Start paging in the beginning and mark as most recently used
+    madvise(map, std::min((size_t)cs.st_size, (size_t)(1024 * 1024)), MADV_WILLNEED);
+    utimes(cacheFile.c_str(), nullptr);
+
+    LogDebug(VB_MEDIAOUT, "Using cached decoded audio for %s\n", mediaFile.c_str());
+    return new PCMCacheFile(map, cs.st_size, h->dataOffset, h->dataLen, h->duration);
+}
+
+PCMCacheWriter* PCMCache::CreateWriter(const std::string& mediaFile, const PCMFormat& fmt, int64_t duration) {
+    int maxLength = GetMaxLength();
+    if (maxLength <= 0 || duration <= 0 || duration > ((int64_t)maxLength * 1000000)) {
+        return nullptr;
+    }
+    // allow a bit over the reported duration, it is only an estimate
+    uint64_t bytesPerSecond = fmt.rate * fmt.bytesPerSample * fmt.channels;
+    uint64_t maxLen = (duration / 1000000 + 2) * bytesPerSecond;
+    if (maxLen > ((uint64_t)getSettingInt("AudioCacheSize", 0) * 1024 * 1024)) {
+        return nullptr;
+    }
+
+    std::string cacheFile = GetCacheFileName(mediaFile, fmt);
+    mkdir(m_cacheDir.c_str(), 0775);
+
+    std::string tmpFile = cacheFile + ".XXXXXX";
+    int fd = mkstemp(&tmpFile[0]);
+    if (fd < 0) {
+        LogDebug(VB_MEDIAOUT, "Could not create audio cache file %s: %s\n", tmpFile.c_str(), strerror(errno));
+        return nullptr;
+    }
+    FILE* f = fdopen(fd, "wb");
+    if (!f) {
+        close(fd);
+        unlink(tmpFile.c_str());
+        return nullptr;
+    }
+    // header is filled in on Commit
+    if (fseek(f, PCM_CACHE_HEADER_SIZE, SEEK_SET)) {
+        fclose(f);
+        unlink(tmpFile.c_str());
+        return nullptr;
+    }
+    return new PCMCacheWriter(mediaFile, cacheFile, tmpFile, f, fmt, duration, maxLen);
+}
+
+void PCMCache::Commit(PCMCacheWriter* writer) {
+    std::thread([writer]() {
+        writer->Commit();
+        delete writer;
+    }).detach();
+}
+
+void PCMCache::EntryAdded(void) {
+    Evict((uint64_t)getSettingInt("AudioCacheSize", 0) * 1024 * 1024);
+}
+
+void PCMCache::Evict(uint64_t budget) {
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    DIR* dir = opendir(m_cacheDir.c_str());
+    if (!dir) {
+        return;
+    }
+    std::vector<std::pair<time_t, std::pair<uint64_t, std::string>>> entries;
+    uint64_t total = 0;
+    time_t now = time(nullptr);
+    struct dirent* ep;
+    while ((ep = readdir(dir))) {
+        if (strncmp(ep->d_name, "pcm-", 4)) {
+            continue;
+        }
+        std::string fn = m_cacheDir + "/" + ep->d_name;
+        struct stat st;
+        if (stat(fn.c_str(), &st)) {
+            continue;
+        }
+        if (endsWith(fn, ".pcm")) {
+            entries.push_back({ st.st_mtime, { st.st_size, fn } });
+            total += st.st_size;
+        } else if ((now - st.st_mtime) > PCM_CACHE_TMP_MAX_AGE) {
+            unlink(fn.c_str());
+        }
+    }
+    closedir(dir);
+
+    // least recently played first
+    std::sort(entries.begin(), entries.end());
+    for (auto& e : entries) {
+        if (total <= budget) {
+            break;
+        }
+        LogDebug(VB_MEDIAOUT, "Removing %s from the audio cache\n", e.second.second.c_str());
+        unlink(e.second.second.c_str());
+        total -= e.second.first;
+    }
+}
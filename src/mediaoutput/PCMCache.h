@@ -0,0 +1,104 @@
+#pragma once
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+// Output format the PCM was converted to, a cache entry is only used if
+// the audio device is still running with the same format
+class PCMFormat {
+public:
+    int rate = 0;
+    int bytesPerSample = 0;
+    int channels = 0;
+    bool isFloat = false;
+};
+
+// Read only mapping of a cached file's decoded audio
+class PCMCacheFile {
+public:
+    PCMCacheFile(void* map, size_t mapLen, uint32_t dataOffset, uint64_t dataLen, int64_t duration);
+    ~PCMCacheFile();
+
+    const uint8_t* data;
+    uint64_t len;
+    int64_t duration; // AV_TIME_BASE units, same as AVFormatContext::duration
+
+private:
+    void* m_map;
+    size_t m_mapLen;
+};
+
+// Collects the decoded audio of a file as it is played, the entry only
+// becomes visible once Commit() is called after the whole file is decoded
+class PCMCacheWriter {
+public:
+    PCMCacheWriter(const std::string& mediaFile, const std::string& cacheFile,
+                   const std::string& tmpFile, FILE* f, const PCMFormat& fmt,
+                   int64_t duration, uint64_t maxLen);
+    ~PCMCacheWriter();
+
+    void Write(const uint8_t* d, uint32_t len);
+    void Commit(void);
+
+private:
+    std::string m_mediaFile;
+    std::string m_cacheFile;
+    std::string m_tmpFile;
+    FILE* m_file;
+    PCMFormat m_format;
+    int64_t m_duration;
+    uint64_t m_len;
+    uint64_t m_maxLen;
+    bool m_failed;
+};
+
+/*
+ * Cache of fully decoded PCM for short media files that are played over
+ * and over, kept in the media cache directory and mapped into memory on
+ * a hit so repeat plays skip the demuxer and decoder entirely.
+ *
+ * Entries are keyed by the media file path and output format and are
+ * validated against the file's mtime and size.  The total size of the
+ * entries is held to the AudioCacheSize setting by removing the least
+ * recently played ones.
+ */
+class PCMCache {
+public:
+    static PCMCache INSTANCE;
+
+    PCMCache();
+    ~PCMCache();
+
+    // Media longer than this (seconds) is not cached, 0 if disabled
+    int GetMaxLength(void);
+
+    PCMCacheFile* Open(const std::string& mediaFile, const PCMFormat& fmt);
+    PCMCacheWriter* CreateWriter(const std::string& mediaFile, const PCMFormat& fmt, int64_t duration);
+
+    // Finishes the entry and trims the cache on a background thread so the
+    // decode thread never waits on the filesystem, takes ownership of the writer
+    void Commit(PCMCacheWriter* writer);
+
+    // Called by the writer once a new entry is in place
+    void EntryAdded(void);
+
+private:
+    std::string GetCacheFileName(const std::string& mediaFile, const PCMFormat& fmt);
+    void Evict(uint64_t budget);
+
+    std::string m_cacheDir;
+    std::mutex m_lock;
+};
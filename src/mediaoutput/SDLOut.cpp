@@ -37,31 +37,201 @@ extern "C" {
 #include "../overlays/PixelOverlay.h"
 #include "../overlays/PixelOverlayModel.h"
 
+#include "PCMCache.h"
 #include "SDLOut.h"
+#include "mediaoutput.h"
 
 //Only keep 30 frames in buffer
 #define VIDEO_FRAME_MAX 30
+//Extra pool slots so a packet that decodes to more than one frame
+//doesn't need to drop any
+#define VIDEO_FRAME_POOL_SIZE (VIDEO_FRAME_MAX + 4)
 
 static const int DEFAULT_NUM_SAMPLES = 2048;
 
+// Keep the audio device open this long after media stops so the next
+// media in a playlist can start on it without reopening it
+#define SDL_DEVICE_IDLE_CLOSE_MS 5000
+
 static bool AudioHasStalled = false;
 
+/*
+ * Single producer (decode thread) / single consumer (SDL audio callback)
+ * byte ring for the decoded audio.  Neither side takes a lock, positions
+ * are running byte counts so the space/available math never has to deal
+ * with wrapping.
+ *
+ * The producer is held back 'history' bytes short of a full ring so the
+ * audio just handed to the device stays readable for GetAudioSamples().
+ */
+class AudioRing {
+public:
+    AudioRing(uint32_t size, uint32_t hist, uint32_t frameSize) :
+        history(hist),
+        frameBytes(frameSize),
+        readPos(0),
+        writePos(0) {
+        capacity = 1;
+        while (capacity < (size + history)) {
+            capacity <<= 1;
+        }
+        mask = capacity - 1;
+        buffer = new uint8_t[capacity];
+        memset(buffer, 0, capacity);
+    }
+    ~AudioRing() {
+        delete[] buffer;
+    }
+
+    // Only safe while the consumer is not running
+    void reset() {
+        readPos = 0;
+        writePos = 0;
+    }
+
+    uint64_t getReadPos() const { return readPos.load(std::memory_order_acquire); }
+    uint64_t getWritePos() const { return writePos.load(std::memory_order_acquire); }
+    uint32_t queued() const { return getWritePos() - getReadPos(); }
+
+    // Producer, only whole frames are written
+    uint32_t write(const uint8_t* d, uint32_t len) {
+        uint64_t w = writePos.load(std::memory_order_relaxed);
+        uint32_t space = capacity - history - (uint32_t)(w - getReadPos());
+        if (len > space) {
+            len = space - (space % frameBytes);
+        }
+        copyIn(w, d, len);
+        writePos.store(w + len, std::memory_order_release);
+        return len;
+    }
+
+    // Consumer
+    uint32_t read(uint8_t* d, uint32_t len) {
+        uint64_t r = readPos.load(std::memory_order_relaxed);
+        uint32_t avail = getWritePos() - r;
+        if (len > avail) {
+            len = avail;
+        }
+        copyOut(r, d, len);
+        readPos.store(r + len, std::memory_order_release);
+        return len;
+    }
+
+    // Pointer to the byte at a running position, pos must be within
+    // 'history' bytes behind the read position or before the write position
+    const uint8_t* at(uint64_t pos) const { return &buffer[pos & mask]; }
+
+    uint32_t history;
+    uint32_t frameBytes;
+
+private:
+    void copyIn(uint64_t pos, const uint8_t* d, uint32_t len) {
+        uint32_t off = pos & mask;
+        uint32_t first = std::min(len, capacity - off);
+        memcpy(&buffer[off], d, first);
+        memcpy(buffer, d + first, len - first);
+    }
+    void copyOut(uint64_t pos, uint8_t* d, uint32_t len) {
+        uint32_t off = pos & mask;
+        uint32_t first = std::min(len, capacity - off);
+        memcpy(d, &buffer[off], first);
+        memcpy(d + first, buffer, len - first);
+    }
+
+    uint8_t* buffer;
+    uint32_t capacity;
+    uint32_t mask;
+    std::atomic<uint64_t> readPos;
+    std::atomic<uint64_t> writePos;
+};
+
 class VideoFrame {
 public:
-    VideoFrame(int ms, uint8_t* d, int s) :
-        data(d),
-        timestamp(ms),
-        size(s) {
-        next = nullptr;
+    int timestamp = 0;
+    uint8_t* data = nullptr;
+};
+
+/*
+ * Fixed pool of video frames sized to the overlay model, used as a ring
+ * between the decode thread (producer) and the channel output thread
+ * (consumer).  Frame buffers are allocated once when the video is opened
+ * and sws_scale writes straight into them.  The consumer's current frame
+ * keeps its slot until it moves past it so the overlay can read it in
+ * place.
+ */
+class VideoFramePool {
+public:
+    VideoFramePool() :
+        readIdx(0),
+        writeIdx(0) {}
+    ~VideoFramePool() {
+        for (auto& f : frames) {
+            free(f.data);
+        }
+    }
+
+    void init(int size) {
+        frameSize = size;
+        for (auto& f : frames) {
+            f.data = (uint8_t*)calloc(1, size);
+        }
+    }
+
+    int getFrameSize() const { return frameSize; }
+
+    // Number of decoded frames, including the one currently displayed
+    int count() const { return writeIdx.load(std::memory_order_acquire) - readIdx.load(std::memory_order_acquire); }
+
+    // Producer, returns nullptr if all the slots are in use
+    VideoFrame* reserve() {
+        if (count() >= VIDEO_FRAME_POOL_SIZE) {
+            return nullptr;
+        }
+        return &frames[writeIdx.load(std::memory_order_relaxed) % VIDEO_FRAME_POOL_SIZE];
+    }
+    void commit() {
+        writeIdx.store(writeIdx.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer, moves to the newest frame at or before ms and returns it.
+    // 'skipped' is set to the number of frames passed over without being
+    // displayed.
+    VideoFrame* frameFor(unsigned int ms, int& skipped) {
+        uint32_t r = readIdx.load(std::memory_order_relaxed);
+        uint32_t w = writeIdx.load(std::memory_order_acquire);
+        skipped = 0;
+        if (r == w) {
+            return nullptr;
+        }
+        uint32_t start = r;
+        while ((r + 1) != w && frames[(r + 1) % VIDEO_FRAME_POOL_SIZE].timestamp <= ms) {
+            r++;
+        }
+        if (r != start) {
+            skipped = r - start - 1;
+            readIdx.store(r, std::memory_order_release);
+        }
+        return &frames[r % VIDEO_FRAME_POOL_SIZE];
     }
-    ~VideoFrame() {
-        free(data);
+
+    // Only used while the consumer isn't running
+    void dropBefore(int ms) {
+        uint32_t r = readIdx;
+        uint32_t w = writeIdx;
+        while (r != w && frames[r % VIDEO_FRAME_POOL_SIZE].timestamp < ms) {
+            r++;
+        }
+        readIdx = r;
+    }
+    void clear() {
+        readIdx = writeIdx.load();
     }
 
-    int timestamp;
-    int size;
-    uint8_t* data;
-    VideoFrame* next;
+private:
+    VideoFrame frames[VIDEO_FRAME_POOL_SIZE];
+    int frameSize = 0;
+    std::atomic<uint32_t> readIdx;
+    std::atomic<uint32_t> writeIdx;
 };
 
 void SetChannelOutputFrameNumber(int frameNumber);
@@ -74,6 +244,71 @@ static int DTStoMS(int64_t dts, int dtspersec) {
     return (int)(((int64_t)1000 * dts) / (int64_t)dtspersec);
 }
 
+class ResamplerFormat {
+public:
+    int64_t inLayout = 0;
+    int inFormat = -1;
+    int inRate = 0;
+    int64_t outLayout = 0;
+    int outFormat = -1;
+    int outRate = 0;
+
+    bool operator==(const ResamplerFormat& o) const {
+        return inLayout == o.inLayout && inFormat == o.inFormat && inRate == o.inRate &&
+               outLayout == o.outLayout && outFormat == o.outFormat && outRate == o.outRate;
+    }
+};
+
+/*
+ * Holds on to the resampler of the last media file so the next one can
+ * skip swr_alloc_set_opts/swr_init when the formats are the same, which
+ * is the normal case for a playlist of songs from the same source.
+ */
+class ResamplerCache {
+public:
+    ~ResamplerCache() {
+        if (ctx) {
+            swr_free(&ctx);
+        }
+    }
+
+    SwrContext* get(const ResamplerFormat& fmt) {
+        std::unique_lock<std::mutex> l(lock);
+        if (ctx && format == fmt) {
+            SwrContext* c = ctx;
+            ctx = nullptr;
+            return c;
+        }
+        l.unlock();
+
+        SwrContext* c = swr_alloc_set_opts(nullptr,
+                                           fmt.outLayout, (AVSampleFormat)fmt.outFormat, fmt.outRate,
+                                           fmt.inLayout, (AVSampleFormat)fmt.inFormat, fmt.inRate,
+                                           0, nullptr);
+        swr_init(c);
+        return c;
+    }
+    void put(SwrContext* c, const ResamplerFormat& fmt) {
+        // don't let the tail of the last file leak into the next one
+        int64_t delay = swr_get_delay(c, fmt.outRate);
+        if (delay > 0) {
+            swr_drop_output(c, delay);
+        }
+        std::unique_lock<std::mutex> l(lock);
+        if (ctx) {
+            swr_free(&ctx);
+        }
+        ctx = c;
+        format = fmt;
+    }
+
+private:
+    std::mutex lock;
+    SwrContext* ctx = nullptr;
+    ResamplerFormat format;
+};
+static ResamplerCache resamplerCache;
+
 class SDLInternalData {
 public:
     SDLInternalData(int rate, int bps, bool flt, int ch) :
@@ -90,9 +325,10 @@ public:
         au_convert_ctx = nullptr;
         decodedDataLen = 0;
         swsCtx = nullptr;
-        firstVideoFrame = lastVideoFrame = nullptr;
-        curVideoFrame = nullptr;
-        videoFrameCount = 0;
+        videoFrameMS = 0;
+        videoClockMS = -1;
+        videoFramesLate = 0;
+        videoFramesSkipped = 0;
         audioDev = 0;
         outBufferPos = 0;
         currentRate = rate;
@@ -104,8 +340,17 @@ public:
         maxQueueSize = minQueueSize * ch;
         outBuffer = new uint8_t[maxQueueSize];
 
-        sampleBuffer = new uint8_t[maxQueueSize * 2];
-        sampleBufferCount = 0;
+        // keep enough behind the read position to cover what the device
+        // is still playing plus a window for GetAudioSamples
+        int frameBytes = bps * ch;
+        audioRing = new AudioRing(maxQueueSize, DEFAULT_NUM_SAMPLES * 4 * frameBytes, frameBytes);
+        bytesPerSecond = rate * frameBytes;
+        deviceBufferBytes = DEFAULT_NUM_SAMPLES * frameBytes;
+        clockOffset = 0;
+        clockSeq = 0;
+        clockPos = 0;
+        clockTime = 0;
+        underruns = 0;
     }
     ~SDLInternalData() {
         if (frame != nullptr) {
@@ -124,26 +369,26 @@ public:
             sws_freeContext(swsCtx);
             swsCtx = nullptr;
         }
-        while (firstVideoFrame) {
-            VideoFrame* t = firstVideoFrame;
-            firstVideoFrame = t->next;
-            delete t;
-        }
         if (scaledFrame != nullptr) {
-            if (scaledFrame->data[0] != nullptr) {
-                av_free(scaledFrame->data[0]);
-            }
-
             av_free(scaledFrame);
         }
         if (formatContext != nullptr) {
             avformat_close_input(&formatContext);
         }
         if (au_convert_ctx != nullptr) {
-            swr_free(&au_convert_ctx);
+            resamplerCache.put(au_convert_ctx, resamplerFormat);
+            au_convert_ctx = nullptr;
+        }
+
+        if (pcmWriter) {
+            delete pcmWriter;
+        }
+        if (pcmCache) {
+            delete pcmCache;
         }
 
         delete[] outBuffer;
+        delete audioRing;
     }
 
     volatile int stopped;
@@ -156,6 +401,7 @@ public:
     int audio_stream_idx = -1;
     AVStream* audioStream;
     SwrContext* au_convert_ctx;
+    ResamplerFormat resamplerFormat;
     unsigned int totalDataLen;
     unsigned int decodedDataLen;
     float totalLen;
@@ -169,8 +415,19 @@ public:
     int minQueueSize;
     int maxQueueSize;
 
-    uint8_t* sampleBuffer;
-    int sampleBufferCount;
+    AudioRing* audioRing;
+    int bytesPerSecond;
+    uint32_t deviceBufferBytes;
+
+    // Sample clock, updated by the audio callback.  clockPos is the number
+    // of ring bytes handed to the device before the callback at clockTime
+    // (monotonic us), clockSeq makes the pair readable without a lock.
+    std::atomic<uint32_t> clockSeq;
+    std::atomic<uint64_t> clockPos;
+    std::atomic<int64_t> clockTime;
+    std::atomic<uint32_t> underruns;
+    // Bytes of media skipped before the ring was started
+    uint64_t clockOffset;
 
     // stuff for the video stream
     AVCodecContext* videoCodecContext;
@@ -180,41 +437,104 @@ public:
     int video_frames;
     AVFrame* scaledFrame;
     SwsContext* swsCtx;
-    VideoFrame* firstVideoFrame;
-    VideoFrame* lastVideoFrame;
-    volatile VideoFrame* volatile curVideoFrame;
-    int videoFrameCount;
+    VideoFramePool videoFrames;
+    int videoFrameMS;
+    // Last timestamp the overlay asked for, frames older than this by more
+    // than a frame are dropped before being scaled
+    std::atomic<int> videoClockMS;
+    std::atomic<uint32_t> videoFramesLate;
+    std::atomic<uint32_t> videoFramesSkipped;
     unsigned int totalVideoLen;
     long long videoStartTime;
     PixelOverlayModel* videoOverlayModel = nullptr;
 
     bool doneRead;
     unsigned int curPos;
-    std::mutex curPosLock;
-
-    void addVideoFrame(int ms, uint8_t* d, int sz) {
-        VideoFrame* f = new VideoFrame(ms, d, sz);
-        if (firstVideoFrame == nullptr) {
-            curVideoFrame = f;
-            firstVideoFrame = f;
-            lastVideoFrame = f;
+    int64_t duration = 0;
+
+    // Decoded audio from the PCM cache, replaces the demuxer/decoder
+    PCMCacheFile* pcmCache = nullptr;
+    uint64_t pcmCachePos = 0;
+    // Records the decoded audio into the PCM cache on the first play
+    PCMCacheWriter* pcmWriter = nullptr;
+
+    // Runs on the SDL audio thread, must not block
+    void fillAudio(uint8_t* stream, int len) {
+        int64_t now = GetMonotonicTime();
+        uint64_t pos = audioRing->getReadPos();
+        uint32_t seq = clockSeq.load(std::memory_order_relaxed);
+        clockSeq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        clockPos.store(pos, std::memory_order_relaxed);
+        clockTime.store(now, std::memory_order_relaxed);
+        clockSeq.store(seq + 2, std::memory_order_release);
+
+        uint32_t want = len > 0 ? (uint32_t)len : 0;
+        uint32_t n = audioRing->read(stream, want);
+        if (n < want) {
+            memset(stream + n, 0, want - n);
+            if (!doneRead) {
+                underruns++;
+            }
+        }
+    }
+
+    // Number of ring bytes that have reached the DAC at monotonic time now.
+    // At the last callback the device had deviceBufferBytes still to play
+    // ahead of everything handed to it in that callback, from there the
+    // position moves at the sample rate until the next callback.
+    uint64_t getPlayedBytes(int64_t now) {
+        uint32_t seq;
+        uint64_t pos;
+        int64_t t;
+        do {
+            seq = clockSeq.load(std::memory_order_acquire);
+            pos = clockPos.load(std::memory_order_relaxed);
+            t = clockTime.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((seq & 1) || seq != clockSeq.load(std::memory_order_relaxed));
+
+        if (t == 0) {
+            return 0;
+        }
+        uint64_t base = pos > (uint64_t)deviceBufferBytes ? pos - deviceBufferBytes : 0;
+        uint64_t elapsed = now > t ? ((uint64_t)(now - t) * (uint64_t)bytesPerSecond / 1000000) : 0;
+        uint64_t played = base + elapsed;
+        if (played > pos) {
+            played = pos;
+        }
+        return played - (played % audioRing->frameBytes);
+    }
+
+    void addVideoFrame(int ms) {
+        if ((ms + videoFrameMS) < videoClockMS) {
+            // decode has fallen behind, the frame would never be shown
+            videoFramesLate++;
+            return;
+        }
+        VideoFrame* f = videoFrames.reserve();
+        if (f == nullptr) {
+            videoFramesLate++;
+            return;
+        }
+        if (swsCtx) {
+            uint8_t* dst[4] = { f->data, nullptr, nullptr, nullptr };
+            int dstStride[4] = { scaledFrame->width * 3, 0, 0, 0 };
+            sws_scale(swsCtx, frame->data, frame->linesize, 0,
+                      videoCodecContext->height, dst, dstStride);
         } else {
-            lastVideoFrame->next = f;
-            lastVideoFrame = f;
+            int sz = std::min(frame->linesize[0] * frame->height, videoFrames.getFrameSize());
+            memcpy(f->data, frame->data[0], sz);
         }
-        ++videoFrameCount;
+        f->timestamp = ms;
+        videoFrames.commit();
     }
 
     int buffersFull(bool flushaudio) {
         int retVal = -1;
         if (video_stream_idx != -1) {
             //if video
-            while (firstVideoFrame && (firstVideoFrame != curVideoFrame)) {
-                videoFrameCount--;
-                auto tmp = firstVideoFrame->next;
-                delete firstVideoFrame;
-                firstVideoFrame = tmp;
-            }
+            int videoFrameCount = videoFrames.count();
             retVal = (doneRead || (videoFrameCount >= VIDEO_FRAME_MAX)) ? 2
                                                                         : ((videoFrameCount >= (VIDEO_FRAME_MAX - 6)) ? 1 : 0);
             if (!flushaudio) {
@@ -223,30 +543,12 @@ public:
         }
         if (audioDev == 0) {
             //no audio device, clear the audio buffer
-            curPosLock.lock();
             curPos += outBufferPos;
             outBufferPos = 0;
-            curPosLock.unlock();
             return retVal >= 0 ? retVal : 2;
         }
-        unsigned int queue = SDL_GetQueuedAudioSize(audioDev);
-        //if we have data and are either below the queue threshold or we've finished reading
-        if (outBufferPos && ((queue < minQueueSize) || doneRead)) {
-            curPosLock.lock();
-            SDL_QueueAudio(audioDev, outBuffer, outBufferPos);
-            queue = SDL_GetQueuedAudioSize(audioDev);
-            int ms = queue - outBufferPos;
-            if (ms < sampleBufferCount) {
-                memmove(sampleBuffer, &sampleBuffer[sampleBufferCount - ms], ms);
-                sampleBufferCount = ms;
-            }
-            memcpy(&sampleBuffer[sampleBufferCount], outBuffer, outBufferPos);
-            sampleBufferCount += outBufferPos;
-
-            curPos += outBufferPos;
-            outBufferPos = 0;
-            curPosLock.unlock();
-        }
+        pushAudio();
+        unsigned int queue = audioRing->queued();
         if (retVal >= 0) {
             return retVal;
         }
@@ -262,13 +564,49 @@ public:
         }
         return 2;
     }
+    // Move as much of the decoded audio as will fit into the ring
+    void pushAudio() {
+        if (outBufferPos) {
+            uint32_t n = audioRing->write(outBuffer, outBufferPos);
+            if (n) {
+                memmove(outBuffer, &outBuffer[n], outBufferPos - n);
+                outBufferPos -= n;
+                curPos += n;
+            }
+        }
+    }
+
+    int fillFromCache(bool first) {
+        if (outBufferPos >= maxQueueSize) {
+            return 0;
+        }
+        int frameBytes = bytesPerSample * channels;
+        uint64_t len = first ? minQueueSize : (bytesPerSecond / 10);
+        len = std::min(len, (uint64_t)(maxQueueSize - outBufferPos));
+        len = std::min(len, pcmCache->len - pcmCachePos);
+        len -= len % frameBytes;
+
+        memcpy(&outBuffer[outBufferPos], pcmCache->data + pcmCachePos, len);
+        pcmCachePos += len;
+        outBufferPos += len;
+        decodedDataLen += len;
+        if ((pcmCache->len - pcmCachePos) < frameBytes) {
+            totalDataLen = decodedDataLen;
+            doneRead = true;
+        }
+        return len;
+    }
+
     int maybeFillBuffer(bool first) {
-        if (doneRead || videoFrameCount > VIDEO_FRAME_MAX) {
+        if (doneRead || videoFrames.count() > VIDEO_FRAME_MAX) {
             //buffers are full, don't so anything
             if (AudioHasStalled)
                 LogWarn(VB_MEDIAOUT, "Stalled audio, buffers are full.  %d\n", doneRead);
             return 0;
         }
+        if (pcmCache) {
+            return fillFromCache(first);
+        }
         if (AudioHasStalled)
             LogWarn(VB_MEDIAOUT, "Stalled audio, buffers still filling.\n");
         int orig = outBufferPos;
@@ -293,6 +631,9 @@ public:
                                                      (const uint8_t**)frame->extended_data,
                                                      frame->nb_samples);
 
+                        if (pcmWriter && outSamples > 0) {
+                            pcmWriter->Write(out_buffer, outSamples * bytesPerSample * channels);
+                        }
                         outBufferPos += (outSamples * bytesPerSample * channels);
                         if (outBufferPos > maxQueueSize) {
                             AudioHasStalled = true;
@@ -316,22 +657,7 @@ public:
                 while (avcodec_send_packet(videoCodecContext, &readingPacket)) {
                     while (!avcodec_receive_frame(videoCodecContext, frame)) {
                         int ms = DTStoMS(frame->pkt_dts, video_dtspersec);
-
-                        if (swsCtx) {
-                            sws_scale(swsCtx, frame->data, frame->linesize, 0,
-                                      videoCodecContext->height, scaledFrame->data,
-                                      scaledFrame->linesize);
-
-                            int sz = scaledFrame->linesize[0] * scaledFrame->height;
-                            uint8_t* d = (uint8_t*)malloc(sz);
-                            memcpy(d, scaledFrame->data[0], sz);
-                            addVideoFrame(ms, d, sz);
-                        } else {
-                            int sz = frame->linesize[0] * frame->height;
-                            uint8_t* d = (uint8_t*)malloc(sz);
-                            memcpy(d, frame->data[0], sz);
-                            addVideoFrame(ms, d, sz);
-                        }
+                        addVideoFrame(ms);
                         vidPacket = true;
                         av_frame_unref(frame);
                     }
@@ -342,7 +668,7 @@ public:
 
             if (packetOk) {
                 if (first) {
-                    if ((outBufferPos > minQueueSize || videoFrameCount > VIDEO_FRAME_MAX)) {
+                    if ((outBufferPos > minQueueSize || videoFrames.count() > VIDEO_FRAME_MAX)) {
                         return outBufferPos - orig;
                     }
                 } else if (video_stream_idx != -1 && !vidPacket) {
@@ -355,6 +681,10 @@ public:
 
         totalDataLen = decodedDataLen;
         doneRead = true;
+        if (pcmWriter) {
+            PCMCache::INSTANCE.Commit(pcmWriter);
+            pcmWriter = nullptr;
+        }
         return outBufferPos - orig;
     }
 };
@@ -422,6 +752,7 @@ class SDL {
     int _bytesPerSample;
     int _channels;
     bool _isSampleFloat;
+    int _deviceSamples;
     SDL_AudioDeviceID audioDev;
     std::atomic_bool decoding;
 
@@ -429,9 +760,11 @@ public:
     SDL() :
         data(nullptr),
         _state(SDLSTATE::SDLUNINITIALISED),
-        decodeThread(nullptr) {}
+        decodeThread(nullptr),
+        prerolling(false) {}
     virtual ~SDL();
 
+    bool isDeviceOpen() { return _state != SDLSTATE::SDLINITIALISED && _state != SDLSTATE::SDLUNINITIALISED; }
     int getRate() { return _initialisedRate; }
     int getBytesPerSample() { return _bytesPerSample; }
     bool isSamplesFloat() { return _isSampleFloat; }
@@ -440,6 +773,15 @@ public:
     static void decodeThreadEntry(SDL* sdl) {
         sdl->runDecode();
     }
+    static void audioCallback(void* userdata, Uint8* stream, int len) {
+        SDL* sdl = (SDL*)userdata;
+        SDLInternalData* d = sdl->data;
+        if (d) {
+            d->fillAudio(stream, len);
+        } else {
+            memset(stream, 0, len);
+        }
+    }
     bool Start(SDLInternalData* d, int msTime) {
         if (!initSDL()) {
             return false;
@@ -462,23 +804,13 @@ public:
                     d->outBufferPos -= c;
                     d->maybeFillBuffer(false);
 
-                    while (d->firstVideoFrame && d->firstVideoFrame->timestamp < msTime) {
-                        VideoFrame* t = d->firstVideoFrame;
-                        d->firstVideoFrame = t->next;
-                        delete t;
-                    }
-                    d->curVideoFrame = d->firstVideoFrame;
+                    d->videoFrames.dropBefore(msTime);
                     d->maybeFillBuffer(false);
                 } else {
                     //need to skip the entire chunk, just wipe it out
                     d->curPos += d->outBufferPos;
                     d->outBufferPos = 0;
-                    while (d->firstVideoFrame) {
-                        VideoFrame* t = d->firstVideoFrame;
-                        d->firstVideoFrame = t->next;
-                        delete t;
-                    }
-                    d->curVideoFrame = nullptr;
+                    d->videoFrames.clear();
                     d->maybeFillBuffer(false);
                 }
             }
@@ -488,25 +820,31 @@ public:
             decodeThread = new std::thread(decodeThreadEntry, this);
         }
         if (_state != SDLSTATE::SDLINITIALISED && _state != SDLSTATE::SDLUNINITIALISED) {
-            data = d;
             if (audioDev) {
-                data->curPosLock.lock();
-                SDL_ClearQueuedAudio(audioDev);
-                SDL_QueueAudio(audioDev, data->outBuffer, data->outBufferPos);
-                memcpy(data->sampleBuffer, data->outBuffer, data->outBufferPos);
-                data->sampleBufferCount = data->outBufferPos;
-                data->curPos += data->outBufferPos;
-                data->outBufferPos = 0;
-                data->curPosLock.unlock();
-                SDL_PauseAudioDevice(audioDev, 0);
+                // data isn't set yet so the callback isn't touching the ring
+                d->audioRing->reset();
+                d->clockOffset = d->curPos;
+                d->clockTime = 0;
+                d->deviceBufferBytes = _deviceSamples * _channels * _bytesPerSample;
+                d->pushAudio();
             } else {
-                data->curPos = 0;
-                data->outBufferPos = 0;
+                d->curPos = 0;
+                d->outBufferPos = 0;
             }
-            data->audioDev = audioDev;
+            d->audioDev = audioDev;
 
             long long t = GetTime() / 1000;
-            data->videoStartTime = t;
+            d->videoStartTime = t;
+            if (audioDev) {
+                // the device may still be running from the previous media,
+                // swap the data in between callbacks
+                SDL_LockAudioDevice(audioDev);
+                data = d;
+                SDL_UnlockAudioDevice(audioDev);
+                SDL_PauseAudioDevice(audioDev, 0);
+            } else {
+                data = d;
+            }
             _state = SDLSTATE::SDLPLAYING;
             return true;
         }
@@ -515,11 +853,16 @@ public:
     void Stop() {
         if (_state == SDLSTATE::SDLPLAYING) {
             if (audioDev) {
-                SDL_PauseAudioDevice(audioDev, 1);
-                SDL_ClearQueuedAudio(audioDev);
+                // Leave the device running (playing silence) so the next
+                // media can start on it without reopening, once unlocked
+                // the callback won't touch data again so it can be released
+                SDL_LockAudioDevice(audioDev);
+                data = nullptr;
+                SDL_UnlockAudioDevice(audioDev);
+            } else {
+                data = nullptr;
             }
-            SDLInternalData* d = data;
-            data = nullptr;
+            idleCloseTime = GetTimeMS() + SDL_DEVICE_IDLE_CLOSE_MS;
             _state = SDLSTATE::SDLNOTPLAYING;
             while (decoding) {
                 //wait for decoding thread to be done with it
@@ -527,15 +870,29 @@ public:
             }
         }
     }
-    void Close() {
+    // The device is closed once it has been idle for a while unless
+    // 'now' is set, see closeIdleDevice().  openAudio() reopens it if the
+    // audio settings changed while it was kept open.
+    void Close(bool now = false) {
         Stop();
-        if (_state != SDLSTATE::SDLINITIALISED && _state != SDLSTATE::SDLUNINITIALISED) {
-            if (audioDev) {
-                SDL_CloseAudioDevice(audioDev);
-            }
-            _state = SDLSTATE::SDLINITIALISED;
+        if (now) {
+            std::unique_lock<std::mutex> l(deviceLock);
+            closeDevice();
         }
     }
+    void closeIdleDevice() {
+        std::unique_lock<std::mutex> l(deviceLock);
+        if (idleCloseTime && data == nullptr && _state == SDLSTATE::SDLNOTPLAYING && GetTimeMS() > idleCloseTime) {
+            LogDebug(VB_MEDIAOUT, "Closing idle audio device\n");
+            closeDevice();
+        }
+    }
+
+    // Open/decode the start of a media file in the background so the
+    // SDLOutput for it can start immediately
+    void preroll(const std::string& path, const std::string& videoOut);
+    SDLInternalData* takePreroll(const std::string& path, const std::string& videoOut);
+    void clearPreroll();
 
     bool initSDL();
     bool openAudio();
@@ -544,6 +901,37 @@ public:
     SDLInternalData* volatile data;
     std::thread* decodeThread;
     std::set<std::string> blacklisted;
+
+private:
+    // must hold deviceLock
+    void closeDevice() {
+        if (_state != SDLSTATE::SDLINITIALISED && _state != SDLSTATE::SDLUNINITIALISED) {
+            if (audioDev) {
+                SDL_PauseAudioDevice(audioDev, 1);
+                SDL_CloseAudioDevice(audioDev);
+                audioDev = 0;
+            }
+            _state = SDLSTATE::SDLINITIALISED;
+        }
+        idleCloseTime = 0;
+    }
+    void prerollThreadMain(std::string path, std::string videoOut);
+
+    std::mutex deviceLock;
+    uint64_t idleCloseTime = 0;
+    // AudioOutput/AudioFormat/AudioLayout the device was opened with
+    std::string deviceSettings;
+
+    std::mutex prerollLock;
+    std::thread* prerollThread = nullptr;
+    std::atomic_bool prerolling;
+    // set when the preroll in progress is no longer wanted
+    bool prerollCancelled = false;
+    std::string prerollingPath;
+    std::string prerollingVideoOut;
+    std::string prerollPath;
+    std::string prerollVideoOut;
+    SDLInternalData* prerollData = nullptr;
 };
 
 static SDL sdlManager;
@@ -565,6 +953,7 @@ void SDL::runDecode() {
         SDLInternalData* data = this->data;
         if (data == nullptr) {
             decoding = false;
+            closeIdleDevice();
             std::this_thread::sleep_for(std::chrono::milliseconds(250));
         } else {
             int bufFull = data->buffersFull(true);
@@ -596,7 +985,7 @@ void SDL::runDecode() {
                     }
                 }
             }
-            if (data->video_stream_idx != -1 && data->videoFrameCount < 15) {
+            if (data->video_stream_idx != -1 && data->videoFrames.count() < 15) {
                 //we won't sleep, need to keep decoding
                 decoding = false;
             } else {
@@ -670,7 +1059,18 @@ static int ChannelsForLayout(int i) {
 static bool noDeviceWarning = false;
 static std::string noDeviceError;
 bool SDL::openAudio() {
+    std::unique_lock<std::mutex> l(deviceLock);
+    idleCloseTime = 0;
+    std::string settings = getSetting("AudioOutput") + ":" + getSetting("AudioFormat") + ":" + getSetting("AudioLayout");
+    if (data == nullptr && settings != deviceSettings) {
+        // the device is left open between media, pick up setting changes
+        if (_state != SDLSTATE::SDLINITIALISED && _state != SDLSTATE::SDLUNINITIALISED) {
+            LogDebug(VB_MEDIAOUT, "Audio settings changed, reopening audio device\n");
+        }
+        closeDevice();
+    }
     if (_state == SDLSTATE::SDLINITIALISED) {
+        deviceSettings = settings;
         int tp = getSettingInt("AudioFormat");
 
         SDL_memset(&_wanted_spec, 0, sizeof(_wanted_spec));
@@ -765,8 +1165,8 @@ bool SDL::openAudio() {
         _wanted_spec.channels = ChannelsForLayout(clayout);
         _wanted_spec.silence = 0;
         _wanted_spec.samples = DEFAULT_NUM_SAMPLES;
-        _wanted_spec.callback = nullptr;
-        _wanted_spec.userdata = nullptr;
+        _wanted_spec.callback = audioCallback;
+        _wanted_spec.userdata = this;
 
         SDL_AudioSpec have;
         audioDev = SDL_OpenAudioDevice(audioDeviceName == "" ? nullptr : audioDeviceName.c_str(), 0, &_wanted_spec, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_FORMAT_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE);
@@ -796,6 +1196,7 @@ bool SDL::openAudio() {
         _bytesPerSample = (have.format == AUDIO_S16) ? 2 : 4;
         _isSampleFloat = (have.format == AUDIO_F32);
         _channels = have.channels;
+        _deviceSamples = have.samples ? have.samples : DEFAULT_NUM_SAMPLES;
 
         _state = SDLSTATE::SDLOPENED;
 
@@ -809,6 +1210,21 @@ bool SDL::openAudio() {
 SDL::~SDL() {
     Stop();
     Close();
+    std::unique_lock<std::mutex> l(prerollLock);
+    prerollCancelled = true;
+    if (prerollThread) {
+        std::thread* t = prerollThread;
+        prerollThread = nullptr;
+        l.unlock();
+        t->join();
+        delete t;
+        l.lock();
+    }
+    if (prerollData) {
+        delete prerollData;
+        prerollData = nullptr;
+    }
+    l.unlock();
     if (_state != SDLSTATE::SDLUNINITIALISED) {
         SDL_Quit();
         _state = SDLSTATE::SDLUNINITIALISED;
@@ -833,17 +1249,15 @@ bool SDLOutput::IsOverlayingVideo() {
 }
 bool SDLOutput::ProcessVideoOverlay(unsigned int msTimestamp) {
     SDLInternalData* data = sdlManager.data;
-    if (data && !data->stopped && data->video_stream_idx != -1 && data->curVideoFrame && data->videoOverlayModel) {
-        while (data->curVideoFrame->next && data->curVideoFrame->next->timestamp <= msTimestamp) {
-            data->curVideoFrame = data->curVideoFrame->next;
+    if (data && !data->stopped && data->video_stream_idx != -1 && data->videoOverlayModel) {
+        data->videoClockMS = msTimestamp;
+        int skipped = 0;
+        VideoFrame* vf = data->videoFrames.frameFor(msTimestamp, skipped);
+        if (skipped) {
+            data->videoFramesSkipped += skipped;
         }
-        if (msTimestamp <= data->totalVideoLen) {
-            VideoFrame* vf = (VideoFrame*)data->curVideoFrame;
-
-            long long t = GetTime() / 1000;
-            int t2 = ((int)t) - data->videoStartTime;
-
-            //printf("v:  %d  %d      %d        %d\n", msTimestamp, vf->timestamp, t2, sdlManager.data->videoFrameCount);
+        if (vf && msTimestamp <= data->totalVideoLen) {
+            //the overlay maps straight out of the pool slot
             data->videoOverlayModel->setData(vf->data);
 
             if (data->videoOverlayModel->getState() == PixelOverlayState::Disabled) {
@@ -855,37 +1269,39 @@ bool SDLOutput::ProcessVideoOverlay(unsigned int msTimestamp) {
 }
 bool SDLOutput::GetAudioSamples(float* samples, int numSamples, int& sampleRate) {
     SDLInternalData* data = sdlManager.data;
-    if (data && !data->stopped) {
-        //printf("In Samples:  %d\n", data->outBufferPos);
-        data->curPosLock.lock();
-        int queue = SDL_GetQueuedAudioSize(data->audioDev);
-        if (data->bytesPerSample == 2) {
-            int offset = data->sampleBufferCount - queue;
-            int16_t* ds = (int16_t*)(&data->sampleBuffer[offset]);
-            //just grab the left channel audio
-            for (int x = 0; x < numSamples; x++) {
-                samples[x] = ds[x * data->channels];
+    if (data && !data->stopped && data->audioDev) {
+        // Start at what is currently playing, everything from there up to
+        // the read position is still in the ring's history window
+        AudioRing* ring = data->audioRing;
+        uint64_t pos = data->getPlayedBytes(GetMonotonicTime());
+        uint64_t readPos = ring->getReadPos();
+        uint64_t writePos = ring->getWritePos();
+        if ((pos + ring->history) < readPos) {
+            pos = readPos - ring->history;
+        }
+        int frameBytes = ring->frameBytes;
+        int avail = (writePos - pos) / frameBytes;
+        if (avail > numSamples) {
+            avail = numSamples;
+        }
+        //just grab the left channel audio
+        for (int x = 0; x < avail; x++, pos += frameBytes) {
+            const uint8_t* d = ring->at(pos);
+            if (data->bytesPerSample == 2) {
+                samples[x] = *(const int16_t*)d;
                 samples[x] /= 32767.0f;
-            }
-        } else if (data->isSamplesFloat) {
-            int offset = data->sampleBufferCount - queue;
-            float* ds = (float*)(&data->sampleBuffer[offset]);
-            //just grab the left channel audio
-            for (int x = 0; x < numSamples; x++) {
-                samples[x] = ds[x * data->channels];
-            }
-        } else {
-            //32bit sampling
-            int offset = data->sampleBufferCount - queue;
-            int32_t* ds = (int32_t*)(&data->sampleBuffer[offset]);
-            //just grab the left channel audio
-            for (int x = 0; x < numSamples; x++) {
-                samples[x] = ds[x * data->channels];
+            } else if (data->isSamplesFloat) {
+                samples[x] = *(const float*)d;
+            } else {
+                //32bit sampling
+                samples[x] = *(const int32_t*)d;
                 samples[x] /= 0x8FFFFFFF;
             }
         }
+        for (int x = avail; x < numSamples; x++) {
+            samples[x] = 0.0f;
+        }
         sampleRate = data->currentRate;
-        data->curPosLock.unlock();
         return true;
     }
     return false;
@@ -924,24 +1340,7 @@ static void LogCallback(void* avcl,
 /*
  *
  */
-SDLOutput::SDLOutput(const std::string& mediaFilename,
-                     MediaOutputStatus* status,
-                     const std::string& videoOutput) {
-    LogDebug(VB_MEDIAOUT, "SDLOutput::SDLOutput(%s)\n",
-             mediaFilename.c_str());
-    data = nullptr;
-    m_mediaOutputStatus = status;
-    m_mediaOutputStatus->status = MEDIAOUTPUTSTATUS_IDLE;
-
-    m_mediaOutputStatus->mediaSeconds = 0.0;
-    m_mediaOutputStatus->secondsElapsed = 0;
-    m_mediaOutputStatus->subSecondsElapsed = 0;
-
-    if (sdlManager.blacklisted.find(mediaFilename) != sdlManager.blacklisted.end()) {
-        currentMediaFilename = "";
-        LogErr(VB_MEDIAOUT, "%s has been blacklisted!\n", mediaFilename.c_str());
-        return;
-    }
+static std::string GetMediaPath(const std::string& mediaFilename) {
     std::string fullAudioPath = mediaFilename;
     if (!FileExists(mediaFilename)) {
         fullAudioPath = FPP_DIR_MUSIC("/" + mediaFilename);
@@ -950,25 +1349,43 @@ SDLOutput::SDLOutput(const std::string& mediaFilename,
         fullAudioPath = FPP_DIR_VIDEO("/" + mediaFilename);
     }
     if (!FileExists(fullAudioPath)) {
-        LogErr(VB_MEDIAOUT, "%s does not exist!\n", fullAudioPath.c_str());
-        currentMediaFilename = "";
-        return;
-    }
-    if (sdlManager.blacklisted.find(fullAudioPath) != sdlManager.blacklisted.end()) {
-        currentMediaFilename = "";
-        LogErr(VB_MEDIAOUT, "%s has been blacklisted!\n", mediaFilename.c_str());
-        return;
+        return "";
     }
-    currentMediaFilename = mediaFilename;
-    m_mediaFilename = mediaFilename;
-
-    av_log_set_flags(AV_LOG_SKIP_REPEATED);
-    av_log_set_callback(LogCallback);
-
-    sdlManager.initSDL();
-    sdlManager.openAudio();
+    return fullAudioPath;
+}
 
-    data = new SDLInternalData(sdlManager.getRate(), sdlManager.getBytesPerSample(), sdlManager.isSamplesFloat(), sdlManager.numChannels());
+// Opens the media and decodes the first couple seconds of it, the audio
+// device must already be open so the output format is known
+static SDLInternalData* OpenMediaData(const std::string& fullAudioPath, const std::string& videoOutput) {
+    SDLInternalData* data = new SDLInternalData(sdlManager.getRate(), sdlManager.getBytesPerSample(), sdlManager.isSamplesFloat(), sdlManager.numChannels());
+
+    // Only audio goes in the PCM cache, skip it if video may be decoded.  Entries
+    // are only written for files without any video stream so an audio file
+    // with cover art is never played from the cache.
+    PCMFormat pcmFormat;
+    pcmFormat.rate = data->currentRate;
+    pcmFormat.bytesPerSample = data->bytesPerSample;
+    pcmFormat.channels = data->channels;
+    pcmFormat.isFloat = data->isSamplesFloat;
+    std::string ext;
+    std::size_t found = fullAudioPath.find_last_of(".");
+    if (found != std::string::npos) {
+        ext = toLowerCopy(fullAudioPath.substr(found + 1));
+    }
+    bool cacheable = (videoOutput == "--Disabled--" || videoOutput == "" || IsExtensionAudio(ext));
+    if (cacheable) {
+        data->pcmCache = PCMCache::INSTANCE.Open(fullAudioPath, pcmFormat);
+    }
+    if (data->pcmCache) {
+        // no demuxer, stream index is just a marker that there is audio
+        data->audio_stream_idx = 0;
+        data->duration = data->pcmCache->duration;
+        data->totalLen = (float)data->duration / AV_TIME_BASE;
+        data->totalDataLen = data->pcmCache->len;
+        data->stopped = 0;
+        data->maybeFillBuffer(true);
+        return data;
+    }
 
     // Initialize FFmpeg codecs
 #if LIBAVFORMAT_VERSION_MAJOR < 58
@@ -977,10 +1394,8 @@ SDLOutput::SDLOutput(const std::string& mediaFilename,
     int res = avformat_open_input(&data->formatContext, fullAudioPath.c_str(), nullptr, nullptr);
     if (avformat_find_stream_info(data->formatContext, nullptr) < 0) {
         LogErr(VB_MEDIAOUT, "Could not find suitable input stream!\n");
-        avformat_close_input(&data->formatContext);
-        data->formatContext = nullptr;
-        currentMediaFilename = "";
-        return;
+        delete data;
+        return nullptr;
     }
 
     if (open_codec_context(&data->audio_stream_idx, &data->audioCodecContext, data->formatContext, AVMEDIA_TYPE_AUDIO, fullAudioPath.c_str()) >= 0) {
@@ -1008,16 +1423,8 @@ SDLOutput::SDLOutput(const std::string& mediaFilename,
     //av_dump_format(data->formatContext, 0, fullAudioPath.c_str(), 0);
 
     int64_t duration = data->formatContext->duration + (data->formatContext->duration <= INT64_MAX - 5000 ? 5000 : 0);
-    int secs = duration / AV_TIME_BASE;
     int us = duration % AV_TIME_BASE;
-    int mins = secs / 60;
-    secs %= 60;
-
-    m_mediaOutputStatus->secondsTotal = secs;
-    m_mediaOutputStatus->minutesTotal = mins;
-
-    m_mediaOutputStatus->secondsRemaining = mins * 60 + secs;
-    m_mediaOutputStatus->subSecondsRemaining = 0;
+    data->duration = duration;
 
     if (data->audio_stream_idx != -1) {
         int64_t in_channel_layout = av_get_default_channel_layout(data->audioCodecContext->channels);
@@ -1027,11 +1434,13 @@ SDLOutput::SDLOutput(const std::string& mediaFilename,
         AVSampleFormat out_sample_fmt = (data->bytesPerSample == 2) ? AV_SAMPLE_FMT_S16 : (data->isSamplesFloat ? AV_SAMPLE_FMT_FLT : AV_SAMPLE_FMT_S32);
         int out_sample_rate = data->currentRate;
 
-        data->au_convert_ctx = swr_alloc_set_opts(nullptr,
-                                                  out_channel_layout, out_sample_fmt, out_sample_rate,
-                                                  in_channel_layout, data->audioCodecContext->sample_fmt,
-                                                  data->audioCodecContext->sample_rate, 0, nullptr);
-        swr_init(data->au_convert_ctx);
+        data->resamplerFormat.inLayout = in_channel_layout;
+        data->resamplerFormat.inFormat = data->audioCodecContext->sample_fmt;
+        data->resamplerFormat.inRate = data->audioCodecContext->sample_rate;
+        data->resamplerFormat.outLayout = out_channel_layout;
+        data->resamplerFormat.outFormat = out_sample_fmt;
+        data->resamplerFormat.outRate = out_sample_rate;
+        data->au_convert_ctx = resamplerCache.get(data->resamplerFormat);
 
         //get an estimate of the total length
         float d = duration / AV_TIME_BASE;
@@ -1059,7 +1468,10 @@ SDLOutput::SDLOutput(const std::string& mediaFilename,
         data->scaledFrame->height = videoOverlayHeight;
 
         data->scaledFrame->linesize[0] = data->scaledFrame->width * 3;
-        data->scaledFrame->data[0] = (uint8_t*)av_malloc(data->scaledFrame->width * data->scaledFrame->height * 3 * sizeof(uint8_t));
+        data->videoFrames.init(data->scaledFrame->width * data->scaledFrame->height * 3);
+        if (data->videoStream->avg_frame_rate.num) {
+            data->videoFrameMS = 1000 * data->videoStream->avg_frame_rate.den / data->videoStream->avg_frame_rate.num;
+        }
 
         data->swsCtx = sws_getContext(data->videoCodecContext->width,
                                       data->videoCodecContext->height,
@@ -1069,8 +1481,174 @@ SDLOutput::SDLOutput(const std::string& mediaFilename,
                                       nullptr, nullptr);
     }
 
+    if (cacheable && data->audio_stream_idx != -1 && data->video_stream_idx == -1 &&
+        av_find_best_stream(data->formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0) < 0) {
+        data->pcmWriter = PCMCache::INSTANCE.CreateWriter(fullAudioPath, pcmFormat, data->duration);
+    }
+
     data->stopped = 0;
     data->maybeFillBuffer(true);
+    return data;
+}
+
+
+void SDL::prerollThreadMain(std::string path, std::string videoOut) {
+    LogDebug(VB_MEDIAOUT, "Pre-rolling %s\n", path.c_str());
+    SDLInternalData* d = OpenMediaData(path, videoOut);
+
+    std::unique_lock<std::mutex> l(prerollLock);
+    if (prerollCancelled) {
+        LogDebug(VB_MEDIAOUT, "Pre-roll of %s cancelled\n", path.c_str());
+        delete d;
+        d = nullptr;
+        prerollCancelled = false;
+    }
+    if (prerollData) {
+        delete prerollData;
+    }
+    prerollData = d;
+    prerollPath = d ? path : "";
+    prerollVideoOut = videoOut;
+    prerolling = false;
+}
+
+void SDL::preroll(const std::string& path, const std::string& videoOut) {
+    std::unique_lock<std::mutex> l(prerollLock);
+    if (prerolling || (prerollData && prerollPath == path && prerollVideoOut == videoOut)) {
+        return;
+    }
+    if (prerollThread) {
+        // already finished, doesn't block
+        prerollThread->join();
+        delete prerollThread;
+    }
+    prerolling = true;
+    prerollingPath = path;
+    prerollingVideoOut = videoOut;
+    prerollThread = new std::thread(&SDL::prerollThreadMain, this, path, videoOut);
+}
+
+SDLInternalData* SDL::takePreroll(const std::string& path, const std::string& videoOut) {
+    std::unique_lock<std::mutex> l(prerollLock);
+    if (prerolling && (prerollingPath != path || prerollingVideoOut != videoOut)) {
+        // opening something we no longer need, don't wait for it
+        prerollCancelled = true;
+    } else if (prerollThread) {
+        // almost done opening the file we are about to need, wait for it
+        std::thread* t = prerollThread;
+        prerollThread = nullptr;
+        l.unlock();
+        t->join();
+        delete t;
+        l.lock();
+    }
+    SDLInternalData* d = prerollData;
+    prerollData = nullptr;
+    if (d && (prerollPath != path || prerollVideoOut != videoOut || d->currentRate != _initialisedRate ||
+              d->bytesPerSample != _bytesPerSample || d->isSamplesFloat != _isSampleFloat || d->channels != _channels)) {
+        // something else was pre-rolled or the device has changed format
+        delete d;
+        d = nullptr;
+    }
+    prerollPath = "";
+    return d;
+}
+
+void SDL::clearPreroll() {
+    std::unique_lock<std::mutex> l(prerollLock);
+    if (prerolling) {
+        // the thread releases what it opened, it is joined by the next
+        // preroll or the destructor
+        prerollCancelled = true;
+    } else if (prerollThread) {
+        prerollThread->join();
+        delete prerollThread;
+        prerollThread = nullptr;
+    }
+    if (prerollData) {
+        delete prerollData;
+        prerollData = nullptr;
+    }
+    prerollPath = "";
+}
+
+bool SDLOutput::PrerollMedia(const std::string& mediaFilename, const std::string& videoOutput) {
+    std::string fullAudioPath = GetMediaPath(mediaFilename);
+    if (fullAudioPath == "" ||
+        sdlManager.blacklisted.find(mediaFilename) != sdlManager.blacklisted.end() ||
+        sdlManager.blacklisted.find(fullAudioPath) != sdlManager.blacklisted.end()) {
+        return false;
+    }
+    if (!sdlManager.isDeviceOpen()) {
+        // format isn't known until the device is opened by the first media
+        return false;
+    }
+    sdlManager.preroll(fullAudioPath, videoOutput);
+    return true;
+}
+
+void SDLOutput::ClearPreroll() {
+    sdlManager.clearPreroll();
+}
+
+SDLOutput::SDLOutput(const std::string& mediaFilename,
+                     MediaOutputStatus* status,
+                     const std::string& videoOutput) {
+    LogDebug(VB_MEDIAOUT, "SDLOutput::SDLOutput(%s)\n",
+             mediaFilename.c_str());
+    data = nullptr;
+    m_mediaOutputStatus = status;
+    m_mediaOutputStatus->status = MEDIAOUTPUTSTATUS_IDLE;
+
+    m_mediaOutputStatus->mediaSeconds = 0.0;
+    m_mediaOutputStatus->secondsElapsed = 0;
+    m_mediaOutputStatus->subSecondsElapsed = 0;
+
+    if (sdlManager.blacklisted.find(mediaFilename) != sdlManager.blacklisted.end()) {
+        currentMediaFilename = "";
+        LogErr(VB_MEDIAOUT, "%s has been blacklisted!\n", mediaFilename.c_str());
+        return;
+    }
+    std::string fullAudioPath = GetMediaPath(mediaFilename);
+    if (fullAudioPath == "") {
+        LogErr(VB_MEDIAOUT, "%s does not exist!\n", mediaFilename.c_str());
+        currentMediaFilename = "";
+        return;
+    }
+    if (sdlManager.blacklisted.find(fullAudioPath) != sdlManager.blacklisted.end()) {
+        currentMediaFilename = "";
+        LogErr(VB_MEDIAOUT, "%s has been blacklisted!\n", mediaFilename.c_str());
+        return;
+    }
+    currentMediaFilename = mediaFilename;
+    m_mediaFilename = mediaFilename;
+
+    av_log_set_flags(AV_LOG_SKIP_REPEATED);
+    av_log_set_callback(LogCallback);
+
+    sdlManager.initSDL();
+    sdlManager.openAudio();
+
+    data = sdlManager.takePreroll(fullAudioPath, videoOutput);
+    if (data) {
+        LogDebug(VB_MEDIAOUT, "Using pre-rolled media for %s\n", mediaFilename.c_str());
+    } else {
+        data = OpenMediaData(fullAudioPath, videoOutput);
+    }
+    if (!data) {
+        currentMediaFilename = "";
+        return;
+    }
+
+    int secs = data->duration / AV_TIME_BASE;
+    int mins = secs / 60;
+    secs %= 60;
+
+    m_mediaOutputStatus->secondsTotal = secs;
+    m_mediaOutputStatus->minutesTotal = mins;
+
+    m_mediaOutputStatus->secondsRemaining = mins * 60 + secs;
+    m_mediaOutputStatus->subSecondsRemaining = 0;
 }
 
 /*
@@ -1124,7 +1702,9 @@ int SDLOutput::Start(int msTime) {
  *
  */
 static int ProcessCount = 0;
-static float lastCurTime = 0;
+static uint64_t lastPlayedBytes = 0;
+static uint32_t lastUnderruns = 0;
+static uint32_t lastVideoDropped = 0;
 
 int SDLOutput::Process(void) {
     if (!data) {
@@ -1132,18 +1712,11 @@ int SDLOutput::Process(void) {
     }
 
     if (data->audio_stream_idx != -1 && data->audioDev) {
-        //if we have an audio stream, that drives everything
-        data->curPosLock.lock();
-        float qas = SDL_GetQueuedAudioSize(data->audioDev);
-        long cp = data->curPos;
-        data->curPosLock.unlock();
-        float curtime = cp - qas;
-        curtime -= (DEFAULT_NUM_SAMPLES * data->channels);
-
-        if (curtime < 0)
-            curtime = 0;
-
-        if (lastCurTime == curtime) {
+        //if we have an audio stream, that drives everything.  The position
+        //comes from the sample clock so it is what is at the DAC right now
+        uint64_t played = data->getPlayedBytes(GetMonotonicTime());
+
+        if (lastPlayedBytes == played) {
             ProcessCount++;
             if (ProcessCount >= 50) {
                 LogWarn(VB_MEDIAOUT, "Audio has stalled   %d\n", data->doneRead);
@@ -1154,10 +1727,16 @@ int SDLOutput::Process(void) {
             AudioHasStalled = false;
             ProcessCount = 0;
         }
-        lastCurTime = curtime;
+        lastPlayedBytes = played;
+
+        uint32_t underruns = data->underruns;
+        if (underruns != lastUnderruns) {
+            LogDebug(VB_MEDIAOUT, "Audio ring underrun, %d total\n", underruns);
+            lastUnderruns = underruns;
+        }
 
-        curtime /= data->currentRate;                     //samples per sec
-        curtime /= data->channels * data->bytesPerSample; //bytes per sample * 2 channels
+        double curtime = data->clockOffset + played;
+        curtime /= data->bytesPerSecond;
 
         m_mediaOutputStatus->mediaSeconds = curtime;
 
@@ -1173,7 +1752,7 @@ int SDLOutput::Process(void) {
         ss *= 100;
         m_mediaOutputStatus->subSecondsRemaining = ss;
 
-        if (data->doneRead && SDL_GetQueuedAudioSize(data->audioDev) == 0) {
+        if (data->doneRead && data->outBufferPos == 0 && data->audioRing->queued() == 0) {
             m_mediaOutputStatus->status = MEDIAOUTPUTSTATUS_IDLE;
         }
     } else if (data->video_stream_idx != -1) {
@@ -1203,6 +1782,14 @@ int SDLOutput::Process(void) {
             m_mediaOutputStatus->status = MEDIAOUTPUTSTATUS_IDLE;
         }
     }
+    if (data->video_stream_idx != -1) {
+        uint32_t late = data->videoFramesLate;
+        uint32_t skipped = data->videoFramesSkipped;
+        if ((late + skipped) != lastVideoDropped) {
+            LogDebug(VB_MEDIAOUT, "Video frames dropped, %d decoded late, %d not displayed\n", late, skipped);
+            lastVideoDropped = late + skipped;
+        }
+    }
     if (multiSync->isMultiSyncEnabled()) {
         multiSync->SendMediaSyncPacket(m_mediaFilename,
                                        m_mediaOutputStatus->mediaSeconds);
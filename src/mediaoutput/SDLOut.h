@@ -30,6 +30,12 @@ public:
     static bool ProcessVideoOverlay(unsigned int msTimestamp);
     static bool GetAudioSamples(float *samples, int numSamples, int &sampleRate);
 
+    // Open and start decoding the media in the background so a following
+    // SDLOutput for the same file/video output can start without a gap
+    static bool PrerollMedia(const std::string& mediaFilename, const std::string& videoOutput);
+    // Release anything pre-rolled, cancelling a preroll still opening
+    static void ClearPreroll();
+
 private:
     SDLInternalData* data;
 };
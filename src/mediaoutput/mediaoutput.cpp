@@ -246,6 +246,33 @@ MediaOutputBase* CreateMediaOutput(const std::string& mediaFilename, const std::
     return nullptr;
 }
 
+void PrerollMediaOutput(const std::string& mediaFilename, const std::string& vOut) {
+    std::size_t found = mediaFilename.find_last_of(".");
+    if (found == std::string::npos) {
+        return;
+    }
+    std::string ext = toLowerCopy(mediaFilename.substr(found + 1));
+
+    // Must match the output CreateMediaOutput will pick for the file
+#ifdef HAS_VLC
+    if (IsExtensionAudio(ext)) {
+        if (getFPPmode() != REMOTE_MODE) {
+            SDLOutput::PrerollMedia(mediaFilename, "--Disabled--");
+        }
+        return;
+    } else if (IsExtensionVideo(ext) && (vOut == "--HDMI--" || vOut == "HDMI")) {
+        return;
+    } else if (IsExtensionVideo(ext))
+#endif
+    {
+        SDLOutput::PrerollMedia(mediaFilename, vOut);
+    }
+}
+
+void ClearPrerolledMediaOutput() {
+    SDLOutput::ClearPreroll();
+}
+
 static std::set<std::string> alreadyWarned;
 /*
  *
@@ -338,6 +365,46 @@ int OpenMediaOutput(const char* filename) {
     return 1;
 }
 
+// Enough of the file to cover the container headers and the first few
+// seconds of audio/video while the decoder is started
+#define MEDIA_PREFETCH_SIZE (4 * 1024 * 1024)
+
+void PrefetchMediaFile(const char* filename) {
+    LogDebug(VB_MEDIAOUT, "PrefetchMediaFile(%s)\n", filename);
+
+    std::string tmpFile(filename);
+    std::string ext;
+    std::string fullPath;
+    if (getFPPmode() == REMOTE_MODE) {
+        std::string videoFile = GetVideoFilenameForMedia(tmpFile, ext);
+        if (videoFile != "") {
+            fullPath = FPP_DIR_VIDEO("/" + videoFile);
+        }
+    }
+    if (fullPath == "" && HasAudioForMedia(tmpFile)) {
+        fullPath = tmpFile;
+    }
+    if (fullPath == "" && HasVideoForMedia(tmpFile)) {
+        fullPath = FPP_DIR_VIDEO("/" + tmpFile);
+    }
+
+    if (fullPath != "") {
+        int fd = open(fullPath.c_str(), O_RDONLY);
+        if (fd >= 0) {
+#ifndef PLATFORM_UNKNOWN
+            posix_fadvise(fd, 0, MEDIA_PREFETCH_SIZE, POSIX_FADV_WILLNEED);
+#endif
+            close(fd);
+        }
+
+        if (multiSync->isMultiSyncEnabled()) {
+            multiSync->SendMediaPreparePacket(filename);
+        }
+    } else {
+        LogDebug(VB_MEDIAOUT, "No media found to prefetch for %s\n", filename);
+    }
+}
+
 bool MatchesRunningMediaFilename(const char* filename) {
     if (mediaOutput) {
         std::string tmpFile = filename;
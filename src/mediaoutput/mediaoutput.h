@@ -25,11 +25,19 @@ void CleanupMediaOutput(void);
 
 bool MatchesRunningMediaFilename(const char* filename);
 int OpenMediaOutput(const char* filename);
+// Ask the kernel to start reading the start of the media file into the
+// page cache ahead of an upcoming OpenMediaOutput
+void PrefetchMediaFile(const char* filename);
 int StartMediaOutput(const char* filename);
 void UpdateMasterMediaPosition(const char* filename, float seconds);
 void CloseMediaOutput();
 
 MediaOutputBase* CreateMediaOutput(const std::string& mediaFilename, const std::string& videoOut);
+// Start opening/decoding the media in the background for an upcoming
+// CreateMediaOutput with the same arguments
+void PrerollMediaOutput(const std::string& mediaFilename, const std::string& videoOut);
+// Drop anything pre-rolled by PrerollMediaOutput that won't be played
+void ClearPrerolledMediaOutput();
 
 /* If try, filename will be updated with the media filename */
 bool HasVideoForMedia(std::string& filename);
@@ -16,6 +16,7 @@
 #include <dirent.h>
 
 #include <fcntl.h>
+#include <functional>
 
 #include <Magick++.h>
 
@@ -47,6 +48,81 @@ public:
     int value = 0;
 };
 
+class OverlayPlan {
+public:
+    std::vector<PixelOverlayModel*> models;    // all active, for buffer flushes
+    std::vector<PixelOverlayModel*> subs;      // composited into their parents first
+    std::vector<PixelOverlayModel*> composite; // bottom to top
+    std::vector<PixelOverlayModel*> culled;    // completely covered, nothing to draw
+    std::vector<OverlayRange> ranges;
+};
+
+// Runs a batch of effect updates across a few threads, the calling
+// thread works on the batch as well
+class EffectWorkerPool {
+public:
+    EffectWorkerPool(int n) {
+        for (int x = 0; x < n; x++) {
+            workers.push_back(std::thread(&EffectWorkerPool::workerMain, this));
+        }
+    }
+    ~EffectWorkerPool() {
+        std::unique_lock<std::mutex> l(lock);
+        stopping = true;
+        l.unlock();
+        cv.notify_all();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    void runAll(std::vector<std::function<void()>>& tasks) {
+        std::unique_lock<std::mutex> l(lock);
+        for (auto& t : tasks) {
+            queue.push_back(&t);
+        }
+        pending += tasks.size();
+        cv.notify_all();
+        while (pending) {
+            if (!queue.empty()) {
+                runOne(l);
+            } else {
+                doneCV.wait(l);
+            }
+        }
+    }
+
+private:
+    void runOne(std::unique_lock<std::mutex>& l) {
+        std::function<void()>* t = queue.front();
+        queue.pop_front();
+        l.unlock();
+        (*t)();
+        l.lock();
+        if (--pending == 0) {
+            doneCV.notify_all();
+        }
+    }
+    void workerMain() {
+        std::unique_lock<std::mutex> l(lock);
+        while (!stopping) {
+            if (queue.empty()) {
+                cv.wait(l);
+            } else {
+                runOne(l);
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::list<std::function<void()>*> queue;
+    size_t pending = 0;
+    bool stopping = false;
+    std::mutex lock;
+    std::condition_variable cv;
+    std::condition_variable doneCV;
+};
+
 uint32_t PixelOverlayManager::mapColor(const std::string& c) {
     if (c[0] == '#') {
         std::string color = "0x" + c.substr(1);
@@ -88,6 +164,11 @@ PixelOverlayManager::~PixelOverlayManager() {
         delete updateThread;
         updateThread = nullptr;
     }
+    if (workerPool) {
+        delete workerPool;
+        workerPool = nullptr;
+    }
+    clearActiveModels();
     for (auto a : models) {
         delete a.second;
     }
@@ -138,6 +219,11 @@ void PixelOverlayManager::loadModelMap() {
         delete updateThread;
         updateThread = nullptr;
     }
+    if (workerPool) {
+        delete workerPool;
+        workerPool = nullptr;
+    }
+    clearActiveModels();
     for (auto a : models) {
         delete a.second;
     }
@@ -256,60 +342,128 @@ bool PixelOverlayManager::hasActiveOverlays() {
 }
 
 void PixelOverlayManager::modelStateChanged(PixelOverlayModel* m, const PixelOverlayState& old, const PixelOverlayState& state) {
+    std::unique_lock<std::mutex> lock(activeModelsLock);
     if (old.getState() == 0) {
         //enabling, add
-        std::unique_lock<std::mutex> lock(activeModelsLock);
         activeModels.push_back(m);
         numActive++;
     } else if (state.getState() == 0) {
         //disabling, remove
-        std::unique_lock<std::mutex> lock(activeModelsLock);
         activeModels.remove(m);
         numActive--;
     }
+    // even switching between enabled states can change what is culled
+    rebuildPlan();
+    lock.unlock();
     if (numActive > 0) {
         StartChannelOutputThread();
     }
 }
 
+/*
+ * Drop all the models from the plan and wait for the output thread to
+ * finish with the old plan so the models can be deleted
+ */
+void PixelOverlayManager::clearActiveModels() {
+    std::unique_lock<std::mutex> lock(activeModelsLock);
+    numActive -= activeModels.size();
+    activeModels.clear();
+    std::shared_ptr<OverlayPlan> old = std::atomic_load(&overlayPlan);
+    rebuildPlan();
+    lock.unlock();
+
+    // doOverlays holds its own reference while it is using a plan
+    while (old && old.use_count() > 1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void PixelOverlayManager::rebuildPlan() {
+    std::shared_ptr<OverlayPlan> plan = std::make_shared<OverlayPlan>();
+    std::vector<PixelOverlayModel*> channelModels;
+    for (auto m : activeModels) {
+        plan->models.push_back(m);
+        if (m->getType() == "Sub") {
+            plan->subs.push_back(m);
+        } else {
+            channelModels.push_back(m);
+        }
+    }
+    for (auto& r : activeRanges) {
+        plan->ranges.push_back(r);
+    }
+
+    // A channel model is hidden if an opaque model drawn after it, or a
+    // range, covers all of its channels.  FB models don't draw into the
+    // channel data so they never hide or get hidden.
+    auto opaque = [](PixelOverlayModel* m) {
+        return m->getType() == "Channel" &&
+               m->getState().getState() == PixelOverlayState::Enabled &&
+               m->getOpacity() == 255;
+    };
+    for (size_t i = 0; i < channelModels.size(); i++) {
+        PixelOverlayModel* m = channelModels[i];
+        int start = m->getStartChannel();
+        int end = start + m->getChannelCount();
+        bool hidden = false;
+        if (m->getType() == "Channel") {
+            for (size_t j = i + 1; j < channelModels.size() && !hidden; j++) {
+                PixelOverlayModel* o = channelModels[j];
+                hidden = opaque(o) && o->getStartChannel() <= start &&
+                         (o->getStartChannel() + o->getChannelCount()) >= end;
+            }
+            for (auto& r : plan->ranges) {
+                hidden |= r.start <= start && (r.end + 1) >= end;
+            }
+        }
+        if (hidden) {
+            plan->culled.push_back(m);
+        } else {
+            plan->composite.push_back(m);
+        }
+    }
+    if (!plan->culled.empty()) {
+        LogDebug(VB_CHANNELOUT, "%d overlay models are completely covered and won't be drawn\n", (int)plan->culled.size());
+    }
+    std::atomic_store(&overlayPlan, plan);
+}
+
 void PixelOverlayManager::doOverlays(uint8_t* channels) {
     if (numActive == 0) {
         return;
     }
-    std::unique_lock<std::mutex> lock(activeModelsLock);
-    // First, flush any buffers
-    for (auto m : activeModels) {
-        if (m->overlayBufferIsDirty()) {
-            m->flushOverlayBuffer();
-        }
+    std::shared_ptr<OverlayPlan> plan = std::atomic_load(&overlayPlan);
+    if (!plan) {
+        return;
+    }
+    // First, swap in anything the effects finished drawing
+    for (auto m : plan->models) {
+        m->flushOverlayBufferIfIdle();
     }
     // Second, do any sub-models
-    for (auto m : activeModels) {
-        if (m->getType() == "Sub") {
-            m->doOverlay(channels);
-        }
+    for (auto m : plan->subs) {
+        m->doOverlay(channels);
     }
     // Then do any non-subs
-    for (auto m : activeModels) {
-        if (m->getType() != "Sub") {
-            m->doOverlay(channels);
-        }
+    for (auto m : plan->composite) {
+        m->doOverlay(channels);
+    }
+    for (auto m : plan->culled) {
+        m->setBufferIsDirty(false);
     }
 
-    for (auto& m : activeRanges) {
-        for (int s = m.start; s <= m.end; s++) {
-            channels[s] = m.value;
-        }
+    for (auto& m : plan->ranges) {
+        memset(&channels[m.start], m.value, m.end - m.start + 1);
     }
-    lock.unlock();
-    std::unique_lock<std::mutex> l(threadLock);
-    while (!afterOverlayModels.empty()) {
-        PixelOverlayModel* m = afterOverlayModels.front();
-        afterOverlayModels.pop_front();
-        l.unlock();
-        m->updateRunningEffects();
-        l.lock();
+    for (auto m : plan->models) {
+        m->signalOverlayFrame();
     }
+
+    // let the effects render the next frame
+    std::unique_lock<std::mutex> l(threadLock);
+    frameTick = true;
+    l.unlock();
+    threadCV.notify_all();
 }
 
 PixelOverlayModel* PixelOverlayManager::getModel(const std::string& name) {
@@ -454,6 +608,7 @@ HTTP_RESPONSE_CONST std::shared_ptr<httpserver::http_response> PixelOverlayManag
                 PixelOverlayModel* m = models[mn];
                 m->toJson(model);
                 model["isActive"] = (int)m->getState().getState();
+                model["opacity"] = m->getOpacity();
                 if (m->getRunningEffect()) {
                     model["effectName"] = m->getRunningEffect()->name();
                     model["isLocked"] = true;
@@ -486,6 +641,7 @@ HTTP_RESPONSE_CONST std::shared_ptr<httpserver::http_response> PixelOverlayManag
                 } else {
                     m->toJson(result);
                     result["isActive"] = (int)m->getState().getState();
+                    result["opacity"] = m->getOpacity();
                     if (m->getRunningEffect()) {
                         result["effectName"] = m->getRunningEffect()->name();
                         result["isLocked"] = true;
@@ -565,8 +721,15 @@ HTTP_RESPONSE_CONST std::shared_ptr<httpserver::http_response> PixelOverlayManag
                 if (p4 == "state") {
                     Json::Value root;
                     if (LoadJsonFromString(std::string(req.get_content()), root)) {
-                        if (root.isMember("State")) {
-                            m->setState(PixelOverlayState(root["State"].asInt()));
+                        if (root.isMember("State") || root.isMember("Opacity")) {
+                            if (root.isMember("Opacity")) {
+                                m->setOpacity(std::clamp(root["Opacity"].asInt(), 0, 255));
+                            }
+                            if (root["State"].isString()) {
+                                m->setState(PixelOverlayState(root["State"].asString()));
+                            } else if (root.isMember("State")) {
+                                m->setState(PixelOverlayState(root["State"].asInt()));
+                            }
                             return std::shared_ptr<httpserver::http_response>(new httpserver::string_response("{ \"Status\": \"OK\", \"Message\": \"\"}", 200));
                         } else {
                             return std::shared_ptr<httpserver::http_response>(new httpserver::string_response("Invalid request " + std::string(req.get_content()), 500));
@@ -674,6 +837,7 @@ HTTP_RESPONSE_CONST std::shared_ptr<httpserver::http_response> PixelOverlayManag
                         int sz = activeRanges.size();
                         activeRanges.clear();
                         numActive -= sz;
+                        rebuildPlan();
                         lock.unlock();
                         if (numActive == 0) {
                             numActive++;
@@ -725,6 +889,7 @@ HTTP_RESPONSE_CONST std::shared_ptr<httpserver::http_response> PixelOverlayManag
                         activeRanges.push_back(OverlayRange(start, end, val));
                         numActive++;
                     }
+                    rebuildPlan();
                 }
                 //skip the ','
                 if (p3.size()) {
@@ -759,12 +924,13 @@ public:
     EnableOverlayCommand(PixelOverlayManager* m) :
         OverlayCommand("Overlay Model State", m) {
         args.push_back(CommandArg("Model", "multistring", "Model").setContentListUrl("api/models?simple=true", false));
-        args.push_back(CommandArg("State", "string", "State").setContentList({ "Disabled", "Enabled", "Transparent", "TransparentRGB" }));
+        args.push_back(CommandArg("State", "string", "State").setContentList({ "Disabled", "Enabled", "Transparent", "TransparentRGB", "Alpha", "Add", "Max", "Multiply" }));
+        args.push_back(CommandArg("Opacity", "int", "Opacity").setRange(0, 255).setDefaultValue("255"));
     }
 
     virtual std::unique_ptr<Command::Result> run(const std::vector<std::string>& args) override {
-        if (args.size() != 2) {
-            return std::make_unique<Command::ErrorResult>("Command needs 2 arguments, found " + std::to_string(args.size()));
+        if (args.size() != 2 && args.size() != 3) {
+            return std::make_unique<Command::ErrorResult>("Command needs 2 or 3 arguments, found " + std::to_string(args.size()));
         }
         std::unique_lock<std::mutex> lock(getLock());
         std::list<PixelOverlayModel*> models;
@@ -777,6 +943,9 @@ public:
             }
         }
         for (auto m : models) {
+            if (args.size() > 2) {
+                m->setOpacity(std::clamp(std::atoi(args[2].c_str()), 0, 255));
+            }
             m->setState(PixelOverlayState(args[1]));
         }
         return std::make_unique<Command::Result>("Model State Set");
@@ -814,7 +983,7 @@ public:
     FillOverlayCommand(PixelOverlayManager* m) :
         OverlayCommand("Overlay Model Fill", m) {
         args.push_back(CommandArg("Model", "multistring", "Model").setContentListUrl("api/models?simple=true", false));
-        args.push_back(CommandArg("State", "string", "State").setContentList({ "Don't Set", "Enabled", "Transparent", "TransparentRGB" }));
+        args.push_back(CommandArg("State", "string", "State").setContentList({ "Don't Set", "Enabled", "Transparent", "TransparentRGB", "Alpha", "Add", "Max", "Multiply" }));
         args.push_back(CommandArg("Color", "color", "Color").setDefaultValue("#FF0000"));
     }
 
@@ -903,7 +1072,7 @@ public:
     ApplyEffectOverlayCommand(PixelOverlayManager* m) :
         OverlayCommand("Overlay Model Effect", m) {
         args.push_back(CommandArg("Models", "multistring", "Models").setContentListUrl("api/models?simple=true", false));
-        args.push_back(CommandArg("AutoEnable", "string", "Auto Enable/Disable").setContentList({ "False", "Enabled", "Transparent", "Transparent RGB" }).setDefaultValue("Enabled"));
+        args.push_back(CommandArg("AutoEnable", "string", "Auto Enable/Disable").setContentList({ "False", "Enabled", "Transparent", "Transparent RGB", "Alpha", "Add", "Max", "Multiply" }).setDefaultValue("Enabled"));
         args.push_back(CommandArg("Effect", "subcommand", "Effect").setContentListUrl("api/overlays/effects/", false));
     }
 
@@ -965,42 +1134,86 @@ void PixelOverlayManager::addAutoOverlayModel(const std::string& name,
 void PixelOverlayManager::doOverlayModelEffects() {
     std::unique_lock<std::mutex> l(threadLock);
     while (threadKeepRunning) {
-        uint32_t waitTime = 1000;
-        if (!updates.empty()) {
-            uint64_t curTime = GetTimeMS();
-            while (!updates.empty() && updates.begin()->first <= curTime) {
-                std::list<PixelOverlayModel*> models = updates.begin()->second;
-                uint64_t startTime = updates.begin()->first;
-                updates.erase(updates.begin());
-                l.unlock();
-
-                for (auto m : models) {
-                    int32_t ms = m->updateRunningEffects();
-                    if (ms != 0) {
-                        l.lock();
-                        if (ms > 0) {
-                            uint64_t t = startTime + ms;
-                            updates[t].push_back(m);
-                        } else {
-                            afterOverlayModels.push_back(m);
-                        }
-                        l.unlock();
-                    }
+        uint64_t curTime = GetTimeMS();
+        float fps = GetChannelOutputRefreshRate();
+        uint64_t framePeriod = fps > 0 ? (uint64_t)(1000.0f / fps) : 25;
+
+        // On a frame tick, render everything due before the next frame so
+        // it is ready to be swapped in when that frame starts
+        bool ticked = frameTick;
+        frameTick = false;
+        uint64_t horizon = curTime;
+        std::vector<std::pair<PixelOverlayModel*, uint64_t>> due;
+        if (ticked) {
+            lastFrameTick = curTime;
+            horizon += framePeriod;
+            for (auto m : afterOverlayModels) {
+                due.push_back({ m, curTime });
+            }
+            afterOverlayModels.clear();
+        }
+        while (!updates.empty() && updates.begin()->first <= horizon) {
+            for (auto m : updates.begin()->second) {
+                due.push_back({ m, updates.begin()->first });
+            }
+            updates.erase(updates.begin());
+        }
+
+        if (!due.empty()) {
+            std::vector<int32_t> results(due.size());
+            std::vector<std::function<void()>> tasks;
+            std::vector<size_t> serial;
+            for (size_t x = 0; x < due.size(); x++) {
+                if (due[x].first->runningEffectCanRunInParallel()) {
+                    tasks.push_back([&due, &results, x]() {
+                        results[x] = due[x].first->updateRunningEffects();
+                    });
+                } else {
+                    serial.push_back(x);
                 }
-                l.lock();
-                curTime = GetTimeMS();
             }
-            if (!updates.empty()) {
-                waitTime = updates.begin()->first - curTime;
+            if (!serial.empty()) {
+                tasks.push_back([&due, &results, &serial]() {
+                    for (auto x : serial) {
+                        results[x] = due[x].first->updateRunningEffects();
+                    }
+                });
+            }
+            l.unlock();
+            if (tasks.size() == 1) {
+                tasks[0]();
+            } else {
+                workerPool->runAll(tasks);
+            }
+            l.lock();
+            for (size_t x = 0; x < due.size(); x++) {
+                if (results[x] > 0) {
+                    updates[due[x].second + results[x]].push_back(due[x].first);
+                } else if (results[x] < 0) {
+                    afterOverlayModels.push_back(due[x].first);
+                }
             }
+            continue;
+        }
+
+        uint64_t waitTime = 1000;
+        if (!updates.empty()) {
+            waitTime = updates.begin()->first > curTime ? updates.begin()->first - curTime : 0;
+        }
+        if ((curTime - lastFrameTick) < 250) {
+            // frames are being output, wait for the next one so updates
+            // stay in step with the output
+            waitTime = framePeriod * 2;
+        }
+        if (!frameTick) {
+            threadCV.wait_for(l, std::chrono::milliseconds(std::min(waitTime, (uint64_t)1000)));
         }
-        threadCV.wait_for(l, std::chrono::milliseconds(waitTime));
     }
 }
 void PixelOverlayManager::removePeriodicUpdate(PixelOverlayModel* m) {
     std::unique_lock<std::mutex> l(threadLock);
     for (auto& a : updates) {
-        updates.begin()->second.remove(m);
+        a.second.remove(m);
     }
     afterOverlayModels.remove(m);
 }
@@ -1008,6 +1221,8 @@ void PixelOverlayManager::removePeriodicUpdate(PixelOverlayModel* m) {
 void PixelOverlayManager::addPeriodicUpdate(int32_t initialDelayMS, PixelOverlayModel* m) {
     std::unique_lock<std::mutex> l(threadLock);
     if (updateThread == nullptr) {
+        int workers = std::clamp((int)std::thread::hardware_concurrency() - 1, 1, 4);
+        workerPool = new EffectWorkerPool(workers);
         threadKeepRunning = true;
         updateThread = new std::thread(&PixelOverlayManager::doOverlayModelEffects, this);
     }
@@ -16,6 +16,7 @@
 #include <httpserver.hpp>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -23,6 +24,8 @@
 class PixelOverlayState;
 class PixelOverlayModel;
 class OverlayRange;
+class OverlayPlan;
+class EffectWorkerPool;
 
 class PixelOverlayManager : public httpserver::http_resource {
 public:
@@ -72,6 +75,12 @@ private:
     std::list<OverlayRange> activeRanges;
     std::mutex activeModelsLock;
 
+    // What doOverlays does each frame, rebuilt (with activeModelsLock held)
+    // whenever the active models, their states or the ranges change
+    void rebuildPlan();
+    void clearActiveModels();
+    std::shared_ptr<OverlayPlan> overlayPlan;
+
     std::map<std::string, PixelOverlayModel*> models;
     std::list<std::string> modelNames;
     std::map<std::string, std::string> fonts;
@@ -85,6 +94,10 @@ private:
     std::condition_variable threadCV;
     std::map<uint64_t, std::list<PixelOverlayModel*>> updates;
     std::list<PixelOverlayModel*> afterOverlayModels;
+    // set by the output thread after each frame is composited
+    bool frameTick = false;
+    uint64_t lastFrameTick = 0;
+    EffectWorkerPool* workerPool = nullptr;
 
     void loadFonts();
 
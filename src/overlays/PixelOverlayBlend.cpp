@@ -0,0 +1,211 @@
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include "fpp-pch.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define OVERLAY_BLEND_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define OVERLAY_BLEND_SSE2
+#endif
+
+#include "PixelOverlayBlend.h"
+
+// x / 255 rounded, exact for x <= 255 * 255
+static inline uint32_t div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+#if defined(OVERLAY_BLEND_NEON)
+static inline uint8x8_t div255(uint16x8_t x) {
+    return vraddhn_u16(x, vrshrq_n_u16(x, 8));
+}
+static inline uint8x16_t scale(uint8x16_t s, uint8x8_t a) {
+    return vcombine_u8(div255(vmull_u8(vget_low_u8(s), a)),
+                       div255(vmull_u8(vget_high_u8(s), a)));
+}
+#elif defined(OVERLAY_BLEND_SSE2)
+static inline __m128i div255(__m128i x) {
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+// byte * a / 255 for the 16 bytes of s
+static inline __m128i scale(__m128i s, __m128i a) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i lo = div255(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), a));
+    __m128i hi = div255(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), a));
+    return _mm_packus_epi16(lo, hi);
+}
+#endif
+
+void OverlayBlendTransparent(uint8_t* dst, const uint8_t* src, int len) {
+    int i = 0;
+#if defined(OVERLAY_BLEND_NEON)
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t s = vld1q_u8(src + i);
+        uint8x16_t d = vld1q_u8(dst + i);
+        vst1q_u8(dst + i, vbslq_u8(vceqq_u8(s, vdupq_n_u8(0)), d, s));
+    }
+#elif defined(OVERLAY_BLEND_SSE2)
+    __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i m = _mm_cmpeq_epi8(s, zero);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_and_si128(m, d), _mm_andnot_si128(m, s)));
+    }
+#endif
+    for (; i < len; i++) {
+        if (src[i]) {
+            dst[i] = src[i];
+        }
+    }
+}
+
+void OverlayBlendTransparentRGB(uint8_t* dst, const uint8_t* src, int len) {
+    for (int i = 0; i + 3 <= len; i += 3) {
+        if (src[i] | src[i + 1] | src[i + 2]) {
+            dst[i] = src[i];
+            dst[i + 1] = src[i + 1];
+            dst[i + 2] = src[i + 2];
+        }
+    }
+}
+
+void OverlayBlendAlpha(uint8_t* dst, const uint8_t* src, int len, uint8_t opacity) {
+    if (opacity == 255) {
+        memcpy(dst, src, len);
+        return;
+    }
+    uint32_t a = opacity;
+    uint32_t na = 255 - opacity;
+    int i = 0;
+#if defined(OVERLAY_BLEND_NEON)
+    uint8x8_t va = vdup_n_u8(a);
+    uint8x8_t vna = vdup_n_u8(na);
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t s = vld1q_u8(src + i);
+        uint8x16_t d = vld1q_u8(dst + i);
+        uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(s), va), vget_low_u8(d), vna);
+        uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(s), va), vget_high_u8(d), vna);
+        vst1q_u8(dst + i, vcombine_u8(div255(lo), div255(hi)));
+    }
+#elif defined(OVERLAY_BLEND_SSE2)
+    __m128i zero = _mm_setzero_si128();
+    __m128i va = _mm_set1_epi16(a);
+    __m128i vna = _mm_set1_epi16(na);
+    for (; i + 16 <= len; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), va),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), vna));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), va),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), vna));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(div255(lo), div255(hi)));
+    }
+#endif
+    for (; i < len; i++) {
+        dst[i] = div255(src[i] * a + dst[i] * na);
+    }
+}
+
+void OverlayBlendAdd(uint8_t* dst, const uint8_t* src, int len, uint8_t opacity) {
+    uint32_t a = opacity;
+    int i = 0;
+#if defined(OVERLAY_BLEND_NEON)
+    uint8x8_t va = vdup_n_u8(a);
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t s = vld1q_u8(src + i);
+        if (a != 255) {
+            s = scale(s, va);
+        }
+        vst1q_u8(dst + i, vqaddq_u8(vld1q_u8(dst + i), s));
+    }
+#elif defined(OVERLAY_BLEND_SSE2)
+    __m128i va = _mm_set1_epi16(a);
+    for (; i + 16 <= len; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        if (a != 255) {
+            s = scale(s, va);
+        }
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_adds_epu8(_mm_loadu_si128((const __m128i*)(dst + i)), s));
+    }
+#endif
+    for (; i < len; i++) {
+        uint32_t v = dst[i] + div255(src[i] * a);
+        dst[i] = v > 255 ? 255 : v;
+    }
+}
+
+void OverlayBlendMax(uint8_t* dst, const uint8_t* src, int len, uint8_t opacity) {
+    uint32_t a = opacity;
+    int i = 0;
+#if defined(OVERLAY_BLEND_NEON)
+    uint8x8_t va = vdup_n_u8(a);
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t s = vld1q_u8(src + i);
+        if (a != 255) {
+            s = scale(s, va);
+        }
+        vst1q_u8(dst + i, vmaxq_u8(vld1q_u8(dst + i), s));
+    }
+#elif defined(OVERLAY_BLEND_SSE2)
+    __m128i va = _mm_set1_epi16(a);
+    for (; i + 16 <= len; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        if (a != 255) {
+            s = scale(s, va);
+        }
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_max_epu8(_mm_loadu_si128((const __m128i*)(dst + i)), s));
+    }
+#endif
+    for (; i < len; i++) {
+        uint32_t v = div255(src[i] * a);
+        if (v > dst[i]) {
+            dst[i] = v;
+        }
+    }
+}
+
+void OverlayBlendMultiply(uint8_t* dst, const uint8_t* src, int len, uint8_t opacity) {
+    uint32_t a = opacity;
+    uint32_t na = 255 - opacity;
+    int i = 0;
+#if defined(OVERLAY_BLEND_NEON)
+    uint8x8_t va = vdup_n_u8(a);
+    uint8x16_t vna = vdupq_n_u8(na);
+    for (; i + 16 <= len; i += 16) {
+        // factor never exceeds 255 so the add can't wrap
+        uint8x16_t f = vaddq_u8(scale(vld1q_u8(src + i), va), vna);
+        uint8x16_t d = vld1q_u8(dst + i);
+        vst1q_u8(dst + i, vcombine_u8(div255(vmull_u8(vget_low_u8(d), vget_low_u8(f))),
+                                      div255(vmull_u8(vget_high_u8(d), vget_high_u8(f)))));
+    }
+#elif defined(OVERLAY_BLEND_SSE2)
+    __m128i zero = _mm_setzero_si128();
+    __m128i va = _mm_set1_epi16(a);
+    __m128i vna = _mm_set1_epi8((char)na);
+    for (; i + 16 <= len; i += 16) {
+        __m128i f = _mm_add_epi8(scale(_mm_loadu_si128((const __m128i*)(src + i)), va), vna);
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i lo = div255(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(f, zero)));
+        __m128i hi = div255(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(f, zero)));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < len; i++) {
+        dst[i] = div255(dst[i] * (div255(src[i] * a) + na));
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include <stdint.h>
+
+/*
+ * Blend kernels used to composite overlay models onto the channel data.
+ * Each combines len bytes of src into dst, opacity (0-255) scales the
+ * contribution of src.  NEON or SSE2 is used when the compiler targets
+ * it with a scalar loop for the remainder.
+ */
+
+// dst = src where src is non-zero
+void OverlayBlendTransparent(uint8_t* dst, const uint8_t* src, int len);
+
+// dst = src for any RGB triplet that is non-zero, len is in channels
+void OverlayBlendTransparentRGB(uint8_t* dst, const uint8_t* src, int len);
+
+// dst = dst + (src - dst) * opacity
+void OverlayBlendAlpha(uint8_t* dst, const uint8_t* src, int len, uint8_t opacity);
+
+// dst = min(dst + src * opacity, 255)
+void OverlayBlendAdd(uint8_t* dst, const uint8_t* src, int len, uint8_t opacity);
+
+// dst = max(dst, src * opacity)
+void OverlayBlendMax(uint8_t* dst, const uint8_t* src, int len, uint8_t opacity);
+
+// dst = dst * (src * opacity + (1 - opacity))
+void OverlayBlendMultiply(uint8_t* dst, const uint8_t* src, int len, uint8_t opacity);
@@ -0,0 +1,144 @@
+#pragma once
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+/*
+ * Layout of a model's shared memory overlay buffer
+ * (/FPP-Model-Overlay-Buffer-<model> or /FPPMB-<model>)
+ *
+ * The buffer starts with the original 12 byte header followed by the
+ * width*height*3 RGB overlay buffer.  Writing the RGB data and setting
+ * OVERLAY_BUFFER_DIRTY in flags still works as before, but fppd may be
+ * copying the data out while it is being written.
+ *
+ * When OVERLAY_BUFFER_SLOTS is set in flags, an OverlayBufferSlots header
+ * follows at OverlayBufferSlotsOffset() with three more width*height*3
+ * frames after it, used as a triple buffer.  A single producer draws a
+ * full frame into OverlayBufferWriteSlot() and calls OverlayBufferPublish()
+ * which swaps it with the published frame in one atomic exchange, so
+ * neither side ever touches a frame the other is using.  At the start of
+ * each output frame fppd takes the newest published frame, after the
+ * frame is output frameCounter is incremented and waiters are woken so
+ * producers can use OverlayBufferWaitFrame() to render in step with the
+ * output.
+ */
+
+#define OVERLAY_BUFFER_DIRTY 0x1
+#define OVERLAY_BUFFER_SLOTS 0x2
+
+#define OVERLAY_BUFFER_MAGIC 0x5646504F // "OPFV"
+#define OVERLAY_BUFFER_VERSION 1
+#define OVERLAY_BUFFER_SLOT_COUNT 3
+// set in OverlayBufferSlots::published until fppd takes the frame
+#define OVERLAY_SLOT_NEW 0x80000000
+
+struct OverlayBufferData {
+    uint32_t width;
+    uint32_t height;
+    uint32_t flags;
+    uint8_t data[4];
+} __attribute__((__packed__));
+
+struct OverlayBufferSlots {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotSize;                  // width * height * 3
+    std::atomic<uint32_t> published;    // slot index | OVERLAY_SLOT_NEW
+    std::atomic<uint32_t> frameCounter; // incremented every output frame, futex word
+    std::atomic<uint32_t> waiters;      // producers waiting on frameCounter
+    uint32_t writeSlot;                 // owned by the producer
+    uint32_t readSlot;                  // owned by fppd
+    uint32_t frameInterval;             // output frame interval in microseconds
+    uint32_t reserved[6];
+};
+static_assert(sizeof(OverlayBufferSlots) == 64, "OverlayBufferSlots is part of the shared memory layout");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain uint32_t");
+
+inline size_t OverlayBufferSlotsOffset(uint32_t width, uint32_t height) {
+    return (offsetof(OverlayBufferData, data) + (size_t)width * height * 3 + 63) & ~(size_t)63;
+}
+inline size_t OverlayBufferSize(uint32_t width, uint32_t height) {
+    return OverlayBufferSlotsOffset(width, height) + sizeof(OverlayBufferSlots) + (size_t)width * height * 3 * OVERLAY_BUFFER_SLOT_COUNT;
+}
+
+// Returns nullptr if the buffer was created by an fppd without slots
+inline OverlayBufferSlots* OverlayBufferGetSlots(OverlayBufferData* b, size_t mappedSize) {
+    if (!(b->flags & OVERLAY_BUFFER_SLOTS) || mappedSize < OverlayBufferSize(b->width, b->height)) {
+        return nullptr;
+    }
+    OverlayBufferSlots* s = (OverlayBufferSlots*)((uint8_t*)b + OverlayBufferSlotsOffset(b->width, b->height));
+    if (s->magic != OVERLAY_BUFFER_MAGIC || s->version < OVERLAY_BUFFER_VERSION) {
+        return nullptr;
+    }
+    return s;
+}
+inline uint8_t* OverlayBufferSlotData(OverlayBufferSlots* s, uint32_t slot) {
+    return (uint8_t*)(s + 1) + (size_t)slot * s->slotSize;
+}
+
+// Producer side
+inline uint8_t* OverlayBufferWriteSlot(OverlayBufferSlots* s) {
+    return OverlayBufferSlotData(s, s->writeSlot);
+}
+inline void OverlayBufferPublish(OverlayBufferSlots* s) {
+    uint32_t old = s->published.exchange(s->writeSlot | OVERLAY_SLOT_NEW, std::memory_order_acq_rel);
+    s->writeSlot = old & ~OVERLAY_SLOT_NEW;
+}
+// Waits until the frame counter moves past last or timeoutMS passes and
+// returns the current counter
+inline uint32_t OverlayBufferWaitFrame(OverlayBufferSlots* s, uint32_t last, int timeoutMS) {
+    uint32_t cur = s->frameCounter.load();
+    if (cur != last) {
+        return cur;
+    }
+#ifdef __linux__
+    s->waiters.fetch_add(1);
+    struct timespec ts = { timeoutMS / 1000, (timeoutMS % 1000) * 1000000L };
+    syscall(SYS_futex, (uint32_t*)&s->frameCounter, FUTEX_WAIT, last, &ts, nullptr, 0);
+    s->waiters.fetch_sub(1);
+#else
+    for (int x = 0; x < timeoutMS && s->frameCounter.load() == last; x++) {
+        usleep(1000);
+    }
+#endif
+    return s->frameCounter.load();
+}
+
+// fppd side
+inline uint8_t* OverlayBufferTakeSlot(OverlayBufferSlots* s) {
+    if (!(s->published.load(std::memory_order_relaxed) & OVERLAY_SLOT_NEW)) {
+        return nullptr;
+    }
+    uint32_t old = s->published.exchange(s->readSlot, std::memory_order_acq_rel);
+    s->readSlot = old & ~OVERLAY_SLOT_NEW;
+    return OverlayBufferSlotData(s, s->readSlot);
+}
+inline void OverlayBufferSignalFrame(OverlayBufferSlots* s) {
+    s->frameCounter.fetch_add(1);
+#ifdef __linux__
+    if (s->waiters.load()) {
+        syscall(SYS_futex, (uint32_t*)&s->frameCounter, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+    }
+#endif
+}
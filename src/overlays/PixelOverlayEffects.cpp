@@ -35,6 +35,7 @@
 
 #include "PixelOverlay.h"
 #include "PixelOverlayModel.h"
+#include "TextRenderer.h"
 #include "WLEDEffects.h"
 
 #include "PixelOverlayEffects.h"
@@ -129,7 +130,8 @@ public:
         }
 
         void fill(uint32_t c) {
-            model->fill((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF);
+            model->fillOverlayBuffer((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF);
+            model->flushOverlayBuffer();
         }
         virtual int32_t update() override {
             long long nowTime = GetTimeMS();
@@ -297,9 +299,10 @@ public:
                 for (int l = 0; l < len; l++) {
                     int x, y;
                     mapCoords(m, l, w, h, x, y);
-                    model->setPixelValue(x, y, r, g, b);
+                    model->setOverlayPixelValue(x, y, r, g, b);
                 }
             }
+            model->flushOverlayBuffer();
         }
         virtual int32_t update() override {
             long long nowTime = GetTimeMS();
@@ -366,7 +369,12 @@ public:
     }
     void copyImageData(int xoff, int yoff) {
         if (imageData) {
-            model->clearOverlayBuffer();
+            if (lastW < 0) {
+                model->clearOverlayBuffer();
+            } else {
+                // only erase where the image was last time
+                model->clearOverlayBuffer(lastX, lastY, lastW, lastH);
+            }
             int h, w;
             model->getSize(w, h);
             for (int y = 0; y < imageDataRows; ++y) {
@@ -397,6 +405,11 @@ public:
                 if (pixelsToCopy > 0)
                     memcpy(dst, src, pixelsToCopy * 3);
             }
+            lastX = std::max(xoff, 0);
+            lastY = std::max(yoff, 0);
+            lastW = std::max(std::min(xoff + imageDataCols, w) - lastX, 0);
+            lastH = std::max(std::min(yoff + imageDataRows, h) - lastY, 0);
+            model->markOverlayBufferDirty(lastX, lastY, lastW, lastH);
             model->flushOverlayBuffer();
         }
     }
@@ -444,6 +457,12 @@ public:
     int imageDataRows = 0;
     int imageDataCols = 0;
 
+    // area of the overlay buffer covered by the last copyImageData
+    int lastX = 0;
+    int lastY = 0;
+    int lastW = -1;
+    int lastH = -1;
+
     std::string direction;
     int x = 0;
     int y = 0;
@@ -512,6 +531,85 @@ public:
             disableWhenDone = true;
         }
 
+        bool center = (position == "Centered" || position == "Center");
+        int maxWid = 0;
+        int totalHi = 0;
+        int ascent = 0;
+        int cols = m->getWidth();
+        int rows = m->getHeight();
+        uint8_t* newData = nullptr;
+
+        if (TextRenderer::INSTANCE.Measure(font, fontSize, antialias, msg, maxWid, totalHi, ascent)) {
+            if (!center) {
+                cols = maxWid;
+                rows = totalHi;
+            }
+            newData = (uint8_t*)calloc(std::max(cols * rows * 3, 1), 1);
+            TextRenderer::INSTANCE.Render(font, fontSize, antialias, msg, r, g, b, newData, cols, rows);
+        } else {
+            newData = doMagickText(m, msg, r, g, b, font, fontSize, antialias, center, cols, rows, ascent);
+        }
+
+        if (center) {
+            //one shot, just draw the text and return
+            m->setData(newData);
+            free(newData);
+
+            if (disableWhenDone) {
+                int nd = 25;
+                if (duration > 0) {
+                    nd = duration * 1000;
+                }
+                m->setRunningEffect(new StopRunningEffect(m, "Text", disableWhenDone), nd);
+            }
+        } else {
+            //movement
+            double y = (m->getHeight() / 2.0) - ((rows) / 2.0);
+            double x = (m->getWidth() / 2.0) - (cols / 2.0);
+            if (position == "R2L") {
+                x = m->getWidth();
+            } else if (position == "L2R") {
+                x = -cols;
+            } else if (position == "B2T") {
+                y = m->getHeight();
+            } else if (position == "T2B") {
+                y = -ascent;
+            }
+
+            TextMovementEffect* ef = dynamic_cast<TextMovementEffect*>(m->getRunningEffect());
+            if (ef == nullptr) {
+                ef = new TextMovementEffect(m);
+                ef->x = (int)x;
+                ef->y = (int)y;
+            }
+            ef->speed = pixelsPerSecond;
+            ef->disableWhenDone = disableWhenDone;
+            ef->direction = position;
+            int32_t t = 1000 / pixelsPerSecond;
+            if (t == 0) {
+                t = 1;
+            }
+            uint8_t* old = ef->imageData;
+            ef->imageData = newData;
+            ef->imageDataCols = cols;
+            ef->imageDataRows = rows;
+            ef->copyImageData(ef->x, ef->y);
+            m->setRunningEffect(ef, t);
+            free(old);
+        }
+    }
+
+    // ImageMagick fallback for fonts the native renderer can't load.  For
+    // centered text the result is the size of the model, otherwise it is
+    // the size of the text and cols/rows are updated.
+    uint8_t* doMagickText(PixelOverlayModel* m,
+                          const std::string& msg,
+                          int r, int g, int b,
+                          const std::string& font,
+                          int fontSize,
+                          bool antialias,
+                          bool center,
+                          int& cols, int& rows, int& ascent) {
         Magick::Image* image = new Magick::Image(Magick::Geometry(m->getWidth(), m->getHeight()), Magick::Color("black"));
         image->quiet(true);
         image->depth(8);
@@ -527,7 +625,7 @@ public:
         for (int x = 0; x < msg.length(); x++) {
             if (msg[x] == '\n' || ((x < msg.length() - 1) && msg[x] == '\\' && msg[x + 1] == 'n')) {
                 lines++;
-                std::string newM = msg.substr(last, x);
+                std::string newM = msg.substr(last, x - last);
                 Magick::TypeMetric metrics;
                 image->fontTypeMetrics(newM, &metrics);
                 maxWid = std::max(maxWid, (int)metrics.textWidth());
@@ -544,17 +642,17 @@ public:
         image->fontTypeMetrics(newM, &metrics);
         maxWid = std::max(maxWid, (int)metrics.textWidth());
         totalHi += (int)metrics.textHeight();
+        ascent = metrics.ascent();
 
-        if (position == "Centered" || position == "Center") {
-            image->magick("RGB");
-            //one shot, just draw the text and return
-            double rr = r;
-            double rg = g;
-            double rb = b;
-            rr /= 255.0f;
-            rg /= 255.0f;
-            rb /= 255.0f;
+        double rr = r;
+        double rg = g;
+        double rb = b;
+        rr /= 255.0f;
+        rg /= 255.0f;
+        rb /= 255.0f;
 
+        if (center) {
+            image->magick("RGB");
             image->fillColor(Magick::Color(Magick::Color::scaleDoubleToQuantum(rr),
                                            Magick::Color::scaleDoubleToQuantum(rg),
                                            Magick::Color::scaleDoubleToQuantum(rb)));
@@ -563,97 +661,53 @@ public:
             image->annotate(msg, Magick::CenterGravity);
             Magick::Blob blob;
             image->write(&blob);
-
-            m->setData((uint8_t*)blob.data());
-
-            if (disableWhenDone) {
-                int nd = 25;
-                if (duration > 0) {
-                    nd = duration * 1000;
-                }
-                m->setRunningEffect(new StopRunningEffect(m, "Text", disableWhenDone), nd);
-            }
-            delete image;
-        } else {
             delete image;
-            //movement
-            double rr = r;
-            double rg = g;
-            double rb = b;
-            rr /= 255.0f;
-            rg /= 255.0f;
-            rb /= 255.0f;
-
-            Magick::Image image2(Magick::Geometry(maxWid, totalHi), Magick::Color("black"));
-            image2.quiet(true);
-            image2.depth(8);
-            image2.font(font);
-            image2.fontPointsize(fontSize);
-            image2.antiAlias(antialias);
-
-            image2.fillColor(Magick::Color(Magick::Color::scaleDoubleToQuantum(rr),
-                                           Magick::Color::scaleDoubleToQuantum(rg),
-                                           Magick::Color::scaleDoubleToQuantum(rb)));
-            image2.antiAlias(antialias);
-            image2.strokeAntiAlias(antialias);
-            image2.annotate(msg, Magick::CenterGravity);
-
-            double y = (m->getHeight() / 2.0) - ((totalHi) / 2.0);
-            double x = (m->getWidth() / 2.0) - (maxWid / 2.0);
-            if (position == "R2L") {
-                x = m->getWidth();
-            } else if (position == "L2R") {
-                x = -maxWid;
-            } else if (position == "B2T") {
-                y = m->getHeight();
-            } else if (position == "T2B") {
-                y = -metrics.ascent();
-            }
-            image2.modifyImage();
-
-            TextMovementEffect* ef = dynamic_cast<TextMovementEffect*>(m->getRunningEffect());
-            if (ef == nullptr) {
-                ef = new TextMovementEffect(m);
-                ef->x = (int)x;
-                ef->y = (int)y;
-            }
 
-            const MagickLib::PixelPacket* pixel_cache = image2.getConstPixels(0, 0, image2.columns(), image2.rows());
-            uint8_t* newData = (uint8_t*)malloc(image2.columns() * image2.rows() * 3);
-            for (int yi = 0; yi < image2.rows(); yi++) {
-                int idx = yi * image2.columns();
-                int nidx = yi * image2.columns() * 3;
-
-                for (int xi = 0; xi < image2.columns(); xi++) {
-                    const MagickLib::PixelPacket* ptr2 = &pixel_cache[idx + xi];
-                    uint8_t* np = &newData[nidx + (xi * 3)];
-
-                    float r = Magick::Color::scaleQuantumToDouble(ptr2->red);
-                    float g = Magick::Color::scaleQuantumToDouble(ptr2->green);
-                    float b = Magick::Color::scaleQuantumToDouble(ptr2->blue);
-                    r *= 255;
-                    g *= 255;
-                    b *= 255;
-                    np[0] = r;
-                    np[1] = g;
-                    np[2] = b;
-                }
-            }
-            ef->speed = pixelsPerSecond;
-            ef->disableWhenDone = disableWhenDone;
-            ef->direction = position;
-            int32_t t = 1000 / pixelsPerSecond;
-            if (t == 0) {
-                t = 1;
+            uint8_t* newData = (uint8_t*)calloc(cols * rows * 3, 1);
+            memcpy(newData, blob.data(), std::min((size_t)(cols * rows * 3), blob.length()));
+            return newData;
+        }
+        delete image;
+
+        Magick::Image image2(Magick::Geometry(maxWid, totalHi), Magick::Color("black"));
+        image2.quiet(true);
+        image2.depth(8);
+        image2.font(font);
+        image2.fontPointsize(fontSize);
+        image2.antiAlias(antialias);
+
+        image2.fillColor(Magick::Color(Magick::Color::scaleDoubleToQuantum(rr),
+                                       Magick::Color::scaleDoubleToQuantum(rg),
+                                       Magick::Color::scaleDoubleToQuantum(rb)));
+        image2.antiAlias(antialias);
+        image2.strokeAntiAlias(antialias);
+        image2.annotate(msg, Magick::CenterGravity);
+        image2.modifyImage();
+
+        const MagickLib::PixelPacket* pixel_cache = image2.getConstPixels(0, 0, image2.columns(), image2.rows());
+        uint8_t* newData = (uint8_t*)malloc(image2.columns() * image2.rows() * 3);
+        for (int yi = 0; yi < image2.rows(); yi++) {
+            int idx = yi * image2.columns();
+            int nidx = yi * image2.columns() * 3;
+
+            for (int xi = 0; xi < image2.columns(); xi++) {
+                const MagickLib::PixelPacket* ptr2 = &pixel_cache[idx + xi];
+                uint8_t* np = &newData[nidx + (xi * 3)];
+
+                float r = Magick::Color::scaleQuantumToDouble(ptr2->red);
+                float g = Magick::Color::scaleQuantumToDouble(ptr2->green);
+                float b = Magick::Color::scaleQuantumToDouble(ptr2->blue);
+                r *= 255;
+                g *= 255;
+                b *= 255;
+                np[0] = r;
+                np[1] = g;
+                np[2] = b;
             }
-            uint8_t* old = ef->imageData;
-            ef->imageData = newData;
-            ef->imageDataCols = image2.columns();
-            ef->imageDataRows = image2.rows();
-            ef->copyImageData(ef->x, ef->y);
-            m->setRunningEffect(ef, t);
-            free(old);
         }
+        cols = image2.columns();
+        rows = image2.rows();
+        return newData;
     }
 
     virtual bool apply(PixelOverlayModel* model, const std::string& autoEnable, const std::vector<std::string>& args) override {
@@ -32,6 +32,12 @@ public:
 
     virtual const std::string& name() const = 0;
 
+    // Effects of different models are updated at the same time on
+    // separate threads unless this returns false
+    virtual bool canRunInParallel() const {
+        return true;
+    }
+
     PixelOverlayModel* model;
 };
 
@@ -44,6 +44,7 @@
 
 #include "../Plugins.h"
 #include "../Sequence.h"
+#include "../channeloutput/channeloutputthread.h"
 #include "../commands/Commands.h"
 #include "../common.h"
 #include "../effects.h"
@@ -51,8 +52,16 @@
 #include "../settings.h"
 
 #include "PixelOverlay.h"
+#include "PixelOverlayBlend.h"
 #include "PixelOverlayEffects.h"
 #include "PixelOverlayModel.h"
+#include "PixelOverlayScaler.h"
+
+// Output frame interval (us) published to triple buffer writers, the
+// refresh rate may not be set yet when the buffer is created
+static uint32_t GetOverlayFrameInterval() {
+    return 1000000 / std::max(GetChannelOutputRefreshRate(), 1.0f);
+}
 
 static uint8_t* createChannelDataMemory(const std::string& dataName, uint32_t size) {
     mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH;
@@ -259,6 +268,7 @@ PixelOverlayModel::PixelOverlayModel(const Json::Value& c) :
             }
         }
     }
+    compileChannelMap();
 }
 PixelOverlayModel::~PixelOverlayModel() {
     if (channelData) {
@@ -274,7 +284,7 @@ PixelOverlayModel::~PixelOverlayModel() {
         shm_unlink(dataName.c_str());
     }
     if (overlayBufferData) {
-        munmap(overlayBufferData, width * height * 3 + sizeof(OverlayBufferData));
+        munmap(overlayBufferData, OverlayBufferSize(width, height));
         std::string overlayBufferName = "/FPP-Model-Overlay-Buffer-" + name;
         if (PSHMNAMLEN <= 48) {
             // system doesn't allow very long shared memory names, we'll use a shortened form
@@ -307,7 +317,19 @@ void PixelOverlayModel::setState(const PixelOverlayState& st) {
     state = st;
     PixelOverlayManager::INSTANCE.modelStateChanged(this, old, state);
 }
-void PixelOverlayModel::setChildState(const std::string& n, const PixelOverlayState& st, int ox, int oy, int w, int h) {
+void PixelOverlayModel::setOpacity(uint8_t o) {
+    if (o == opacity) {
+        return;
+    }
+    opacity = o;
+    dirtyBuffer = true;
+    if (state.getState()) {
+        // may change which models are hidden
+        PixelOverlayManager::INSTANCE.modelStateChanged(this, state, state);
+    }
+}
+
+void PixelOverlayModel::setChildState(const std::string& n, const PixelOverlayState& st, int ox, int oy, int w, int h, uint8_t op) {
     bool hadChildren = !children.empty();
 
     auto it = children.begin();
@@ -321,6 +343,7 @@ void PixelOverlayModel::setChildState(const std::string& n, const PixelOverlaySt
             } else {
                 it->name = n;
                 it->state = st;
+                it->opacity = op;
                 it->xoffset = ox;
                 it->yoffset = oy;
                 it->width = w;
@@ -334,6 +357,7 @@ void PixelOverlayModel::setChildState(const std::string& n, const PixelOverlaySt
         ChildModelState cms;
         cms.name = n;
         cms.state = st;
+        cms.opacity = op;
         cms.xoffset = ox;
         cms.yoffset = oy;
         cms.width = w;
@@ -354,6 +378,10 @@ bool PixelOverlayModel::flushChildren(uint8_t* dst) {
     }
     for (auto& c : children) {
         int cst = c.state.getState();
+        if (cst == PixelOverlayState::Enabled && c.opacity != 255) {
+            // blended the same as a top level model
+            cst = PixelOverlayState::Alpha;
+        }
         for (int y = 0; y < c.height; y++) {
             int yoff = (y + c.yoffset) * width * 3;
             for (int x = 0; x < c.width; x++) {
@@ -384,7 +412,7 @@ bool PixelOverlayModel::flushChildren(uint8_t* dst) {
                         dst[channelMap[offb]] = channelData[channelMap[offb]];
                     }
                     break;
-                case 3:
+                case 3: {
                     bool cp = channelMap[offr] != FPPD_OFF_CHANNEL && channelData[channelMap[offr]];
                     cp |= channelMap[offg] != FPPD_OFF_CHANNEL && channelData[channelMap[offg]];
                     cp |= channelMap[offb] != FPPD_OFF_CHANNEL && channelData[channelMap[offb]];
@@ -399,6 +427,16 @@ bool PixelOverlayModel::flushChildren(uint8_t* dst) {
                             dst[channelMap[offb]] = channelData[offb];
                         }
                     }
+                } break;
+                default:
+                    // blend states, channels of a pixel aren't adjacent in
+                    // the output so blend them one at a time
+                    for (int off = offr; off <= offb; off++) {
+                        uint32_t ch = channelMap[off];
+                        if (ch != FPPD_OFF_CHANNEL) {
+                            blendChannels(cst, c.opacity, &dst[ch], &channelData[ch], 1);
+                        }
+                    }
                     break;
                 }
             }
@@ -407,6 +445,36 @@ bool PixelOverlayModel::flushChildren(uint8_t* dst) {
     return true;
 }
 
+void PixelOverlayModel::blendChannels(int st, uint8_t op, uint8_t* dst, const uint8_t* src, int len) {
+    switch (st) {
+    case PixelOverlayState::Enabled:
+        if (op == 255) {
+            memcpy(dst, src, len);
+        } else {
+            OverlayBlendAlpha(dst, src, len, op);
+        }
+        break;
+    case PixelOverlayState::Transparent:
+        OverlayBlendTransparent(dst, src, len);
+        break;
+    case PixelOverlayState::TransparentRGB:
+        OverlayBlendTransparentRGB(dst, src, len);
+        break;
+    case PixelOverlayState::Alpha:
+        OverlayBlendAlpha(dst, src, len, op);
+        break;
+    case PixelOverlayState::Add:
+        OverlayBlendAdd(dst, src, len, op);
+        break;
+    case PixelOverlayState::Max:
+        OverlayBlendMax(dst, src, len, op);
+        break;
+    case PixelOverlayState::Multiply:
+        OverlayBlendMultiply(dst, src, len, op);
+        break;
+    }
+}
+
 void PixelOverlayModel::doOverlay(uint8_t* channels) {
     int st = state.getState();
     uint8_t* dst = &channels[startChannel];
@@ -418,7 +486,8 @@ void PixelOverlayModel::doOverlay(uint8_t* channels) {
         dirtyBuffer = false;
         return;
     }
-    if (((st == 2) || (st == 3)) &&
+    bool overBlack = opacity == 255 && ((st == 2) || (st == 3) || (st == 5) || (st == 6));
+    if (overBlack &&
         (!IsEffectRunning()) &&
         (!sequence->IsSequenceRunning()) &&
         !PluginManager::INSTANCE.hasPlugins()) {
@@ -426,38 +495,109 @@ void PixelOverlayModel::doOverlay(uint8_t* channels) {
         st = 1;
     }
 
-    uint8_t* src = channelData;
-    switch (st) {
-    case 1: //Active - Opaque
-        memcpy(dst, src, channelCount);
-        break;
-    case 2: //Active Transparent
-        for (int j = 0; j < channelCount; j++, src++, dst++) {
-            if (*src) {
-                *dst = *src;
+    blendChannels(st, opacity, dst, channelData, channelCount);
+    dirtyBuffer = false;
+}
+
+void PixelOverlayModel::compileChannelMap() {
+    channelRuns.clear();
+    channelRunRows.resize(height + 1);
+    for (int y = 0; y < height; y++) {
+        size_t rowStart = channelRuns.size();
+        channelRunRows[y] = rowStart;
+        for (int x = 0; x < width; x++) {
+            int c = (y * width + x) * 3;
+            uint32_t base = channelMap[c];
+
+            // leading channels of the pixel mapped consecutively, the rest off
+            int n = 0;
+            while (n < 3 && channelMap[c + n] != FPPD_OFF_CHANNEL && channelMap[c + n] == (base + n)) {
+                n++;
             }
-        }
-        break;
-    case 3: //Active Transparent RGB {
-        for (int j = 0; j < channelCount; j += 3, src += 3, dst += 3) {
-            if (src[0] || src[1] || src[2]) {
-                dst[0] = src[0];
-                dst[1] = src[1];
-                dst[2] = src[2];
+            bool regular = true;
+            for (int k = n; k < 3; k++) {
+                if (channelMap[c + k] != FPPD_OFF_CHANNEL) {
+                    regular = false;
+                }
+            }
+            if (!regular) {
+                // odd custom mapping, one run per channel
+                for (int k = 0; k < 3; k++) {
+                    if (channelMap[c + k] != FPPD_OFF_CHANNEL) {
+                        channelRuns.push_back({ (uint32_t)x, 1, channelMap[c + k], 1, (uint8_t)k, 1 });
+                    }
+                }
+                continue;
             }
+            if (n == 0) {
+                continue;
+            }
+            if (channelRuns.size() > rowStart) {
+                ChannelRun& r = channelRuns.back();
+                if (r.srcOffset == 0 && r.channels == n && (r.x + r.count) == x) {
+                    int64_t d = (int64_t)base - (int64_t)r.dst;
+                    if (r.count == 1 && d != 0 && d > INT32_MIN && d < INT32_MAX) {
+                        r.stride = d;
+                        r.count++;
+                        continue;
+                    } else if (r.count > 1 && d == (int64_t)r.count * r.stride) {
+                        r.count++;
+                        continue;
+                    }
+                }
+            }
+            channelRuns.push_back({ (uint32_t)x, 1, base, n, 0, (uint8_t)n });
         }
-        break;
     }
-
-    dirtyBuffer = false;
+    channelRunRows[height] = channelRuns.size();
+    LogDebug(VB_CHANNELOUT, "Model %s: %dx%d mapped with %d channel runs\n",
+             name.c_str(), width, height, (int)channelRuns.size());
 }
 
-void PixelOverlayModel::setData(const uint8_t* data) {
-    for (int c = 0; c < (width * height * 3); c++) {
-        if (channelMap[c] != FPPD_OFF_CHANNEL) {
-            channelData[channelMap[c]] = data[c];
+void PixelOverlayModel::copyRuns(const uint8_t* data, int srcStride, int x, int y, int w, int h) {
+    int xEnd = x + w;
+    for (int row = 0; row < h; row++) {
+        const uint8_t* rowData = data + row * srcStride;
+        uint32_t end = channelRunRows[y + row + 1];
+        for (uint32_t i = channelRunRows[y + row]; i < end; i++) {
+            const ChannelRun& r = channelRuns[i];
+            if ((int)r.x >= xEnd) {
+                break;
+            }
+            int rs = std::max((int)r.x, x);
+            int re = std::min((int)(r.x + r.count), xEnd);
+            if (rs >= re) {
+                continue;
+            }
+            int count = re - rs;
+            const uint8_t* src = rowData + (rs - x) * 3 + r.srcOffset;
+            uint8_t* dst = channelData + r.dst + (int64_t)(rs - r.x) * r.stride;
+            if (r.channels == 3 && r.stride == 3) {
+                memcpy(dst, src, count * 3);
+            } else if (r.channels == 3) {
+                for (int p = 0; p < count; p++, src += 3, dst += r.stride) {
+                    dst[0] = src[0];
+                    dst[1] = src[1];
+                    dst[2] = src[2];
+                }
+            } else {
+                for (int p = 0; p < count; p++, src += 3, dst += r.stride) {
+                    for (int k = 0; k < r.channels; k++) {
+                        dst[k] = src[k];
+                    }
+                }
+            }
         }
     }
+}
+
+void PixelOverlayModel::setData(const uint8_t* data) {
+    copyRuns(data, width * 3, 0, 0, width, height);
+    dirtyBuffer = true;
+}
+
+void PixelOverlayModel::setDataRegion(const uint8_t* data, int x, int y, int w, int h) {
+    copyRuns(data + (y * width + x) * 3, width * 3, x, y, w, h);
     dirtyBuffer = true;
 }
 
@@ -484,6 +624,16 @@ void PixelOverlayModel::setData(const uint8_t* data, int xOffset, int yOffset, i
     }
 
     int cst = st.getState();
+    if (cst > 3) {
+        // blend states are applied when this model is composited
+        cst = 1;
+    }
+    if (cst == 1) {
+        copyRuns(data, w * 3, xOffset, yOffset, w, h);
+        dirtyBuffer = true;
+        return;
+    }
+
     int rowWrap = (width - w) * 3;
     int s = 0;
     int c = (yOffset * width * 3) + (xOffset * 3);
@@ -570,33 +720,10 @@ void PixelOverlayModel::getPixelValue(int x, int y, int& r, int& g, int& b) {
 }
 
 void PixelOverlayModel::setScaledData(uint8_t* data, int w, int h) {
-    float ydiff = (float)h / (float)height;
-    float xdiff = (float)w / (float)width;
-
-    float newy = 0.0f;
-    float newx = 0.0f;
-    int x, y;
-
-    for (y = 0, newy = 0.0f; y < height; y++, newy += ydiff) {
-        int srcY = newy;
-        for (x = 0, newx = 0.0f; x < width; x++, newx += xdiff) {
-            int srcX = newx;
-
-            int idx = y * width * 3 + x * 3;
-            int srcidx = srcY * w * 3 + srcX * 3;
-
-            if (channelMap[idx] != FPPD_OFF_CHANNEL) {
-                channelData[channelMap[idx++]] = data[srcidx++];
-            }
-            if (channelsPerNode > 1 && channelMap[idx] != FPPD_OFF_CHANNEL) {
-                channelData[channelMap[idx++]] = data[srcidx++];
-            }
-            if (channelsPerNode > 2 && channelMap[idx] != FPPD_OFF_CHANNEL) {
-                channelData[channelMap[idx++]] = data[srcidx++];
-            }
-        }
-    }
-    dirtyBuffer = true;
+    static thread_local std::vector<uint8_t> scaled;
+    scaled.resize(width * height * 3);
+    ScaleRGB(data, w, h, scaled.data(), width, height);
+    setData(scaled.data());
 }
 void PixelOverlayModel::clearData() {
     memset(channelData, 0, channelCount);
@@ -685,21 +812,70 @@ uint8_t* PixelOverlayModel::getOverlayBuffer() {
 
         mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH;
         int f = shm_open(overlayBufferName.c_str(), O_RDWR | O_CREAT, mode);
-        int size = width * height * 3 + sizeof(OverlayBufferData);
+        size_t size = OverlayBufferSize(width, height);
         ftruncate(f, size);
         overlayBufferData = (OverlayBufferData*)mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, f, 0);
         memset(overlayBufferData, 0, size);
         overlayBufferData->width = width;
         overlayBufferData->height = height;
         close(f);
+
+        overlayBufferSlots = (OverlayBufferSlots*)((uint8_t*)overlayBufferData + OverlayBufferSlotsOffset(width, height));
+        overlayBufferSlots->version = OVERLAY_BUFFER_VERSION;
+        overlayBufferSlots->slotCount = OVERLAY_BUFFER_SLOT_COUNT;
+        overlayBufferSlots->slotSize = width * height * 3;
+        overlayBufferSlots->readSlot = 0;
+        overlayBufferSlots->published = 1;
+        overlayBufferSlots->writeSlot = 2;
+        overlayBufferSlots->frameInterval = GetOverlayFrameInterval();
+        overlayBufferSlots->magic = OVERLAY_BUFFER_MAGIC;
+        overlayBufferData->flags |= OVERLAY_BUFFER_SLOTS;
     }
     return overlayBufferData->data;
 }
 
+void PixelOverlayModel::markOverlayBufferDirty(int x, int y, int w, int h) {
+    int x2 = std::min(x + w, width);
+    int y2 = std::min(y + h, height);
+    x = std::max(x, 0);
+    y = std::max(y, 0);
+    if (x >= x2 || y >= y2) {
+        return;
+    }
+    if (!overlayDirtyTracked) {
+        overlayDirtyX1 = x;
+        overlayDirtyY1 = y;
+        overlayDirtyX2 = x2;
+        overlayDirtyY2 = y2;
+        overlayDirtyTracked = true;
+    } else {
+        overlayDirtyX1 = std::min(overlayDirtyX1, x);
+        overlayDirtyY1 = std::min(overlayDirtyY1, y);
+        overlayDirtyX2 = std::max(overlayDirtyX2, x2);
+        overlayDirtyY2 = std::max(overlayDirtyY2, y2);
+    }
+}
+
 void PixelOverlayModel::clearOverlayBuffer() {
     memset(getOverlayBuffer(), 0, width * height * 3);
+    markOverlayBufferDirty(0, 0, width, height);
+}
+void PixelOverlayModel::clearOverlayBuffer(int x, int y, int w, int h) {
+    int x2 = std::min(x + w, width);
+    int y2 = std::min(y + h, height);
+    x = std::max(x, 0);
+    y = std::max(y, 0);
+    if (x >= x2 || y >= y2) {
+        return;
+    }
+    uint8_t* buf = getOverlayBuffer();
+    for (int row = y; row < y2; row++) {
+        memset(buf + (row * width + x) * 3, 0, (x2 - x) * 3);
+    }
+    markOverlayBufferDirty(x, y, x2 - x, y2 - y);
 }
 void PixelOverlayModel::fillOverlayBuffer(int r, int g, int b) {
+    markOverlayBufferDirty(0, 0, width, height);
     uint8_t* data = getOverlayBuffer();
     for (int w = 0; w < (width * height); w++) {
         data[0] = r;
@@ -718,6 +894,7 @@ void PixelOverlayModel::setOverlayPixelValue(int x, int y, int r, int g, int b)
     buf[idx++] = r;
     buf[idx++] = g;
     buf[idx] = b;
+    markOverlayBufferDirty(x, y, 1, 1);
 }
 void PixelOverlayModel::getOverlayPixelValue(int x, int y, int& r, int& g, int& b) {
     if (y >= height || x >= width || x < 0 || y < 0) {
@@ -731,48 +908,73 @@ void PixelOverlayModel::getOverlayPixelValue(int x, int y, int& r, int& g, int&
     b = buf[idx];
 }
 
+// set while updateRunningEffects() is running on this thread
+static thread_local bool deferOverlayFlush = false;
+
+void PixelOverlayModel::flushOverlayBufferIfIdle() {
+    if (overlayBufferIsDirty() && renderLock.try_lock()) {
+        flushOverlayBuffer();
+        renderLock.unlock();
+    }
+}
+
 void PixelOverlayModel::flushOverlayBuffer() {
-    setData(getOverlayBuffer());
+    if (deferOverlayFlush) {
+        setOverlayBufferDirty(true);
+        return;
+    }
+    uint8_t* buf = getOverlayBuffer();
+    if (uint8_t* frame = OverlayBufferTakeSlot(overlayBufferSlots)) {
+        // a full frame from an external producer replaces anything in the
+        // shared overlay buffer
+        overlayDirtyTracked = false;
+        setData(frame);
+    } else if (overlayDirtyTracked) {
+        int x = overlayDirtyX1;
+        int y = overlayDirtyY1;
+        int w = overlayDirtyX2 - x;
+        int h = overlayDirtyY2 - y;
+        overlayDirtyTracked = false;
+        if (w == width && h == height) {
+            setData(buf);
+        } else {
+            setDataRegion(buf, x, y, w, h);
+        }
+    } else {
+        // written directly, don't know what changed
+        setData(buf);
+    }
     setOverlayBufferDirty(false);
 }
 
 bool PixelOverlayModel::overlayBufferIsDirty() {
-    return (overlayBufferData && (overlayBufferData->flags & 0x1));
+    if (!overlayBufferData) {
+        return false;
+    }
+    return (overlayBufferData->flags & OVERLAY_BUFFER_DIRTY) || (overlayBufferSlots->published.load(std::memory_order_relaxed) & OVERLAY_SLOT_NEW);
 }
 
 void PixelOverlayModel::setOverlayBufferDirty(bool dirty) {
     getOverlayBuffer();
 
     if (dirty)
-        overlayBufferData->flags |= 0x1;
+        overlayBufferData->flags |= OVERLAY_BUFFER_DIRTY;
     else
-        overlayBufferData->flags &= ~0x1;
+        overlayBufferData->flags &= ~OVERLAY_BUFFER_DIRTY;
 }
 
-void PixelOverlayModel::setOverlayBufferScaledData(uint8_t* data, int w, int h) {
-    float ydiff = (float)h / (float)height;
-    float xdiff = (float)w / (float)width;
-    uint8_t* buf = getOverlayBuffer();
-
-    float newy = 0.0f;
-    float newx = 0.0f;
-    int x, y;
-
-    for (y = 0, newy = 0.0f; y < height; y++, newy += ydiff) {
-        int srcY = newy;
-        for (x = 0, newx = 0.0f; x < width; x++, newx += xdiff) {
-            int srcX = newx;
-
-            int idx = y * width * 3 + x * 3;
-            int srcidx = srcY * w * 3 + srcX * 3;
-
-            buf[idx++] = data[srcidx++];
-            buf[idx++] = data[srcidx++];
-            buf[idx] = data[srcidx];
-        }
+void PixelOverlayModel::signalOverlayFrame() {
+    if (overlayBufferSlots) {
+        overlayBufferSlots->frameInterval = GetOverlayFrameInterval();
+        OverlayBufferSignalFrame(overlayBufferSlots);
     }
 }
 
+void PixelOverlayModel::setOverlayBufferScaledData(uint8_t* data, int w, int h) {
+    ScaleRGB(data, w, h, getOverlayBuffer(), width, height);
+    markOverlayBufferDirty(0, 0, width, height);
+}
+
 void PixelOverlayModel::saveOverlayAsImage(std::string filename) {
     Magick::Blob blob;
     Magick::Image image(Magick::Geometry(width, height), Magick::Color("black"));
@@ -845,10 +1047,18 @@ void PixelOverlayModel::toJson(Json::Value& result) {
     result = config;
 }
 
+bool PixelOverlayModel::runningEffectCanRunInParallel() {
+    std::unique_lock<std::mutex> l(effectLock);
+    return !runningEffect || runningEffect->canRunInParallel();
+}
+
 int32_t PixelOverlayModel::updateRunningEffects() {
+    std::unique_lock<std::mutex> rl(renderLock);
     std::unique_lock<std::mutex> l(effectLock);
     if (runningEffect) {
+        deferOverlayFlush = true;
         int32_t v = runningEffect->update();
+        deferOverlayFlush = false;
         if (v == 0) {
             delete runningEffect;
             runningEffect = nullptr;
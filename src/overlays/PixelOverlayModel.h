@@ -15,6 +15,8 @@
 #include <mutex>
 #include <thread>
 
+#include "PixelOverlayBuffer.h"
+
 class RunningEffect;
 
 class PixelOverlayState {
@@ -23,7 +25,11 @@ public:
         Disabled,
         Enabled,
         Transparent,
-        TransparentRGB
+        TransparentRGB,
+        Alpha,
+        Add,
+        Max,
+        Multiply
     };
 
     PixelOverlayState() :
@@ -41,6 +47,14 @@ public:
             state = PixelState::Transparent;
         } else if (v == "TransparentRGB" || v == "Transparent RGB") {
             state = PixelState::TransparentRGB;
+        } else if (v == "Alpha") {
+            state = PixelState::Alpha;
+        } else if (v == "Add") {
+            state = PixelState::Add;
+        } else if (v == "Max" || v == "Lighten") {
+            state = PixelState::Max;
+        } else if (v == "Multiply") {
+            state = PixelState::Multiply;
         } else {
             state = PixelState::Disabled;
         }
@@ -72,6 +86,11 @@ public:
     PixelOverlayState getState() const;
     virtual void setState(const PixelOverlayState& state);
 
+    // Opacity (0-255) used by the Alpha/Add/Max/Multiply blend states, an
+    // Enabled model with an opacity below 255 is alpha blended
+    uint8_t getOpacity() const { return opacity; }
+    virtual void setOpacity(uint8_t o);
+
     virtual void doOverlay(uint8_t* channels);
 
     int getStartChannel() const;
@@ -98,15 +117,25 @@ public:
     // construct the frame as a full RGB image prior to flushing to the channelData.
     // The overlay buffer is also mmapped so external programs can have easy
     // access to the continuous width*height*3 buffer
+    //
+    // The methods below record the area they change so a flush only maps those
+    // pixels.  Code writing through getOverlayBuffer() directly should call
+    // markOverlayBufferDirty(), if nothing has been marked the whole buffer is flushed.
     uint8_t* getOverlayBuffer();
     void setOverlayBufferDirty(bool dirty = true);
     bool overlayBufferIsDirty();
+    void markOverlayBufferDirty(int x, int y, int w, int h);
     void clearOverlayBuffer();
+    void clearOverlayBuffer(int x, int y, int w, int h);
     void setOverlayBufferScaledData(uint8_t* data, int w, int h);
     void fillOverlayBuffer(int r, int g, int b);
     void setOverlayPixelValue(int x, int y, int r, int g, int b);
     void getOverlayPixelValue(int x, int y, int& r, int& g, int& b);
     void flushOverlayBuffer();
+    // Flushes a dirty overlay buffer unless an effect is drawing into it
+    void flushOverlayBufferIfIdle();
+    // Wakes external producers waiting for the next frame, see PixelOverlayBuffer.h
+    void signalOverlayFrame();
 
     // Operate on both the overlay buffer (if mapped) and the channelData
     void clear();
@@ -115,19 +144,30 @@ public:
     bool applyEffect(const std::string& autoState, const std::string& effect, const std::vector<std::string>& args);
     void setRunningEffect(RunningEffect* r, int32_t firstUpdateMS);
     RunningEffect* getRunningEffect() const { return runningEffect; }
+    bool runningEffectCanRunInParallel();
+    // Flushes of the overlay buffer made by the effect are left for the
+    // output thread so a partially drawn update is never shown
     int32_t updateRunningEffects();
 
-    void setChildState(const std::string& n, const PixelOverlayState& state, int ox, int oy, int w, int h);
+    void setChildState(const std::string& n, const PixelOverlayState& state, int ox, int oy, int w, int h, uint8_t opacity = 255);
 
 protected:
     void setValue(uint8_t v, int startChannel = -1, int endChannel = -1);
     bool flushChildren(uint8_t* dst);
+    static void blendChannels(int st, uint8_t opacity, uint8_t* dst, const uint8_t* src, int len);
+
+    // data is a full width*height*3 buffer, only the given region is copied
+    virtual void setDataRegion(const uint8_t* data, int x, int y, int w, int h);
+
+    void compileChannelMap();
+    void copyRuns(const uint8_t* data, int srcStride, int x, int y, int w, int h);
 
     Json::Value config;
     std::string name;
     std::string type;
     int width, height;
     PixelOverlayState state;
+    uint8_t opacity = 255;
     int startChannel;
     int channelCount;
     int channelsPerNode;
@@ -135,23 +175,42 @@ protected:
     std::vector<uint32_t> channelMap;
     uint8_t* channelData;
 
+    // channelMap compiled into runs of pixels that map to evenly spaced
+    // channels, contiguous runs are a single memcpy and off pixels have
+    // no run at all
+    class ChannelRun {
+    public:
+        uint32_t x;        // first pixel of the run in its row
+        uint32_t count;    // number of pixels
+        uint32_t dst;      // channelData offset of the first pixel
+        int32_t stride;    // channelData distance between pixels
+        uint8_t srcOffset; // first channel used within the source pixel
+        uint8_t channels;  // channels copied per pixel
+    };
+    std::vector<ChannelRun> channelRuns;
+    std::vector<uint32_t> channelRunRows; // first run of each row, height+1 entries
+
     volatile bool dirtyBuffer = false;
 
-    struct OverlayBufferData {
-        uint32_t width;
-        uint32_t height;
-        uint32_t flags;
-        uint8_t data[4];
-    } __attribute__((__packed__));
+    // area of the overlay buffer changed since the last flush
+    bool overlayDirtyTracked = false;
+    int overlayDirtyX1 = 0;
+    int overlayDirtyY1 = 0;
+    int overlayDirtyX2 = 0;
+    int overlayDirtyY2 = 0;
+
     OverlayBufferData* overlayBufferData;
+    OverlayBufferSlots* overlayBufferSlots = nullptr;
 
     std::mutex effectLock;
+    std::mutex renderLock; // held while an effect draws into the overlay buffer
     RunningEffect* runningEffect;
 
     class ChildModelState {
     public:
         std::string name;
         PixelOverlayState state = PixelOverlayState::Disabled;
+        uint8_t opacity = 255;
         int xoffset = 0;
         int yoffset = 0;
         int width = 0;
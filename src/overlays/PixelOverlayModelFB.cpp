@@ -48,3 +48,12 @@ void PixelOverlayModelFB::setData(const uint8_t* data) {
     memcpy(channelData, data, width * height * 3);
     dirtyBuffer = true;
 }
+
+void PixelOverlayModelFB::setDataRegion(const uint8_t* data, int x, int y, int w, int h) {
+    int stride = width * 3;
+    int off = y * stride + x * 3;
+    for (int r = 0; r < h; r++, off += stride) {
+        memcpy(channelData + off, data + off, w * 3);
+    }
+    dirtyBuffer = true;
+}
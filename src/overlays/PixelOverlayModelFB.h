@@ -22,6 +22,9 @@ public:
     virtual void doOverlay(uint8_t* channels) override;
     virtual void setData(const uint8_t* data) override;
 
+protected:
+    virtual void setDataRegion(const uint8_t* data, int x, int y, int w, int h) override;
+
 private:
     FrameBuffer* fb = nullptr;
 };
@@ -47,7 +47,13 @@ bool PixelOverlayModelSub::foundParent() {
 void PixelOverlayModelSub::setState(const PixelOverlayState& st) {
     PixelOverlayModel::setState(st);
     if (foundParent()) {
-        parent->setChildState(name, st, xOffset, yOffset, width, height);
+        parent->setChildState(name, st, xOffset, yOffset, width, height, opacity);
+    }
+}
+void PixelOverlayModelSub::setOpacity(uint8_t o) {
+    PixelOverlayModel::setOpacity(o);
+    if (foundParent() && state.getState()) {
+        parent->setChildState(name, state, xOffset, yOffset, width, height, opacity);
     }
 }
 
@@ -74,3 +80,10 @@ void PixelOverlayModelSub::setData(const uint8_t* data) {
 
     dirtyBuffer = true;
 }
+
+void PixelOverlayModelSub::setDataRegion(const uint8_t* data, int x, int y, int w, int h) {
+    if (!foundParent())
+        return;
+
+    PixelOverlayModel::setDataRegion(data, x, y, w, h);
+}
@@ -22,6 +22,10 @@ public:
     virtual void setData(const uint8_t* data) override;
 
     virtual void setState(const PixelOverlayState& st) override;
+    virtual void setOpacity(uint8_t o) override;
+
+protected:
+    virtual void setDataRegion(const uint8_t* data, int x, int y, int w, int h) override;
 
 private:
     bool foundParent();
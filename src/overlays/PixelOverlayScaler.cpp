@@ -0,0 +1,219 @@
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include "fpp-pch.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define OVERLAY_SCALE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define OVERLAY_SCALE_SSE2
+#endif
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "PixelOverlayScaler.h"
+
+// Number of source/destination size combinations to keep plans for
+#define SCALE_MAX_PLANS 8
+
+// Weights for each axis are 8 bit fixed point and sum to 256
+class ScaleAxis {
+public:
+    void build(int s, int d) {
+        start.resize(d);
+        count.resize(d);
+        offset.resize(d);
+        weights.clear();
+        for (int i = 0; i < d; i++) {
+            offset[i] = weights.size();
+            if (s > d) {
+                // area average, dest pixel i covers [i*s, (i+1)*s) in 1/d source pixels
+                int b = i * s;
+                int e = b + s;
+                int j0 = b / d;
+                int j1 = (e - 1) / d;
+                int total = 0;
+                int largest = 0;
+                for (int j = j0; j <= j1; j++) {
+                    int overlap = std::min((j + 1) * d, e) - std::max(j * d, b);
+                    int w = (overlap * 256 + s / 2) / s;
+                    weights.push_back(w);
+                    total += w;
+                    if (w > weights[offset[i] + largest]) {
+                        largest = j - j0;
+                    }
+                }
+                weights[offset[i] + largest] += 256 - total;
+                start[i] = j0;
+                count[i] = j1 - j0 + 1;
+            } else if (s < d) {
+                // bilinear between the two source pixels around the dest pixel center
+                int num = (2 * i + 1) * s - d;
+                int j0 = 0;
+                int f = 0;
+                if (num > 0) {
+                    j0 = num / (2 * d);
+                    f = (num % (2 * d)) * 256 / (2 * d);
+                }
+                if (j0 >= s - 1) {
+                    j0 = s - 1;
+                    f = 0;
+                }
+                start[i] = j0;
+                if (f) {
+                    weights.push_back(256 - f);
+                    weights.push_back(f);
+                    count[i] = 2;
+                } else {
+                    weights.push_back(256);
+                    count[i] = 1;
+                }
+            } else {
+                start[i] = i;
+                count[i] = 1;
+                weights.push_back(256);
+            }
+        }
+    }
+
+    std::vector<int> start;
+    std::vector<int> count;
+    std::vector<int> offset;
+    std::vector<uint16_t> weights;
+};
+
+class ScalePlan {
+public:
+    ScalePlan(int sw_, int sh_, int dw_, int dh_) :
+        sw(sw_),
+        sh(sh_),
+        dw(dw_),
+        dh(dh_) {
+        cols.build(sw, dw);
+        rows.build(sh, dh);
+    }
+
+    int sw, sh, dw, dh;
+    ScaleAxis cols;
+    ScaleAxis rows;
+};
+
+static std::mutex planLock;
+static std::list<std::shared_ptr<ScalePlan>> plans;
+
+static std::shared_ptr<ScalePlan> getPlan(int sw, int sh, int dw, int dh) {
+    std::unique_lock<std::mutex> lock(planLock);
+    for (auto it = plans.begin(); it != plans.end(); ++it) {
+        std::shared_ptr<ScalePlan> p = *it;
+        if (p->sw == sw && p->sh == sh && p->dw == dw && p->dh == dh) {
+            if (it != plans.begin()) {
+                plans.erase(it);
+                plans.push_front(p);
+            }
+            return p;
+        }
+    }
+    std::shared_ptr<ScalePlan> p = std::make_shared<ScalePlan>(sw, sh, dw, dh);
+    plans.push_front(p);
+    if (plans.size() > SCALE_MAX_PLANS) {
+        plans.pop_back();
+    }
+    return p;
+}
+
+// acc = src * w (first) or acc += src * w, at most 255 * 256 so it fits in 16 bits
+static void accumulateRow(uint16_t* acc, const uint8_t* src, int len, uint16_t w, bool first) {
+    int i = 0;
+#if defined(OVERLAY_SCALE_NEON)
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t s = vld1q_u8(src + i);
+        uint16x8_t lo = vmovl_u8(vget_low_u8(s));
+        uint16x8_t hi = vmovl_u8(vget_high_u8(s));
+        if (first) {
+            vst1q_u16(acc + i, vmulq_n_u16(lo, w));
+            vst1q_u16(acc + i + 8, vmulq_n_u16(hi, w));
+        } else {
+            vst1q_u16(acc + i, vmlaq_n_u16(vld1q_u16(acc + i), lo, w));
+            vst1q_u16(acc + i + 8, vmlaq_n_u16(vld1q_u16(acc + i + 8), hi, w));
+        }
+    }
+#elif defined(OVERLAY_SCALE_SSE2)
+    __m128i zero = _mm_setzero_si128();
+    __m128i vw = _mm_set1_epi16(w);
+    for (; i + 16 <= len; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), vw);
+        __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), vw);
+        if (!first) {
+            lo = _mm_add_epi16(lo, _mm_loadu_si128((const __m128i*)(acc + i)));
+            hi = _mm_add_epi16(hi, _mm_loadu_si128((const __m128i*)(acc + i + 8)));
+        }
+        _mm_storeu_si128((__m128i*)(acc + i), lo);
+        _mm_storeu_si128((__m128i*)(acc + i + 8), hi);
+    }
+#endif
+    if (first) {
+        for (; i < len; i++) {
+            acc[i] = src[i] * w;
+        }
+    } else {
+        for (; i < len; i++) {
+            acc[i] += src[i] * w;
+        }
+    }
+}
+
+void ScaleRGB(const uint8_t* src, int sw, int sh, uint8_t* dst, int dw, int dh) {
+    if (sw <= 0 || sh <= 0 || dw <= 0 || dh <= 0) {
+        return;
+    }
+    if (sw == dw && sh == dh) {
+        memcpy(dst, src, sw * sh * 3);
+        return;
+    }
+    std::shared_ptr<ScalePlan> plan = getPlan(sw, sh, dw, dh);
+    const ScaleAxis& rows = plan->rows;
+    const ScaleAxis& cols = plan->cols;
+
+    static thread_local std::vector<uint16_t> acc;
+    acc.resize(sw * 3);
+    int srcStride = sw * 3;
+    for (int y = 0; y < dh; y++) {
+        // vertical pass into a 16 bit row of source width
+        const uint16_t* wy = &rows.weights[rows.offset[y]];
+        for (int k = 0; k < rows.count[y]; k++) {
+            accumulateRow(acc.data(), src + (rows.start[y] + k) * srcStride, srcStride, wy[k], k == 0);
+        }
+
+        // horizontal pass, total weight is 256 * 256
+        uint8_t* out = dst + y * dw * 3;
+        for (int x = 0; x < dw; x++) {
+            const uint16_t* wx = &cols.weights[cols.offset[x]];
+            const uint16_t* a = &acc[cols.start[x] * 3];
+            uint32_t r = 32768, g = 32768, b = 32768;
+            for (int k = 0; k < cols.count[x]; k++, a += 3) {
+                r += a[0] * (uint32_t)wx[k];
+                g += a[1] * (uint32_t)wx[k];
+                b += a[2] * (uint32_t)wx[k];
+            }
+            out[0] = r >> 16;
+            out[1] = g >> 16;
+            out[2] = b >> 16;
+            out += 3;
+        }
+    }
+}
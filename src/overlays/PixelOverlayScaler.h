@@ -0,0 +1,24 @@
+#pragma once
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include <stdint.h>
+
+/*
+ * Resamples a packed RGB image of sw x sh pixels into dw x dh pixels.
+ * Each axis is area averaged when shrinking and bilinear when growing,
+ * all in fixed point.  The per row/column source ranges and weights are
+ * computed once per (source size, destination size) and cached so
+ * scaling every frame of a stream only does the multiply/adds, the
+ * vertical pass uses NEON or SSE2 when the compiler targets it.
+ */
+void ScaleRGB(const uint8_t* src, int sw, int sh, uint8_t* dst, int dw, int dh);
@@ -0,0 +1,341 @@
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include "fpp-pch.h"
+
+#include <algorithm>
+#include <map>
+
+#ifdef HAS_FREETYPE
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#endif
+
+#include "../common.h"
+#include "../log.h"
+
+#include "TextRenderer.h"
+
+// Width of the glyph atlas, it grows downward as glyphs are added
+#define TEXT_ATLAS_WIDTH 512
+// Number of font/size combinations to keep rasterized glyphs for
+#define TEXT_MAX_ATLASES 8
+
+TextRenderer TextRenderer::INSTANCE;
+
+// Splits on real newlines and literal "\n" like the ImageMagick path and
+// decodes the UTF-8 into code points
+static void splitLines(const std::string& msg, std::vector<std::vector<uint32_t>>& lines) {
+    lines.clear();
+    lines.emplace_back();
+    size_t x = 0;
+    while (x < msg.size()) {
+        if (msg[x] == '\n') {
+            lines.emplace_back();
+            x++;
+            continue;
+        }
+        if (msg[x] == '\\' && (x + 1) < msg.size() && msg[x + 1] == 'n') {
+            lines.emplace_back();
+            x += 2;
+            continue;
+        }
+        uint8_t c = msg[x];
+        uint32_t cp = '?';
+        int len = 1;
+        if (c < 0x80) {
+            cp = c;
+        } else if ((c & 0xE0) == 0xC0) {
+            cp = c & 0x1F;
+            len = 2;
+        } else if ((c & 0xF0) == 0xE0) {
+            cp = c & 0x0F;
+            len = 3;
+        } else if ((c & 0xF8) == 0xF0) {
+            cp = c & 0x07;
+            len = 4;
+        }
+        if ((x + len) > msg.size()) {
+            cp = '?';
+            len = 1;
+        }
+        for (int i = 1; i < len; i++) {
+            cp = (cp << 6) | (msg[x + i] & 0x3F);
+        }
+        lines.back().push_back(cp);
+        x += len;
+    }
+}
+
+#ifdef HAS_FREETYPE
+class Glyph {
+public:
+    FT_UInt index = 0;
+    int width = 0;
+    int height = 0;
+    int left = 0;
+    int top = 0;
+    int advance = 0;
+    int atlasX = 0;
+    int atlasY = 0;
+};
+
+class GlyphAtlas {
+public:
+    GlyphAtlas(const std::string& f, int sz, bool aa, FT_Face fc) :
+        font(f),
+        size(sz),
+        antialias(aa),
+        face(fc) {
+        hasKerning = FT_HAS_KERNING(face);
+        ascent = (face->size->metrics.ascender + 63) >> 6;
+        descent = (-face->size->metrics.descender + 63) >> 6;
+        lineHeight = std::max((int)(face->size->metrics.height >> 6), ascent + descent);
+    }
+    ~GlyphAtlas() {
+        FT_Done_Face(face);
+    }
+
+    const Glyph& getGlyph(uint32_t cp) {
+        auto it = glyphs.find(cp);
+        if (it != glyphs.end()) {
+            return it->second;
+        }
+        Glyph& g = glyphs[cp];
+        g.index = FT_Get_Char_Index(face, cp);
+        FT_Int32 flags = FT_LOAD_RENDER | (antialias ? FT_LOAD_TARGET_NORMAL : FT_LOAD_TARGET_MONO);
+        if (FT_Load_Glyph(face, g.index, flags)) {
+            return g;
+        }
+        FT_GlyphSlot slot = face->glyph;
+        FT_Bitmap& bm = slot->bitmap;
+        g.width = std::min((int)bm.width, TEXT_ATLAS_WIDTH);
+        g.height = bm.rows;
+        g.left = slot->bitmap_left;
+        g.top = slot->bitmap_top;
+        g.advance = (slot->advance.x + 32) >> 6;
+
+        // simple shelf packing
+        if ((shelfX + g.width) > TEXT_ATLAS_WIDTH) {
+            shelfY += shelfH;
+            shelfX = 0;
+            shelfH = 0;
+        }
+        g.atlasX = shelfX;
+        g.atlasY = shelfY;
+        shelfX += g.width + 1;
+        shelfH = std::max(shelfH, g.height + 1);
+        if (pixels.size() < (size_t)(shelfY + g.height) * TEXT_ATLAS_WIDTH) {
+            pixels.resize((size_t)(shelfY + shelfH) * TEXT_ATLAS_WIDTH, 0);
+        }
+
+        for (int y = 0; y < g.height; y++) {
+            const uint8_t* src = bm.buffer + y * bm.pitch;
+            uint8_t* dst = &pixels[(size_t)(g.atlasY + y) * TEXT_ATLAS_WIDTH + g.atlasX];
+            if (bm.pixel_mode == FT_PIXEL_MODE_MONO) {
+                for (int x = 0; x < g.width; x++) {
+                    dst[x] = ((src[x >> 3] >> (7 - (x & 7))) & 1) ? 255 : 0;
+                }
+            } else {
+                memcpy(dst, src, g.width);
+            }
+        }
+        return g;
+    }
+
+    int kerning(FT_UInt prev, FT_UInt cur) {
+        if (!hasKerning || !prev || !cur) {
+            return 0;
+        }
+        FT_Vector delta;
+        if (FT_Get_Kerning(face, prev, cur, FT_KERNING_DEFAULT, &delta)) {
+            return 0;
+        }
+        return delta.x >> 6;
+    }
+
+    int lineWidth(const std::vector<uint32_t>& line) {
+        int w = 0;
+        FT_UInt prev = 0;
+        for (auto cp : line) {
+            const Glyph& g = getGlyph(cp);
+            w += kerning(prev, g.index) + g.advance;
+            prev = g.index;
+        }
+        return w;
+    }
+
+    std::string font;
+    int size;
+    bool antialias;
+    FT_Face face;
+    bool hasKerning;
+    int ascent;
+    int descent;
+    int lineHeight;
+
+    std::map<uint32_t, Glyph> glyphs;
+    std::vector<uint8_t> pixels;
+    int shelfX = 0;
+    int shelfY = 0;
+    int shelfH = 0;
+};
+
+// c * a / 255, rounded
+static inline uint32_t mul255(uint32_t c, uint32_t a) {
+    uint32_t t = c * a + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+// The inner loop is branch free so it is vectorized (NEON vld3/vst3 on
+// the Pi, SSE on x86) when built with optimization
+static void blitGlyph(const uint8_t* atlas, const Glyph& g, int dx, int dy,
+                      uint8_t* buf, int w, int h, uint32_t r, uint32_t gr, uint32_t b) {
+    int x0 = std::max(0, -dx);
+    int y0 = std::max(0, -dy);
+    int x1 = std::min(g.width, w - dx);
+    int y1 = std::min(g.height, h - dy);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    for (int y = y0; y < y1; y++) {
+        const uint8_t* __restrict src = atlas + (size_t)(g.atlasY + y) * TEXT_ATLAS_WIDTH + g.atlasX;
+        uint8_t* __restrict dst = buf + ((size_t)(dy + y) * w + dx) * 3;
+        for (int x = x0; x < x1; x++) {
+            uint32_t a = src[x];
+            uint8_t* d = dst + x * 3;
+            // lighten so overlapping glyph boxes don't darken each other
+            d[0] = std::max((uint32_t)d[0], mul255(r, a));
+            d[1] = std::max((uint32_t)d[1], mul255(gr, a));
+            d[2] = std::max((uint32_t)d[2], mul255(b, a));
+        }
+    }
+}
+#else
+class GlyphAtlas {};
+#endif
+
+TextRenderer::TextRenderer() {
+}
+TextRenderer::~TextRenderer() {
+#ifdef HAS_FREETYPE
+    for (auto a : m_atlases) {
+        delete a;
+    }
+    m_atlases.clear();
+    if (m_library) {
+        FT_Done_FreeType((FT_Library)m_library);
+    }
+#endif
+}
+
+GlyphAtlas* TextRenderer::getAtlas(const std::string& font, int fontSize, bool antialias) {
+#ifdef HAS_FREETYPE
+    for (auto it = m_atlases.begin(); it != m_atlases.end(); ++it) {
+        GlyphAtlas* a = *it;
+        if (a->size == fontSize && a->antialias == antialias && a->font == font) {
+            if (it != m_atlases.begin()) {
+                m_atlases.erase(it);
+                m_atlases.push_front(a);
+            }
+            return a;
+        }
+    }
+
+    // ImageMagick font names aren't files, leave those to ImageMagick
+    if (font.empty() || font[0] != '/' || !FileExists(font)) {
+        return nullptr;
+    }
+    if (!m_library) {
+        if (m_libraryFailed) {
+            return nullptr;
+        }
+        FT_Library lib;
+        if (FT_Init_FreeType(&lib)) {
+            LogWarn(VB_CHANNELOUT, "Could not initialize FreeType, using ImageMagick for text\n");
+            m_libraryFailed = true;
+            return nullptr;
+        }
+        m_library = lib;
+    }
+    FT_Face face;
+    if (FT_New_Face((FT_Library)m_library, font.c_str(), 0, &face)) {
+        LogDebug(VB_CHANNELOUT, "FreeType could not load font %s\n", font.c_str());
+        return nullptr;
+    }
+    FT_Set_Pixel_Sizes(face, 0, fontSize);
+
+    GlyphAtlas* a = new GlyphAtlas(font, fontSize, antialias, face);
+    m_atlases.push_front(a);
+    if (m_atlases.size() > TEXT_MAX_ATLASES) {
+        delete m_atlases.back();
+        m_atlases.pop_back();
+    }
+    return a;
+#else
+    return nullptr;
+#endif
+}
+
+bool TextRenderer::Measure(const std::string& font, int fontSize, bool antialias,
+                           const std::string& msg, int& width, int& height, int& ascent) {
+#ifdef HAS_FREETYPE
+    std::unique_lock<std::mutex> lock(m_lock);
+    GlyphAtlas* atlas = getAtlas(font, fontSize, antialias);
+    if (!atlas) {
+        return false;
+    }
+    std::vector<std::vector<uint32_t>> lines;
+    splitLines(msg, lines);
+    width = 0;
+    for (auto& l : lines) {
+        width = std::max(width, atlas->lineWidth(l));
+    }
+    height = lines.size() * atlas->lineHeight;
+    ascent = atlas->ascent;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool TextRenderer::Render(const std::string& font, int fontSize, bool antialias,
+                          const std::string& msg, int r, int g, int b,
+                          uint8_t* buf, int w, int h) {
+#ifdef HAS_FREETYPE
+    std::unique_lock<std::mutex> lock(m_lock);
+    GlyphAtlas* atlas = getAtlas(font, fontSize, antialias);
+    if (!atlas) {
+        return false;
+    }
+    std::vector<std::vector<uint32_t>> lines;
+    splitLines(msg, lines);
+
+    int y = (h - (int)lines.size() * atlas->lineHeight) / 2;
+    for (auto& l : lines) {
+        int baseline = y + atlas->ascent;
+        int x = (w - atlas->lineWidth(l)) / 2;
+        FT_UInt prev = 0;
+        for (auto cp : l) {
+            const Glyph& gl = atlas->getGlyph(cp);
+            x += atlas->kerning(prev, gl.index);
+            blitGlyph(atlas->pixels.data(), gl, x + gl.left, baseline - gl.top, buf, w, h, r, g, b);
+            x += gl.advance;
+            prev = gl.index;
+        }
+        y += atlas->lineHeight;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,55 @@
+#pragma once
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include <list>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class GlyphAtlas;
+
+/*
+ * Native text rendering for the overlay Text effect.
+ *
+ * Each font file/size/antialias combination gets a glyph atlas, glyphs
+ * are rasterized with FreeType the first time they are used and then
+ * blitted from the atlas, so updating a clock or score only costs the
+ * layout and blit.  Measure()/Render() return false if the font can't
+ * be handled (not a font file or built without FreeType) so the caller
+ * can fall back to ImageMagick.
+ */
+class TextRenderer {
+public:
+    static TextRenderer INSTANCE;
+
+    TextRenderer();
+    ~TextRenderer();
+
+    // Size of the text block and the ascent of the first line
+    bool Measure(const std::string& font, int fontSize, bool antialias,
+                 const std::string& msg, int& width, int& height, int& ascent);
+
+    // Draws the text, centered, onto an RGB buffer of w x h pixels
+    bool Render(const std::string& font, int fontSize, bool antialias,
+                const std::string& msg, int r, int g, int b,
+                uint8_t* buf, int w, int h);
+
+private:
+    GlyphAtlas* getAtlas(const std::string& font, int fontSize, bool antialias);
+
+    std::mutex m_lock;
+    void* m_library = nullptr;
+    bool m_libraryFailed = false;
+    std::list<GlyphAtlas*> m_atlases;
+};
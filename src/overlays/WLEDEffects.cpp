@@ -452,12 +452,16 @@ public:
         virtual ~RawWLEDEffectInternal() {
             delete wled;
         }
+        // WLED's segments share static buffers and counters
+        virtual bool canRunInParallel() const override {
+            return false;
+        }
         virtual int32_t doIteration() {
             WS2812FXExt::pushCurrent(wled);
             wled->service();
             WS2812FXExt::popCurrent();
 
-            wled->model->flushOverlayBuffer();
+            wled->flushPixels();
             // no sense updating faster than the output
             float f = 1000.0f / GetChannelOutputRefreshRate();
             int i = f;
@@ -958,6 +958,18 @@ public:
     int mapping = 0;
     int brightness = 127;
 
+    // Strip pixels at full brightness in the overlay buffer layout,
+    // pixelOffsets maps a strip index to its byte offset in pixels
+    std::vector<uint8_t> pixels;
+    std::vector<uint32_t> pixelOffsets;
+    uint8_t brightnessLUT[256];
+
+    // pixels if seg maps 1:1 onto the whole strip so it can be written
+    // directly, otherwise nullptr
+    uint8_t *directPixels(Segment &seg);
+    // applies the brightness and pushes pixels to the model
+    void flushPixels();
+
     
     static void pushCurrent(WS2812FXExt *e);
     static void popCurrent();
@@ -326,6 +326,27 @@ void Segment::blurRow(uint16_t row, fract8 blur_amount) {
   uint8_t keep = 255 - blur_amount;
   uint8_t seep = blur_amount >> 1;
   CRGB carryover = CRGB::Black;
+  uint8_t *px = strip().directPixels(*this);
+  if (px) { // FPP: work on the pixel buffer using the precomputed offsets
+    const uint32_t *ofs = strip().pixelOffsets.data();
+    for (uint16_t x = 0; x < cols; x++) {
+      uint8_t *p = px + ofs[row * cols + x];
+      CRGB cur(p[0], p[1], p[2]);
+      CRGB part = cur;
+      part.nscale8(seep);
+      cur.nscale8(keep);
+      cur += carryover;
+      if (x) {
+        uint8_t *q = px + ofs[row * cols + x - 1];
+        q[0] = qadd8(q[0], part.red);
+        q[1] = qadd8(q[1], part.green);
+        q[2] = qadd8(q[2], part.blue);
+      }
+      p[0] = cur.red; p[1] = cur.green; p[2] = cur.blue;
+      carryover = part;
+    }
+    return;
+  }
   for (uint16_t x = 0; x < cols; x++) {
     CRGB cur = getPixelColorXY(x, row);
     CRGB part = cur;
@@ -351,6 +372,27 @@ void Segment::blurCol(uint16_t col, fract8 blur_amount) {
   uint8_t keep = 255 - blur_amount;
   uint8_t seep = blur_amount >> 1;
   CRGB carryover = CRGB::Black;
+  uint8_t *px = strip().directPixels(*this);
+  if (px) { // FPP: work on the pixel buffer using the precomputed offsets
+    const uint32_t *ofs = strip().pixelOffsets.data();
+    for (uint16_t i = 0; i < rows; i++) {
+      uint8_t *p = px + ofs[i * cols + col];
+      CRGB cur(p[0], p[1], p[2]);
+      CRGB part = cur;
+      part.nscale8(seep);
+      cur.nscale8(keep);
+      cur += carryover;
+      if (i) {
+        uint8_t *q = px + ofs[(i-1) * cols + col];
+        q[0] = qadd8(q[0], part.red);
+        q[1] = qadd8(q[1], part.green);
+        q[2] = qadd8(q[2], part.blue);
+      }
+      p[0] = cur.red; p[1] = cur.green; p[2] = cur.blue;
+      carryover = part;
+    }
+    return;
+  }
   for (uint16_t i = 0; i < rows; i++) {
     CRGB cur = getPixelColorXY(col, i);
     CRGB part = cur;
@@ -1110,6 +1110,17 @@ void Segment::refreshLightCapabilities() {
  * Fills segment with color
  */
 void Segment::fill(uint32_t c) {
+  uint8_t *px = strip().directPixels(*this);
+  if (px) { // FPP: segment is the whole strip, write the pixel buffer directly
+    const size_t len = strip().pixels.size();
+    const uint8_t r = R(c), g = G(c), b = B(c);
+    if (r == g && g == b) {
+      memset(px, r, len);
+    } else {
+      for (size_t i = 0; i < len; i += 3) { px[i] = r; px[i+1] = g; px[i+2] = b; }
+    }
+    return;
+  }
   const uint16_t cols = is2D() ? virtualWidth() : virtualLength();
   const uint16_t rows = virtualHeight(); // will be 1 for 1D
   for(uint16_t y = 0; y < rows; y++) for (uint16_t x = 0; x < cols; x++) {
@@ -1149,6 +1160,20 @@ void Segment::fade_out(uint8_t rate) {
   int g2 = G(color);
   int b2 = B(color);
 
+  uint8_t *px = strip().directPixels(*this);
+  if (px) { // FPP: same math per channel directly on the pixel buffer
+    const int target[3] = {r2, g2, b2};
+    const size_t len = strip().pixels.size();
+    for (size_t i = 0; i < len; i++) {
+      int v1 = px[i];
+      int v2 = target[i % 3];
+      int delta = (v2 - v1) / mappedRate;
+      delta += (v2 == v1) ? 0 : (v2 > v1) ? 1 : -1;
+      px[i] = v1 + delta;
+    }
+    return;
+  }
+
   for (uint16_t y = 0; y < rows; y++) for (uint16_t x = 0; x < cols; x++) {
     color = is2D() ? getPixelColorXY(x, y) : getPixelColor(x);
     int w1 = W(color);
@@ -1177,6 +1202,13 @@ void Segment::fadeToBlackBy(uint8_t fadeBy) {
   const uint16_t cols = is2D() ? virtualWidth() : virtualLength();
   const uint16_t rows = virtualHeight(); // will be 1 for 1D
 
+  uint8_t *px = strip().directPixels(*this);
+  if (px) { // FPP: scale the pixel buffer in place
+    const size_t len = strip().pixels.size();
+    for (size_t i = 0; i < len; i += 3) nscale8x3(px[i], px[i+1], px[i+2], 255-fadeBy);
+    return;
+  }
+
   for (uint16_t y = 0; y < rows; y++) for (uint16_t x = 0; x < cols; x++) {
     if (is2D()) setPixelColorXY(x, y, CRGB(getPixelColorXY(x,y)).nscale8(255-fadeBy));
     else        setPixelColor(x, CRGB(getPixelColor(x)).nscale8(255-fadeBy));
@@ -1201,6 +1233,28 @@ void Segment::blur(uint8_t blur_amount)
   uint8_t keep = 255 - blur_amount;
   uint8_t seep = blur_amount >> 1;
   CRGB carryover = CRGB::Black;
+  uint8_t *px = strip().directPixels(*this);
+  if (px) { // FPP: blur along the strip order using the precomputed offsets
+    const uint32_t *ofs = strip().pixelOffsets.data();
+    const uint16_t len = virtualLength();
+    for (uint16_t i = 0; i < len; i++) {
+      uint8_t *p = px + ofs[i];
+      CRGB cur(p[0], p[1], p[2]);
+      CRGB part = cur;
+      part.nscale8(seep);
+      cur.nscale8(keep);
+      cur += carryover;
+      if (i > 0) {
+        uint8_t *q = px + ofs[i-1];
+        q[0] = qadd8(q[0], part.red);
+        q[1] = qadd8(q[1], part.green);
+        q[2] = qadd8(q[2], part.blue);
+      }
+      p[0] = cur.red; p[1] = cur.green; p[2] = cur.blue;
+      carryover = part;
+    }
+    return;
+  }
   for(uint16_t i = 0; i < virtualLength(); i++)
   {
     CRGB cur = CRGB(getPixelColor(i));
@@ -25,8 +25,7 @@
 #include "fcn_declare.h"
 #include "wled.h"
 
-#include "kiss_fftr.h"
-#include "../../mediaoutput/SDLOut.h"
+#include "../../mediaoutput/AudioAnalysis.h"
 
 uint16_t rand16seed = 0;
 time_t localTime = time(nullptr);
@@ -95,54 +94,7 @@ uint32_t get_millisecond_timer() {
     return GetTimeMS();
 }
 
-constexpr int NUM_SAMPLES = 1024;
-
-// RMS average
-static float fftAddAvgRMS(int from, int to, float* samples) {
-    double result = 0.0;
-    for (int i = from; i <= to; i++) {
-        result += samples[i] * samples[i];
-    }
-    return sqrtf(result / float(to - from + 1));
-}
-
-static float fftAddAvg(int from, int to, float* samples) {
-    if (from == to)
-        return samples[from];               // small optimization
-    return fftAddAvgRMS(from, to, samples); // use SMS
-}
-static float mapf(float x, float in_min, float in_max, float out_min, float out_max) {
-    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
-}
-
-/*
-static void GenerateSinWave(std::array<float, NUM_SAMPLES> &samples, float sampleRate, float frequency = 440)
-{
-    float sampleDurationSeconds = 1.0 / sampleRate;
-    for (int i = 0; i < NUM_SAMPLES; ++i) {
-        double sampleTime = (float)(i) * sampleDurationSeconds;
-        samples[i] = std::sin(2.0 * 3.14159 * frequency * sampleTime);
-    }
-}
-void HammingWindow(std::array<float, NUM_SAMPLES> &samples)
-{
-    static const double a0 = 25.0 / 46.0;
-    static const double a1 = 1 - a0;
-    for (int i = 0; i < NUM_SAMPLES; ++i)
-        samples[i] *= a0 - a1 * cos((2.0 * 3.14159 * i) / NUM_SAMPLES);
-}
-*/
-
-static um_data_t* processSamples(std::array<float, NUM_SAMPLES>& samples, int sampleRate) {
-    static kiss_fft_cpx fft_out[NUM_SAMPLES];
-    static kiss_fftr_cfg cfg = kiss_fftr_alloc(NUM_SAMPLES, false, 0, 0);
-
-    //GenerateSinWave(samples, sampleRate);
-    //HammingWindow(samples);
-
-    // compute fast fourier transform
-    kiss_fftr(cfg, (kiss_fft_scalar*)&samples[0], fft_out);
-
+static um_data_t* processAnalysis(const AudioAnalysisSnapshot& snapshot) {
     static uint8_t samplePeak;
     static float FFT_MajorPeak;
     static uint8_t maxVol;
@@ -150,7 +102,7 @@ static um_data_t* processSamples(std::array<float, NUM_SAMPLES>& samples, int sa
     static float volumeSmth;
     static uint16_t volumeRaw;
     static float my_magnitude;
-    //arrays
+
     static um_data_t* um_data = nullptr;
     if (!um_data) {
         // initialize um_data pointer structure
@@ -170,68 +122,22 @@ static um_data_t* processSamples(std::array<float, NUM_SAMPLES>& samples, int sa
         um_data->u_data[7] = &binNum;
     }
 
-    std::array<float, 17> res;
-    for (int x = 0; x < 16; x++) {
-        res[x] = 0;
-    }
-    float rate = sampleRate;
-    int curBucket = 0;
-    double freqnext = 440.0 * exp2f(((float)((1 + 1) * 8) - 69.0) / 12.0);
-    int end = freqnext * (float)NUM_SAMPLES / rate;
-    float binHzRange = rate / (float)NUM_SAMPLES;
-
-    float maxValue = 0;
-    int maxBin = 0;
-    int maxBucket = 0;
-    for (int bin = 0; bin < (NUM_SAMPLES / 2); ++bin) {
-        if (bin > end) {
-            curBucket++;
-            if (curBucket == 18) {
-                break;
-            }
-            freqnext = 440.0 * exp2f(((double)((curBucket + 1) * 8) - 69.0) / 12.0);
-            end = freqnext * (double)NUM_SAMPLES / rate;
-        }
-        float nv = sqrtf(fft_out[bin].r * fft_out[bin].r + fft_out[bin].i * fft_out[bin].i);
-        if (nv > maxValue) {
-            maxValue = nv;
-            maxBin = bin;
-            maxBucket = curBucket;
-        }
-        res[curBucket] = std::max(res[curBucket], nv);
-    }
-
     uint8_t* fftResult = (uint8_t*)um_data->u_data[2];
-    float maxFreq = (maxBin * binHzRange) + (binHzRange / 2);
-    int maxIdx = maxBin;
+    memcpy(fftResult, snapshot.bandLevels, 16);
 
-    //printf("Max: %0.5f Hz   idx: %d\n", maxFreq, maxIdx);
-    int maxV = 0;
     float maxRV = 0;
     for (int x = 0; x < 16; x++) {
-        int v2 = round(log10(res[x]) * 120.0);
-        if (v2 > 255) {
-            v2 = 255;
-        }
-        if (v2 < 0) {
-            v2 = 0;
-        }
-        //printf("%d:   %0.2f  %0.2f    %d\n", x, res[x], (float)log10(res[x]), v2);
-        maxV = std::max(maxV, v2);
-        maxRV = std::max(maxRV, res[x]);
-        fftResult[x] = v2;
+        maxRV = std::max(maxRV, snapshot.bands[x]);
     }
-    //printf("\n");
-    //volumeSmth = max * 127.0;
 
-    FFT_MajorPeak = maxFreq;
+    FFT_MajorPeak = snapshot.majorPeakFreq;
     my_magnitude = maxRV;
-    maxVol = maxV;
-    binNum = maxBucket;
+    maxVol = snapshot.maxBandLevel;
+    binNum = snapshot.majorPeakBand;
 
-    volumeSmth = maxFreq;
+    volumeSmth = snapshot.majorPeakFreq;
     volumeRaw = volumeSmth;
-    samplePeak = random8() > 250;
+    samplePeak = snapshot.beat;
     if (volumeSmth < 1)
         my_magnitude = 0.001f;
 
@@ -246,10 +152,9 @@ typedef enum UM_SoundSimulations {
     UMS_14_3
 } um_soundSimulations_t;
 um_data_t* simulateSound(uint8_t simulationId) {
-    std::array<float, NUM_SAMPLES> samples;
-    int sampleRate = 0;
-    if (SDLOutput::GetAudioSamples(&samples[0], NUM_SAMPLES, sampleRate)) {
-        return processSamples(samples, sampleRate);
+    AudioAnalysisSnapshot snapshot;
+    if (AudioAnalysis::INSTANCE.GetSnapshot(snapshot)) {
+        return processAnalysis(snapshot);
     }
 
     static uint8_t samplePeak;
@@ -410,6 +315,30 @@ WS2812FXExt::WS2812FXExt(PixelOverlayModel* m, int map, int b,
                          const std::string& text) :
     WS2812FX(), model(m), mapping(map), brightness(b) {
     WS2812FXExt::pushCurrent(this);
+    int w = m->getWidth();
+    int h = m->getHeight();
+    pixels.resize(w * h * 3);
+    pixelOffsets.resize(w * h);
+    for (int i = 0; i < w * h; i++) {
+        int x, y;
+        if (mapping == 1 || mapping == 3) {
+            y = i % h;
+            x = i / h;
+        } else {
+            x = i % w;
+            y = i / w;
+        }
+        if (mapping == 2) {
+            y = h - y - 1;
+        }
+        if (mapping == 3) {
+            x = w - x - 1;
+        }
+        pixelOffsets[i] = (y * w + x) * 3;
+    }
+    for (int v = 0; v < 256; v++) {
+        brightnessLUT[v] = min(v * brightness / 128, 255);
+    }
     if (m->getWidth() > 1 && m->getHeight() > 1) {
         isMatrix = true;
     }
@@ -474,61 +403,61 @@ void WS2812FXExt::popCurrent() {
     }
 }
 
-int Bus::getLength() {
-    if (currentStrip->model) {
-        return currentStrip->model->getWidth() * currentStrip->model->getHeight();
+uint8_t* WS2812FXExt::directPixels(Segment& seg) {
+    // FPP doesn't load custom ledmaps so only the segment itself can remap
+    if (pixels.empty() || seg.leds || seg.start != 0 || seg.startY != 0 || seg.offset != 0) {
+        return nullptr;
     }
-    return 1;
-}
-uint32_t Bus::getPixelColor(int i) {
-    int x, y;
-    int w = currentStrip->model->getWidth();
-    int h = currentStrip->model->getHeight();
-    int mapping = currentStrip->mapping;
-    if (mapping == 1 || mapping == 3) {
-        y = i % h;
-        x = i / h;
-    } else {
-        x = i % w;
-        y = i / w;
+    if (seg.reverse || seg.reverse_y || seg.mirror || seg.mirror_y || seg.transpose || seg.groupLength() != 1) {
+        return nullptr;
     }
-
-    if (mapping == 2) {
-        y = h - y - 1;
+    if ((size_t)seg.width() * seg.height() != pixelOffsets.size() || (!seg.is2D() && seg.height() != 1)) {
+        return nullptr;
     }
-    if (mapping == 3) {
-        x = w - x - 1;
+    if (seg.currentBri(seg.on ? seg.opacity : 0) != 255) {
+        return nullptr;
     }
-
-    int r, g, b;
-    currentStrip->model->getOverlayPixelValue(x, y, r, g, b);
-    return (r << 16) | (g << 8) | b;
+    return pixels.data();
 }
-void Bus::setPixelColor(int i, uint32_t c) {
-    int x, y;
-    int w = currentStrip->model->getWidth();
-    int h = currentStrip->model->getHeight();
-    int mapping = currentStrip->mapping;
-    if (mapping == 1 || mapping == 3) {
-        y = i % h;
-        x = i / h;
+
+void WS2812FXExt::flushPixels() {
+    if (!model || pixels.empty()) {
+        return;
+    }
+    uint8_t* buf = model->getOverlayBuffer();
+    if (brightness == 128) {
+        memcpy(buf, pixels.data(), pixels.size());
     } else {
-        x = i % w;
-        y = i / w;
+        for (size_t i = 0; i < pixels.size(); i++) {
+            buf[i] = brightnessLUT[pixels[i]];
+        }
     }
+    model->markOverlayBufferDirty(0, 0, model->getWidth(), model->getHeight());
+    model->flushOverlayBuffer();
+}
 
-    if (mapping == 2) {
-        y = h - y - 1;
+int Bus::getLength() {
+    if (!currentStrip->pixelOffsets.empty()) {
+        return currentStrip->pixelOffsets.size();
     }
-    if (mapping == 3) {
-        x = w - x - 1;
+    return 1;
+}
+uint32_t Bus::getPixelColor(int i) {
+    WS2812FXExt* s = currentStrip;
+    if (i < 0 || i >= (int)s->pixelOffsets.size()) {
+        return 0;
+    }
+    const uint8_t* p = &s->pixels[s->pixelOffsets[i]];
+    return (p[0] << 16) | (p[1] << 8) | p[2];
+}
+void Bus::setPixelColor(int i, uint32_t c) {
+    WS2812FXExt* s = currentStrip;
+    if (i < 0 || i >= (int)s->pixelOffsets.size()) {
+        return;
     }
-    int r = R(c);
-    int g = G(c);
-    int b = B(c);
-    int brightness = currentStrip->brightness;
-    r = r * brightness / 128;
-    g = g * brightness / 128;
-    b = b * brightness / 128;
-    currentStrip->model->setOverlayPixelValue(x, y, min(r, 255), min(g, 255), min(b, 255));
+    // brightness is applied once per frame in flushPixels()
+    uint8_t* p = &s->pixels[s->pixelOffsets[i]];
+    p[0] = R(c);
+    p[1] = G(c);
+    p[2] = B(c);
 }
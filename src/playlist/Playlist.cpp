@@ -65,6 +65,10 @@ Playlist::Playlist(Playlist* parent) :
     m_startTime(0),
     m_subPlaylistDepth(0),
     m_forceStop(0),
+    m_lookAheadMS(0),
+    m_prefetchEntry(nullptr),
+    m_prefetchElapsed(0),
+    m_prefetchDone(false),
     m_fileTime(0),
     m_configTime(0),
     m_currentState("idle"),
@@ -528,6 +532,8 @@ int Playlist::Start(void) {
     m_startTime = GetTime();
     m_loop = 0;
     m_forceStop = 0;
+    m_lookAheadMS = getSettingInt("PlaylistLookAhead", 5) * 1000;
+    m_prefetchEntry = nullptr;
 
     LogDebug(VB_PLAYLIST, "============================================================================\n");
 
@@ -721,6 +727,9 @@ int Playlist::Process(void) {
 
     if (!m_currentSection->at(m_sectionPosition)->IsPaused() && m_currentSection->at(m_sectionPosition)->IsPlaying()) {
         m_currentSection->at(m_sectionPosition)->Process();
+
+        if (m_lookAheadMS > 0 && m_currentSection->at(m_sectionPosition)->IsPlaying())
+            PrefetchNextEntry();
     }
 
     Playlist* pl = nullptr;
@@ -892,6 +901,82 @@ int Playlist::Process(void) {
     return 1;
 }
 
+/*
+ * Entry that will be started when the current entry finishes, nullptr if
+ * that can't be known ahead of time (branches, random reshuffles, inserted
+ * playlists) or the playlist will stop.
+ */
+PlaylistEntryBase* Playlist::GetNextEntry(void) {
+    if (m_status != FPP_STATUS_PLAYLIST_PLAYING || m_insertedPlaylist != "")
+        return nullptr;
+
+    if (m_stopAtPos != -1 && m_stopAtPos <= (GetPosition() - 1))
+        return nullptr;
+
+    if (m_currentSection->at(m_sectionPosition)->GetNextBranchType() != PlaylistEntryBase::PlaylistBranchType::NoBranch)
+        return nullptr;
+
+    if ((m_sectionPosition + 1) < m_currentSection->size())
+        return m_currentSection->at(m_sectionPosition + 1);
+
+    if (m_currentSectionStr == "LeadIn") {
+        if (m_mainPlaylist.size())
+            return m_mainPlaylist[0];
+        if (m_leadOut.size())
+            return m_leadOut[0];
+    } else if (m_currentSectionStr == "MainPlaylist") {
+        if ((m_repeat) && (!m_loopCount || ((m_loop + 1) < m_loopCount))) {
+            if (m_random != 2)
+                return m_mainPlaylist[0];
+        } else if (m_leadOut.size()) {
+            return m_leadOut[0];
+        }
+    }
+
+    return nullptr;
+}
+
+/*
+ * Give the next entry a chance to open and warm up its files once the
+ * current entry is within the look ahead window of its end.
+ */
+void Playlist::PrefetchNextEntry(void) {
+    PlaylistEntryBase* currentEntry = m_currentSection->at(m_sectionPosition);
+    uint64_t length = currentEntry->GetLengthInMS();
+    if (!length)
+        return;
+
+    uint64_t elapsed = currentEntry->GetElapsedMS();
+    if ((currentEntry != m_prefetchEntry) || (elapsed < m_prefetchElapsed)) {
+        // New entry, or the same entry started again
+        m_prefetchEntry = currentEntry;
+        m_prefetchDone = false;
+    }
+    m_prefetchElapsed = elapsed;
+
+    if (m_prefetchDone || ((elapsed + m_lookAheadMS) < length))
+        return;
+
+    m_prefetchDone = true;
+
+    PlaylistEntryBase* nextEntry = GetNextEntry();
+    if (nextEntry && nextEntry->IsEnabled()) {
+        LogDebug(VB_PLAYLIST, "Prefetching next %s entry with %llu ms remaining\n",
+                 nextEntry->GetType().c_str(), (unsigned long long)(length - elapsed));
+        nextEntry->Prefetch();
+    }
+}
+
+/*
+ * Throw away what was prefetched for the next entry when playback
+ * stops or jumps somewhere else
+ */
+void Playlist::CancelPrefetch(void) {
+    m_prefetchEntry = nullptr;
+    m_prefetchDone = false;
+    ClearPrerolledMediaOutput();
+}
+
 bool Playlist::WillStopAfterCurrent() {
     if ((m_sectionPosition + 1) >= m_currentSection->size()) {
         if (m_currentSectionStr == "LeadIn") {
@@ -957,6 +1042,7 @@ void Playlist::SetIdle(bool exit) {
     m_status = FPP_STATUS_IDLE;
     m_currentState = "idle";
 
+    CancelPrefetch();
     Cleanup();
 
     PluginManager::INSTANCE.playlistCallback(GetInfo(), "stop", m_currentSectionStr, m_sectionPosition);
@@ -1225,6 +1311,7 @@ void Playlist::RestartItem(void) {
     if (m_currentSection->at(m_sectionPosition)->IsPlaying())
         m_currentSection->at(m_sectionPosition)->Stop();
 
+    CancelPrefetch();
     m_sectionPosition = 0;
     m_startPosition = pos;
     Start();
@@ -1278,6 +1365,7 @@ void Playlist::NextItem(void) {
     if (m_currentSection->at(m_sectionPosition)->IsPlaying())
         m_currentSection->at(m_sectionPosition)->Stop();
 
+    CancelPrefetch();
     if (somewhereToGo) {
         pos--;
         m_sectionPosition = 0;
@@ -1321,6 +1409,7 @@ void Playlist::PrevItem(void) {
     if (m_currentSection->at(m_sectionPosition)->IsPlaying())
         m_currentSection->at(m_sectionPosition)->Stop();
 
+    CancelPrefetch();
     m_sectionPosition = 0;
     m_startPosition = pos - 1;
     Start();
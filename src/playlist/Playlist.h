@@ -108,6 +108,9 @@ private:
     void SwitchToLeadOut(void);
 
     bool WillStopAfterCurrent();
+    PlaylistEntryBase* GetNextEntry(void);
+    void PrefetchNextEntry(void);
+    void CancelPrefetch(void);
     Playlist* SwitchToInsertedPlaylist(bool isStopping = false);
 
     volatile PlaylistStatus m_status;
@@ -129,6 +132,11 @@ private:
     int m_forceStop;
     int m_stopAtPos;
 
+    int m_lookAheadMS;
+    PlaylistEntryBase* m_prefetchEntry;
+    uint64_t m_prefetchElapsed;
+    bool m_prefetchDone;
+
     time_t m_fileTime;
     Json::Value m_config;
     time_t m_configTime;
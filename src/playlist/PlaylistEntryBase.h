@@ -30,6 +30,9 @@ public:
     virtual int IsFinished(void);
 
     virtual int Prep(void);
+    // Called shortly before the entry is expected to start so it can warm
+    // up any files it will need
+    virtual void Prefetch(void) {}
     virtual int Process(void);
     virtual int Stop(void);
 
@@ -52,6 +55,7 @@ public:
 
     std::string GetType(void) { return m_type; }
     int IsPrepped(void) { return m_isPrepped; }
+    int IsEnabled(void) { return m_enabled; }
 
     enum class PlaylistBranchType {
         NoBranch,
@@ -114,6 +114,17 @@ int PlaylistEntryBoth::StartPlaying(void) {
     return PlaylistEntryBase::StartPlaying();
 }
 
+/*
+ *
+ */
+void PlaylistEntryBoth::Prefetch(void) {
+    std::unique_lock<std::recursive_mutex> seqLock(m_mutex);
+    if (m_mediaEntry)
+        m_mediaEntry->Prefetch();
+    if (m_sequenceEntry)
+        m_sequenceEntry->Prefetch();
+}
+
 /*
  *
  */
@@ -27,6 +27,7 @@ public:
 
     virtual int StartPlaying(void) override;
     virtual int Process(void) override;
+    virtual void Prefetch(void) override;
     virtual int Stop(void) override;
 
     virtual void Dump(void) override;
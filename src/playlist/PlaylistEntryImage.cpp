@@ -18,6 +18,8 @@
 
 #include "PlaylistEntryImage.h"
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <filesystem>
 using namespace std::filesystem;
@@ -27,6 +29,15 @@ using namespace Magick;
 
 #include "overlays/PixelOverlay.h"
 
+// Decoded and scaled images kept in memory, shared by all image entries
+#define IMAGE_MEMORY_CACHE_BYTES (64 * 1024 * 1024)
+// Number of upcoming images decoded in the background
+#define IMAGE_WARM_AHEAD 2
+
+static std::mutex imageCacheLock;
+static std::list<std::pair<std::string, std::shared_ptr<std::vector<uint8_t>>>> imageCache;
+static size_t imageCacheBytes = 0;
+
 void StartPrepLoopThread(PlaylistEntryImage* fb);
 
 /*
@@ -222,17 +233,26 @@ void PlaylistEntryImage::SetFileList(void) {
 const std::string PlaylistEntryImage::GetNextFile(void) {
     std::string result;
 
-    if (!m_files.size())
-        SetFileList();
+    // files are picked a few ahead so they can be decoded in the background
+    while (m_upcoming.size() <= IMAGE_WARM_AHEAD) {
+        if (!m_files.size())
+            SetFileList();
+
+        if (!m_files.size())
+            break;
+
+        int i = rand_r(&m_fileSeed) % m_files.size();
+        m_upcoming.push_back(m_files[i]);
+        m_files.erase(m_files.begin() + i);
+    }
 
-    if (!m_files.size()) {
+    if (!m_upcoming.size()) {
         LogWarn(VB_PLAYLIST, "No files found in GetNextFile()\n");
         return result;
     }
 
-    int i = rand_r(&m_fileSeed) % m_files.size();
-    result = m_files[i];
-    m_files.erase(m_files.begin() + i);
+    result = m_upcoming.front();
+    m_upcoming.pop_front();
 
     if (!FileExists(result))
         return GetNextFile(); // Recurse to handle refilling empty list
@@ -246,9 +266,6 @@ const std::string PlaylistEntryImage::GetNextFile(void) {
  *
  */
 void PlaylistEntryImage::PrepImage(void) {
-    Image image;
-    Blob blob;
-    bool needToCache = true;
     std::string nextFile = GetNextFile();
 
     if (nextFile == "")
@@ -259,83 +276,36 @@ void PlaylistEntryImage::PrepImage(void) {
         return;
     }
 
+    // decode before taking the lock so Draw() isn't held up
+    std::shared_ptr<std::vector<uint8_t>> image = GetImage(nextFile);
+
     m_bufferLock.lock();
 
     m_nextFileName = nextFile;
 
-    memset(m_buffer, 0, m_bufferSize);
-
-    try {
-        int cols = 0;
-        int rows = 0;
-
-        needToCache = false;
-        image.quiet(true); // Squelch warning exceptions
-
-        if (GetImageFromCache(nextFile, image)) {
-            cols = image.columns();
-            rows = image.rows();
-        }
-
-        if ((cols != m_width) || (rows != m_height)) {
-            image.read(nextFile.c_str());
-            cols = image.columns();
-            rows = image.rows();
-        }
-
-        if ((cols != m_width) && (rows != m_height)) {
-            needToCache = true;
-
-#ifndef OLDGRAPHICSMAGICK
-//			image.autoOrient();
-#endif
-
-            image.modifyImage();
-
-            // Resize to slightly larger since trying to get exact can
-            // leave us off by one pixel.  Going slightly larger will let
-            // us crop to exact size later.
-            image.resize(Geometry(m_width + 2, m_height + 2, 0, 0));
-
-            cols = image.columns();
-            rows = image.rows();
-
-            if (cols < m_width) // center horizontally
-            {
-                int diff = m_width - cols;
-
-                image.borderColor(Color("black"));
-                image.border(Geometry(diff / 2 + 1, 1, 0, 0));
-            } else if (rows < m_height) // center vertically
-            {
-                int diff = m_height - rows;
-
-                image.borderColor(Color("black"));
-                image.border(Geometry(1, diff / 2 + 1, 0, 0));
-            }
-
-            image.crop(Geometry(m_width, m_height, 1, 1));
-        }
-
-        image.type(TrueColorType);
-
-        if (needToCache) {
-            CacheImage(nextFile, image);
-        }
-
-        image.magick("RGB");
-        image.write(&blob);
-
-        memcpy(m_buffer, blob.data(), m_bufferSize);
-    } catch (Exception& error_) {
-        LogErr(VB_PLAYLIST, "GraphicsMagick exception reading %s: %s\n",
-               nextFile.c_str(), error_.what());
+    if (image) {
+        memcpy(m_buffer, image->data(), m_bufferSize);
+    } else {
+        memset(m_buffer, 0, m_bufferSize);
     }
 
     m_bufferLock.unlock();
     m_imagePrepped = true;
 }
 
+/*
+ * Make sure the next few images are in the cache
+ */
+void PlaylistEntryImage::WarmUpcoming(void) {
+    int count = 0;
+    for (auto& f : m_upcoming) {
+        if (!m_runLoop || count++ >= IMAGE_WARM_AHEAD)
+            break;
+
+        GetImage(f);
+    }
+}
+
 /*
  *
  */
@@ -375,6 +345,7 @@ void PlaylistEntryImage::PrepLoop(void) {
             lock.unlock();
 
             PrepImage();
+            WarmUpcoming();
             lock.lock();
         }
 
@@ -383,62 +354,170 @@ void PlaylistEntryImage::PrepLoop(void) {
 }
 
 /*
- *
+ * Images are cached scaled to the model size in the model's RGB layout so
+ * they can be copied straight into the buffer.  The key covers the file's
+ * path, modification time and size and the target size.
  */
-std::string PlaylistEntryImage::GetCacheFileName(std::string fileName) {
-    std::size_t found = fileName.find_last_of("/");
-    std::string baseFile = fileName.substr(found + 1);
-    std::string result = m_cacheDir;
+std::string PlaylistEntryImage::GetCacheKey(const std::string& fileName) {
+    struct stat st;
 
-    result += "/pei-";
-    result += baseFile;
-    result += ".png";
+    if (stat(fileName.c_str(), &st))
+        return "";
 
-    return result;
+    char key[96];
+    snprintf(key, sizeof(key), "%016llx-%llx-%llx-%dx%d",
+             (unsigned long long)std::hash<std::string>()(fileName),
+             (unsigned long long)st.st_mtime, (unsigned long long)st.st_size,
+             m_width, m_height);
+
+    return key;
+}
+
+std::string PlaylistEntryImage::GetCacheFileName(const std::string& key) {
+    return m_cacheDir + "/pei-" + key + ".rgb";
 }
 
 /*
- *
+ * Get an image from the memory cache, the disk cache or by decoding it,
+ * in that order.  Returns nullptr if the image couldn't be read.
  */
-bool PlaylistEntryImage::GetImageFromCache(std::string fileName, Image& image) {
-    std::string cacheFile = GetCacheFileName(fileName);
-    struct stat os;
-    struct stat cs;
-
-    if (FileExists(cacheFile)) {
-        stat(fileName.c_str(), &os);
-        stat(cacheFile.c_str(), &cs);
-
-        if (os.st_mtime > cs.st_mtime)
-            return false;
-
-        try {
-            image.read(cacheFile.c_str());
-        } catch (Exception& error_) {
-            LogErr(VB_PLAYLIST, "GraphicsMagick exception reading %s: %s\n",
-                   cacheFile.c_str(), error_.what());
+std::shared_ptr<std::vector<uint8_t>> PlaylistEntryImage::GetImage(const std::string& fileName) {
+    std::string key = GetCacheKey(fileName);
+
+    if (key == "")
+        return nullptr;
+
+    std::unique_lock<std::mutex> lock(imageCacheLock);
+    for (auto it = imageCache.begin(); it != imageCache.end(); ++it) {
+        if (it->first == key) {
+            std::shared_ptr<std::vector<uint8_t>> data = it->second;
+            imageCache.splice(imageCache.begin(), imageCache, it);
+            return data;
+        }
+    }
+    lock.unlock();
+
+    std::shared_ptr<std::vector<uint8_t>> data = std::make_shared<std::vector<uint8_t>>(m_bufferSize);
+    std::string cacheFile = GetCacheFileName(key);
+    bool loaded = false;
+
+    int fd = open(cacheFile.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        loaded = (read(fd, data->data(), m_bufferSize) == m_bufferSize);
+        close(fd);
+    }
+
+    if (!loaded) {
+        if (!DecodeImage(fileName, data->data()))
+            return nullptr;
+
+        // write then rename so another reader never sees a partial file
+        std::string tmpFile = cacheFile + ".tmp";
+        fd = open(tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            bool ok = (write(fd, data->data(), m_bufferSize) == m_bufferSize);
+            close(fd);
+            if (ok && !rename(tmpFile.c_str(), cacheFile.c_str())) {
+                CleanupCache();
+            } else {
+                unlink(tmpFile.c_str());
+            }
         }
+    }
 
-        return true;
+    lock.lock();
+    imageCache.emplace_front(key, data);
+    imageCacheBytes += data->size();
+    while (imageCacheBytes > IMAGE_MEMORY_CACHE_BYTES && imageCache.size() > 1) {
+        imageCacheBytes -= imageCache.back().second->size();
+        imageCache.pop_back();
     }
 
-    return false;
+    return data;
 }
 
 /*
- *
+ * Decode and scale an image with GraphicsMagick into an RGB buffer
+ * of m_width x m_height
  */
-void PlaylistEntryImage::CacheImage(std::string fileName, Image& image) {
-    std::string cacheFile = GetCacheFileName(fileName);
+bool PlaylistEntryImage::DecodeImage(const std::string& fileName, uint8_t* buffer) {
+    Image image;
+    Blob blob;
 
-    image.write(cacheFile.c_str());
+    memset(buffer, 0, m_bufferSize);
 
-    CleanupCache();
+    try {
+        image.quiet(true); // Squelch warning exceptions
+        image.read(fileName.c_str());
+
+        int cols = image.columns();
+        int rows = image.rows();
+
+        if ((cols != m_width) && (rows != m_height)) {
+#ifndef OLDGRAPHICSMAGICK
+//			image.autoOrient();
+#endif
+
+            image.modifyImage();
+
+            // Resize to slightly larger since trying to get exact can
+            // leave us off by one pixel.  Going slightly larger will let
+            // us crop to exact size later.
+            image.resize(Geometry(m_width + 2, m_height + 2, 0, 0));
+
+            cols = image.columns();
+            rows = image.rows();
+
+            if (cols < m_width) // center horizontally
+            {
+                int diff = m_width - cols;
+
+                image.borderColor(Color("black"));
+                image.border(Geometry(diff / 2 + 1, 1, 0, 0));
+            } else if (rows < m_height) // center vertically
+            {
+                int diff = m_height - rows;
+
+                image.borderColor(Color("black"));
+                image.border(Geometry(1, diff / 2 + 1, 0, 0));
+            }
+
+            image.crop(Geometry(m_width, m_height, 1, 1));
+        }
+
+        image.type(TrueColorType);
+        image.magick("RGB");
+        image.write(&blob);
+
+        memcpy(buffer, blob.data(), std::min((size_t)m_bufferSize, (size_t)blob.length()));
+    } catch (Exception& error_) {
+        LogErr(VB_PLAYLIST, "GraphicsMagick exception reading %s: %s\n",
+               fileName.c_str(), error_.what());
+        return false;
+    }
+
+    return true;
 }
 
 /*
- *
+ * Keep the newest m_cacheEntries cached images
  */
 void PlaylistEntryImage::CleanupCache(void) {
-    // FIXME
+    std::vector<std::pair<file_time_type, std::string>> files;
+    std::error_code ec;
+
+    for (auto& cp : directory_iterator(m_cacheDir, ec)) {
+        std::string name = cp.path().filename().string();
+        if (startsWith(name, "pei-"))
+            files.emplace_back(last_write_time(cp.path(), ec), cp.path().string());
+    }
+
+    if (files.size() <= m_cacheEntries)
+        return;
+
+    std::sort(files.begin(), files.end());
+    for (int i = 0; i < files.size() - m_cacheEntries; i++) {
+        LogDebug(VB_PLAYLIST, "Removing cached image %s\n", files[i].second.c_str());
+        remove(files[i].second, ec);
+    }
 }
@@ -13,19 +13,17 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "overlays/PixelOverlayModel.h"
 #include "PlaylistEntryBase.h"
 
-namespace Magick
-{
-    class Image;
-};
-
 class PlaylistEntryImage : public PlaylistEntryBase {
 public:
     PlaylistEntryImage(Playlist* playlist, PlaylistEntryBase* parent = NULL);
@@ -48,12 +46,14 @@ private:
 
     const std::string GetNextFile(void);
     void PrepImage(void);
+    void WarmUpcoming(void);
 
     void Draw(void);
 
-    std::string GetCacheFileName(std::string fileName);
-    bool GetImageFromCache(std::string fileName, Magick::Image& image);
-    void CacheImage(std::string fileName, Magick::Image& image);
+    std::string GetCacheKey(const std::string& fileName);
+    std::string GetCacheFileName(const std::string& key);
+    std::shared_ptr<std::vector<uint8_t>> GetImage(const std::string& fileName);
+    bool DecodeImage(const std::string& fileName, uint8_t* buffer);
     void CleanupCache(void);
 
     std::string m_imagePath;
@@ -67,6 +67,7 @@ private:
     int m_freeSpace;    // MB free on filesystem
 
     std::vector<std::string> m_files;
+    std::deque<std::string> m_upcoming; // picked but not yet shown
 
     int m_width;
     int m_height;
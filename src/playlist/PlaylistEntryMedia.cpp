@@ -136,6 +136,17 @@ int PlaylistEntryMedia::PreparePlay() {
     return 1;
 }
 
+/*
+ *
+ */
+void PlaylistEntryMedia::Prefetch(void) {
+    // Random modes don't pick the file until PreparePlay()
+    if (m_fileMode == "single") {
+        ::PrefetchMediaFile(m_mediaFilename.c_str());
+        PrerollMediaOutput(m_mediaFilename, GetVideoOutput());
+    }
+}
+
 /*
  *
  */
@@ -331,19 +342,7 @@ int PlaylistEntryMedia::OpenMediaOutput(void) {
     MediaDetails::INSTANCE.ParseMedia(m_mediaFilename.c_str());
     PluginManager::INSTANCE.mediaCallback(m_parentPlaylist->GetInfo(), MediaDetails::INSTANCE);
 
-    std::string vOut = m_videoOutput;
-    if (vOut == "--Default--") {
-        vOut = getSetting("VideoOutput");
-    }
-    if (vOut == "") {
-#if !defined(PLATFORM_BBB)
-        vOut = "--HDMI--";
-#else
-        vOut = "--Disabled--";
-#endif
-    }
-
-    m_mediaOutput = CreateMediaOutput(tmpFile, vOut);
+    m_mediaOutput = CreateMediaOutput(tmpFile, GetVideoOutput());
 
     if (!m_mediaOutput) {
         pthread_mutex_unlock(&m_mediaOutputLock);
@@ -358,6 +357,24 @@ int PlaylistEntryMedia::OpenMediaOutput(void) {
     return 1;
 }
 
+/*
+ *
+ */
+std::string PlaylistEntryMedia::GetVideoOutput(void) {
+    std::string vOut = m_videoOutput;
+    if (vOut == "--Default--") {
+        vOut = getSetting("VideoOutput");
+    }
+    if (vOut == "") {
+#if !defined(PLATFORM_BBB)
+        vOut = "--HDMI--";
+#else
+        vOut = "--Disabled--";
+#endif
+    }
+    return vOut;
+}
+
 /*
  *
  */
@@ -26,6 +26,7 @@ public:
     virtual int PreparePlay();
     virtual int StartPlaying(void) override;
     virtual int Process(void) override;
+    virtual void Prefetch(void) override;
     virtual int Stop(void) override;
 
     virtual void Pause() override;
@@ -51,6 +52,7 @@ public:
 
 private:
     int OpenMediaOutput(void);
+    std::string GetVideoOutput(void);
     int CloseMediaOutput(void);
 
     unsigned int m_fileSeed;
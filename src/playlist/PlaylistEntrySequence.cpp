@@ -66,6 +66,13 @@ int PlaylistEntrySequence::PreparePlay(int frame) {
     return 1;
 }
 
+/*
+ *
+ */
+void PlaylistEntrySequence::Prefetch(void) {
+    sequence->PrefetchSequenceFile(m_sequenceName);
+}
+
 /*
  *
  */
@@ -25,6 +25,7 @@ public:
     int PreparePlay(int frame = 0);
     virtual int StartPlaying(void) override;
     virtual int Process(void) override;
+    virtual void Prefetch(void) override;
     virtual int Stop(void) override;
 
     virtual void Pause() override;
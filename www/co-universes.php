@@ -196,6 +196,7 @@ function PopulateInterfaces()
                                     <th aria-label='Universe Priority'>Universe <br>Priority</th>
 									<th aria-label='Monitor controller'>Monitor</th>
                                     <th aria-label='Suppress Duplicate network packets'>DeDup</th>
+                                    <th aria-label='DDP packet MTU'>MTU</th>
                                     <th aria-label='Test ping controller'>Ping</th>
                                 </tr>
 							</thead>
@@ -349,6 +349,7 @@ PrintSettingCheckbox("MultiSync Stats Live Update", "syncStatsLiveUpdate", 0, 0,
                                     <th rowspan=2 data-filter='false'>Ping</th>
                                     <th rowspan=2 data-filter='false'>Plugin</th>
                                     <th rowspan=2 data-filter='false'>FPP<br>Cmd</th>
+                                    <th rowspan=2 data-filter='false'>Time<br>Sync</th>
                                     <th rowspan=2 data-filter='false'>Errors</th>
                                 </tr>
                                 <tr>
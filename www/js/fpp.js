@@ -2542,6 +2542,7 @@ function SetUniverseCount(input) {
             universe.priority = 0;
             universe.monitor = 1;
             universe.deDuplicate = 0;
+            universe.mtu = 0;
             channelData.universes.push(universe);
             if (input) {
                 data.channelInputs = [];
@@ -2583,7 +2584,7 @@ function SetUniverseCount(input) {
             document.getElementById("txtStartAddress[" + UniverseCount + "]").value = startAddress;
 
             if (!input) {
-                document.getElementById("tblUniversesBody").rows[UniverseCount].cells[14].innerHTML = "<input type='button' class='pingButton buttons' value='Ping' onClick='PingE131IP(" + UniverseCount + ");'/>";
+                document.getElementById("tblUniversesBody").rows[UniverseCount].cells[15].innerHTML = "<input type='button' class='pingButton buttons' value='Ping' onClick='PingE131IP(" + UniverseCount + ");'/>";
             }
             updateUniverseEndChannel(document.getElementById("tblUniversesBody").rows[UniverseCount]);
             UniverseCount++;
@@ -2658,6 +2659,8 @@ function IPOutputTypeChanged(item, input) {
     }
     var priority = $(item).parent().parent().find("input.txtPriority");
     priority.prop('disabled', type > 1);
+    // only DDP packets are sized to the MTU
+    $(item).parent().parent().find("input.txtMTU").prop('disabled', type != 4 && type != 5);
 }
 
 function updateUniverseEndChannel(row) {
@@ -2734,12 +2737,20 @@ function populateUniverseData(data, reload, input) {
         if (universe.deDuplicate != null) {
             deDuplicate = universe.deDuplicate;
         }
+        var mtu = 0;
+        if (universe.mtu != null) {
+            mtu = universe.mtu;
+        }
 
         var universeSize = 512;
         var universeCountDisable = "";
         var universeNumberDisable = "";
         var monitorDisabled = "";
         var ipDisabled = "";
+        var mtuDisabled = "";
+        if (type != 4 && type != 5) {
+            mtuDisabled = " disabled";
+        }
         if (type == 4 || type == 5 || type == 8) {
             universeSize = FPPD_MAX_CHANNELS;
             universeCountDisable = " disabled";
@@ -2801,6 +2812,7 @@ function populateUniverseData(data, reload, input) {
         bodyHTML += "/></td>";
         bodyHTML += "<td " + inputStyle + "><input class='txtMonitor' id='txtMonitor' type='checkbox' size='4' maxlength='4' " + (monitor == 1 ? "checked" : "") + monitorDisabled + "/></td>" +
             "<td " + inputStyle + "><input class='txtDeDuplicate' id='txtDeDuplicate' type='checkbox' size='4' maxlength='4' " + (deDuplicate == 1 ? "checked" : "") + "/></td>" +
+            "<td " + inputStyle + "><input class='txtMTU singleDigitInput' type='number' min='-1' max='9216' value='" + mtu.toString() + "' title='0 for standard 1440 channel packets, -1 to use the MTU of the route to the controller'" + mtuDisabled + "/></td>" +
             "<td " + inputStyle + "><input type=button class='pingButton buttons' onClick='PingE131IP(" + i.toString() + ");' value='Ping' " + ipDisabled + "></td>" +
             "</tr>";
     }
@@ -2886,7 +2898,7 @@ function getPixelnetDMXoutputs() {
 function SetUniverseRowInputNames(row, id) {
     var fields = Array('rowGrip', 'chkActive', 'txtDesc', 'txtStartAddress',
         'txtUniverse', 'numUniverseCount', 'txtSize', 'universeType', 'txtIP',
-        'txtPriority', 'txtMonitor', 'txtDeDuplicate');
+        'txtPriority', 'txtMonitor', 'txtDeDuplicate', 'txtMTU');
     row.find('span.rowID').html((id + 1).toString());
 
     for (var i = 0; i < fields.length; i++) {
@@ -2928,6 +2940,8 @@ function DeleteUniverse(input) {
             document.getElementById("txtPriority[" + selectedIndex + "]").value = document.getElementById("txtPriority[" + i + "]").value;
             document.getElementById("txtMonitor[" + selectedIndex + "]").checked = document.getElementById("txtMonitor[" + i + "]").checked;
             document.getElementById("txtDeDuplicate[" + selectedIndex + "]").checked = document.getElementById("txtDeDuplicate[" + i + "]").checked;
+            document.getElementById("txtMTU[" + selectedIndex + "]").value = document.getElementById("txtMTU[" + i + "]").value;
+            document.getElementById("txtMTU[" + selectedIndex + "]").disabled = document.getElementById("txtMTU[" + i + "]").disabled;
             if ((universeType == '1') || (universeType == '3')) {
                 document.getElementById("txtIP[" + selectedIndex + "]").disabled = false;
             } else {
@@ -2958,6 +2972,8 @@ function CloneUniverses(cloneNumber) {
             var priority = Number(document.getElementById("txtPriority[" + selectIndex + "]").value);
             var monitor = document.getElementById("txtMonitor[" + selectIndex + "]").checked ? 1 : 0;
             var deDuplicate = document.getElementById("txtDeDuplicate[" + selectIndex + "]").checked ? 1 : 0;
+            var mtu = document.getElementById("txtMTU[" + selectIndex + "]").value;
+            var mtuDisabled = document.getElementById("txtMTU[" + selectIndex + "]").disabled;
 
             for (z = 0; z < cloneNumber; z++, universe += uCount) {
                 var i = z + UniverseSelected + 1;
@@ -2973,6 +2989,8 @@ function CloneUniverses(cloneNumber) {
                 document.getElementById("txtPriority[" + i + "]").value = priority;
                 document.getElementById("txtMonitor[" + i + "]").checked = (monitor == 1);
                 document.getElementById("txtDeDuplicate[" + i + "]").checked = (deDuplicate == 1);
+                document.getElementById("txtMTU[" + i + "]").value = mtu;
+                document.getElementById("txtMTU[" + i + "]").disabled = mtuDisabled;
                 if ((universeType == '1') || (universeType == '3')) {
                     document.getElementById("txtIP[" + i + "]").disabled = false;
                 }
@@ -3052,6 +3070,7 @@ function postUniverseJSON(input) {
         if (!input) {
             universe.monitor = document.getElementById("txtMonitor[" + i + "]").checked ? 1 : 0;
             universe.deDuplicate = document.getElementById("txtDeDuplicate[" + i + "]").checked ? 1 : 0;
+            universe.mtu = parseInt(document.getElementById("txtMTU[" + i + "]").value) || 0;
         }
         output.universes.push(universe);
     }
@@ -3828,6 +3847,9 @@ function ShowMultiSyncStats(data) {
     if (data.masterHostname != '')
         master += ' (' + data.masterHostname + ')';
 
+    if ((typeof data.masterClock != 'undefined') && data.masterClock.valid)
+        master += ' - Clock Offset: ' + (data.masterClock.offsetUS / 1000).toFixed(3) + 'ms, Delay: ' + (data.masterClock.delayUS / 1000).toFixed(3) + 'ms';
+
     $('#syncMaster').html(master);
 
     var now = new Date().getTime();
@@ -3856,6 +3878,7 @@ function ShowMultiSyncStats(data) {
             + '<td class="right">' + s.pktPing + '</td>'
             + '<td class="right">' + s.pktPlugin + '</td>'
             + '<td class="right">' + s.pktFPPCommand + '</td>'
+            + '<td class="right">' + s.pktTimeSync + '</td>'
             + '<td class="right">' + s.pktError + '</td>'
             + '</tr>';
 
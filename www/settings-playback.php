@@ -5,4 +5,5 @@ require_once('common.php');
 
 <?
 PrintSettingGroup('generalPlayback');
+PrintSettingGroup('multiSync');
 ?>